@@ -0,0 +1,114 @@
+/*
+ * AST 节点分派微基准
+ *
+ * 对比旧版解释器的 dynamic_cast 探测链（按 eval/execute 原有的探测顺序）
+ * 与 NodeKind 标签 switch 分派在每个节点上的开销。
+ *
+ * 编译运行：
+ *   clang++ -std=c++17 -O2 dispatch_bench.cpp -o dispatch_bench
+ *   ./dispatch_bench
+ */
+#include "../interpreter/ast.hpp"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+// 旧版 Interpreter::eval 的探测顺序
+static int legacy_expr_dispatch(const ASTNode* node) {
+    if (dynamic_cast<const LiteralExpr*>(node)) return 0;
+    else if (dynamic_cast<const IdentifierExpr*>(node)) return 1;
+    else if (dynamic_cast<const VarExpr*>(node)) return 2;
+    else if (dynamic_cast<const BinaryExpr*>(node)) return 3;
+    else if (dynamic_cast<const UnaryExpr*>(node)) return 4;
+    else if (dynamic_cast<const CallExpr*>(node)) return 5;
+    else if (dynamic_cast<const ArrayExpr*>(node)) return 6;
+    return -1;
+}
+
+// 旧版 Interpreter::execute 的探测顺序
+static int legacy_stmt_dispatch(const ASTNode* node) {
+    if (dynamic_cast<const VarDeclStmt*>(node)) return 0;
+    else if (dynamic_cast<const DefineStmt*>(node)) return 1;
+    else if (dynamic_cast<const BigIntDeclStmt*>(node)) return 2;
+    else if (dynamic_cast<const AssignStmt*>(node)) return 3;
+    else if (dynamic_cast<const IfStmt*>(node)) return 4;
+    else if (dynamic_cast<const WhileStmt*>(node)) return 5;
+    else if (dynamic_cast<const FuncDefStmt*>(node)) return 6;
+    else if (dynamic_cast<const BlockStmt*>(node)) return 7;
+    else if (dynamic_cast<const ReturnStmt*>(node)) return 8;
+    else if (dynamic_cast<const BreakStmt*>(node)) return 9;
+    else if (dynamic_cast<const ContinueStmt*>(node)) return 10;
+    else if (dynamic_cast<const IncludeStmt*>(node)) return 11;
+    else if (dynamic_cast<const ExprStmt*>(node)) return 12;
+    return -1;
+}
+
+// 新版：按标签跳转
+static int tagged_dispatch(const ASTNode* node) {
+    switch (node->kind) {
+    case NodeKind::Literal: return 0;
+    case NodeKind::Identifier: return 1;
+    case NodeKind::Var: return 2;
+    case NodeKind::Binary: return 3;
+    case NodeKind::Unary: return 4;
+    case NodeKind::Call: return 5;
+    case NodeKind::Array: return 6;
+    case NodeKind::VarDecl: return 0;
+    case NodeKind::Define: return 1;
+    case NodeKind::BigIntDecl: return 2;
+    case NodeKind::Assign: return 3;
+    case NodeKind::If: return 4;
+    case NodeKind::While: return 5;
+    case NodeKind::FuncDef: return 6;
+    case NodeKind::Block: return 7;
+    case NodeKind::Return: return 8;
+    case NodeKind::Break: return 9;
+    case NodeKind::Continue: return 10;
+    case NodeKind::Include: return 11;
+    case NodeKind::ExprStmt: return 12;
+    default: return -1;
+    }
+}
+
+template <class F>
+static double ns_per_node(const std::vector<const ASTNode*>& nodes, F dispatch, long iterations) {
+    volatile long sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long it = 0; it < iterations; ++it) {
+        for (const ASTNode* n : nodes) sink = sink + dispatch(n);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    return ns / (static_cast<double>(iterations) * nodes.size());
+}
+
+int main() {
+    const long iterations = 2000000;
+    auto lit = [] { return make_node<LiteralExpr>(Value(1)); };
+
+    struct Case { const char* name; NodePtr<ASTNode> node; bool is_expr; };
+    std::vector<Case> cases;
+    cases.push_back({"LiteralExpr", lit(), true});
+    cases.push_back({"VarExpr", make_node<VarExpr>("x"), true});
+    cases.push_back({"BinaryExpr", make_node<BinaryExpr>(BinaryOp::Add, lit(), lit()), true});
+    cases.push_back({"UnaryExpr", make_node<UnaryExpr>(UnaryOp::Negate, lit()), true});
+    cases.push_back({"CallExpr", make_node<CallExpr>("f", std::vector<NodePtr<Expression>>{}), true});
+    cases.push_back({"ArrayExpr", make_node<ArrayExpr>(std::vector<NodePtr<Expression>>{}), true});
+    cases.push_back({"VarDeclStmt", make_node<VarDeclStmt>("x", lit()), false});
+    cases.push_back({"AssignStmt", make_node<AssignStmt>("x", lit()), false});
+    cases.push_back({"IfStmt", make_node<IfStmt>(lit(), make_node<BlockStmt>(), nullptr), false});
+    cases.push_back({"WhileStmt", make_node<WhileStmt>(lit(), make_node<BlockStmt>()), false});
+    cases.push_back({"ReturnStmt", make_node<ReturnStmt>(lit()), false});
+    cases.push_back({"ExprStmt", make_node<ExprStmt>(lit()), false});
+
+    std::printf("%-14s %14s %14s %8s\n", "node", "dynamic_cast", "NodeKind", "speedup");
+    for (const auto& c : cases) {
+        std::vector<const ASTNode*> nodes(16, c.node.get());
+        double before = c.is_expr ? ns_per_node(nodes, legacy_expr_dispatch, iterations / 16)
+                                  : ns_per_node(nodes, legacy_stmt_dispatch, iterations / 16);
+        double after = ns_per_node(nodes, tagged_dispatch, iterations / 16);
+        std::printf("%-14s %11.2f ns %11.2f ns %7.1fx\n", c.name, before, after, before / after);
+    }
+    return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * Value 表示的大小与复制开销微基准
+ *
+ * LegacyValue 复刻旧版 Value 的布局（虚析构 + type 字段 + 内联所有载荷的 std::variant），
+ * 与当前 16 字节带标签联合体的 Value 对比：
+ *   - sizeof 以及 int 数组所占内存
+ *   - 复制一个 int 数组（标量快速路径）
+ *   - 复制一个字符串数组（堆载荷，引用计数共享）
+ *   - 复制一个持有 10 万元素数组的值（读取数组变量、传参时的开销）
+ *
+ * 编译运行：
+ *   clang++ -std=c++17 -O2 value_bench.cpp -o value_bench
+ *   ./value_bench
+ */
+#include "../interpreter/value.hpp"
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <variant>
+#include <vector>
+
+// 旧版 Value 的数据布局
+struct LegacyValue {
+    Value::Type type;
+    std::variant<std::nullptr_t, bool, int, double, std::string, std::vector<LegacyValue>,
+                 std::vector<std::vector<LegacyValue>>, ::BigInt, ::Rational, ::Irrational> data;
+
+    LegacyValue(int i) : type(Value::Type::Int), data(std::in_place_index<2>, i) {}
+    LegacyValue(const std::string& s) : type(Value::Type::String), data(s) {}
+    LegacyValue(const std::vector<LegacyValue>& arr) : type(Value::Type::Array), data(arr) {}
+    virtual ~LegacyValue() = default;
+};
+
+template <class V, class Make>
+static double ns_per_element_copy(Make make, size_t count, int rounds) {
+    std::vector<V> source;
+    source.reserve(count);
+    for (size_t i = 0; i < count; ++i) source.push_back(make(static_cast<int>(i)));
+
+    volatile size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        std::vector<V> copy = source;
+        sink = sink + copy.size();
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    return ns / (static_cast<double>(rounds) * count);
+}
+
+int main() {
+    const size_t count = 100000;
+    const int rounds = 200;
+
+    std::printf("sizeof(LegacyValue) = %zu bytes\n", sizeof(LegacyValue));
+    std::printf("sizeof(Value)       = %zu bytes\n", sizeof(Value));
+    std::printf("%zu ints: %zu KiB -> %zu KiB\n\n", count,
+                count * sizeof(LegacyValue) / 1024, count * sizeof(Value) / 1024);
+
+    std::printf("%-16s %14s %14s %8s\n", "copy", "legacy", "compact", "speedup");
+
+    double before = ns_per_element_copy<LegacyValue>([](int i) { return LegacyValue(i); }, count, rounds);
+    double after = ns_per_element_copy<Value>([](int i) { return Value(i); }, count, rounds);
+    std::printf("%-16s %11.2f ns %11.2f ns %7.1fx\n", "int array", before, after, before / after);
+
+    before = ns_per_element_copy<LegacyValue>([](int i) { return LegacyValue(std::to_string(i)); }, count, rounds / 10);
+    after = ns_per_element_copy<Value>([](int i) { return Value(std::to_string(i)); }, count, rounds / 10);
+    std::printf("%-16s %11.2f ns %11.2f ns %7.1fx\n", "string array", before, after, before / after);
+
+    // 整个数组作为一个值复制：旧版深拷贝全部元素，当前只增加引用计数
+    std::vector<LegacyValue> legacy_elements;
+    std::vector<Value> elements;
+    for (size_t i = 0; i < count; ++i) {
+        legacy_elements.push_back(LegacyValue(static_cast<int>(i)));
+        elements.push_back(Value(static_cast<int>(i)));
+    }
+    before = ns_per_element_copy<LegacyValue>([&](int) { return LegacyValue(legacy_elements); }, 16, rounds / 10);
+    after = ns_per_element_copy<Value>([&](int) { return Value(elements); }, 16, rounds / 10);
+    std::printf("%-16s %11.2f ns %11.2f ns %7.0fx\n", "100k array value", before, after, before / after);
+    return 0;
+}
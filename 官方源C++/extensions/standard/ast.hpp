@@ -2,177 +2,357 @@
 #define LAMINA_AST_HPP
 
 #pragma once
+#include "value.hpp"
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 #include <memory>
+#include <new>
+#include <utility>
 
 #endif // LAMINA_AST_HPP
 
+// AST 节点类型标签，解释器按此标签跳转分派，避免逐个 dynamic_cast 探测
+enum class NodeKind : unsigned char {
+    // 表达式
+    Literal,
+    Identifier,
+    Var,
+    Binary,
+    Unary,
+    Call,
+    NamespaceCall,
+    Array,
+    // 语句
+    VarDecl,
+    Assign,
+    Block,
+    If,
+    While,
+    For,
+    FuncDef,
+    Return,
+    Include,
+    Use,
+    Break,
+    Continue,
+    ExprStmt,
+    Define,
+    BigIntDecl
+};
+
 // AST 基类
 struct ASTNode {
+    const NodeKind kind;
+    bool in_arena = false;  // 节点内存属于 AstArena，释放时只执行析构
+    explicit ASTNode(NodeKind k) : kind(k) {}
     virtual ~ASTNode() = default;
 };
 
+// AST 节点分配区：一次解析产生的节点依次放在若干大块内存中，遍历时父子节点地址相邻；
+// 整棵树的节点内存随分配区一起释放（节点析构仍逐个执行，以释放字符串等成员）
+class AstArena {
+public:
+    AstArena() = default;
+    AstArena(const AstArena&) = delete;
+    AstArena& operator=(const AstArena&) = delete;
+
+    void* allocate(size_t size, size_t align) {
+        size_t offset = (used + align - 1) & ~(align - 1);
+        if (blocks.empty() || offset + size > capacity) {
+            capacity = size > BLOCK_SIZE ? size : BLOCK_SIZE;
+            blocks.emplace_back(new unsigned char[capacity]);
+            offset = 0;
+        }
+        used = offset + size;
+        return blocks.back().get() + offset;
+    }
+
+    // 当前线程正在使用的分配区；没有时 make_node 使用普通堆分配（如优化器生成的节点）
+    static AstArena*& current() {
+        static thread_local AstArena* arena = nullptr;
+        return arena;
+    }
+
+    // 在作用域内把 arena 设为当前分配区
+    class Scope {
+    public:
+        explicit Scope(AstArena* arena) : saved(current()) { current() = arena; }
+        ~Scope() { current() = saved; }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        AstArena* saved;
+    };
+
+private:
+    static constexpr size_t BLOCK_SIZE = 32 * 1024;
+    std::vector<std::unique_ptr<unsigned char[]>> blocks;
+    size_t used = 0;
+    size_t capacity = 0;
+};
+
+// 子节点的所有权指针：分配区中的节点只析构不释放内存
+struct NodeDeleter {
+    void operator()(ASTNode* node) const {
+        if (!node) return;
+        if (node->in_arena) {
+            node->~ASTNode();
+        } else {
+            delete node;
+        }
+    }
+};
+
+template <class T>
+using NodePtr = std::unique_ptr<T, NodeDeleter>;
+
+// 创建 AST 节点：有当前分配区时在其中分配
+template <class T, class... Args>
+NodePtr<T> make_node(Args&&... args) {
+    AstArena* arena = AstArena::current();
+    T* node = arena ? new (arena->allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...)
+                    : new T(std::forward<Args>(args)...);
+    node->in_arena = arena != nullptr;
+    return NodePtr<T>(node);
+}
+
 // 表达式基类
 struct Expression : public ASTNode {
     std::string source; // 保存表达式源码
+    explicit Expression(NodeKind k) : ASTNode(k) {}
 };
 
 // 语句基类
-struct Statement : public ASTNode {};
+struct Statement : public ASTNode {
+    // 已由 Interpreter::run_statement 完成优化与名称解析，此后执行只读取 AST
+    std::atomic<bool> prepared{false};
+    explicit Statement(NodeKind k) : ASTNode(k) {}
+};
 
-// 字面量
+// 变量引用的解析结果，由 Resolver 填写；未解析的引用按名称查找
+struct VarRef {
+    enum class Scope : unsigned char { Unresolved, Local, Global };
+    Scope scope = Scope::Unresolved;
+    int slot = -1;
+};
+
+// 字面量：解析时即按记号类型构造好常量值
 struct LiteralExpr : public Expression {
-    std::string value;
-    LiteralExpr(const std::string& v) : value(v) {}
+    Value value;
+    explicit LiteralExpr(const Value& v) : Expression(NodeKind::Literal), value(v) {}
 };
 
 // 标识符
 struct IdentifierExpr : public Expression {
     std::string name;
-    IdentifierExpr(const std::string& n) : name(n) {}
+    VarRef ref;
+    IdentifierExpr(const std::string& n) : Expression(NodeKind::Identifier), name(n) {}
 };
 
 // 变量引用
 struct VarExpr : public Expression {
     std::string name;
-    VarExpr(const std::string& n) : name(n) {}
+    VarRef ref;
+    VarExpr(const std::string& n) : Expression(NodeKind::Var), name(n) {}
+};
+
+// 二元运算符，解析时由记号确定，解释器按此编码查表分派
+enum class BinaryOp : unsigned char {
+    Add, Sub, Mul, Div, Mod, Pow,
+    Eq, Ne, Lt, Le, Gt, Ge,
+    Count
 };
 
+// 一元运算符
+enum class UnaryOp : unsigned char {
+    Negate,     // -x
+    Factorial,  // x!
+    Square      // x^2，由优化器从幂运算改写而来
+};
+
+// 运算符的源码写法，用于错误信息
+inline const char* binary_op_name(BinaryOp op) {
+    static const char* const names[] = {"+", "-", "*", "/", "%", "^", "==", "!=", "<", "<=", ">", ">="};
+    return op < BinaryOp::Count ? names[static_cast<size_t>(op)] : "?";
+}
+
 // 二元运算
 struct BinaryExpr : public Expression {
-    std::string op;
-    std::unique_ptr<Expression> left, right;
-    BinaryExpr(const std::string& o, std::unique_ptr<Expression> l, std::unique_ptr<Expression> r)
-        : op(o), left(std::move(l)), right(std::move(r)) {}
+    BinaryOp op;
+    NodePtr<Expression> left, right;
+    BinaryExpr(BinaryOp o, NodePtr<Expression> l, NodePtr<Expression> r)
+        : Expression(NodeKind::Binary), op(o), left(std::move(l)), right(std::move(r)) {}
 };
 
 // 一元运算
 struct UnaryExpr : public Expression {
-    std::string op;
-    std::unique_ptr<Expression> operand;
-    UnaryExpr(const std::string& o, std::unique_ptr<Expression> e)
-        : op(o), operand(std::move(e)) {}
+    UnaryOp op;
+    NodePtr<Expression> operand;
+    UnaryExpr(UnaryOp o, NodePtr<Expression> e)
+        : Expression(NodeKind::Unary), op(o), operand(std::move(e)) {}
 };
 
 // 变量声明
 struct VarDeclStmt : public Statement {
     std::string name;
-    std::unique_ptr<Expression> expr;
-    VarDeclStmt(const std::string& n, std::unique_ptr<Expression> e)
-        : name(n), expr(std::move(e)) {}
+    VarRef ref;
+    NodePtr<Expression> expr;
+    VarDeclStmt(const std::string& n, NodePtr<Expression> e)
+        : Statement(NodeKind::VarDecl), name(n), expr(std::move(e)) {}
 };
 
 // 赋值
 struct AssignStmt : public Statement {
     std::string name;
-    std::unique_ptr<Expression> expr;
-    AssignStmt(const std::string& n, std::unique_ptr<Expression> e)
-        : name(n), expr(std::move(e)) {}
+    VarRef ref;
+    NodePtr<Expression> expr;
+    AssignStmt(const std::string& n, NodePtr<Expression> e)
+        : Statement(NodeKind::Assign), name(n), expr(std::move(e)) {}
 };
 
 
 // 复合语句块
 struct BlockStmt : public Statement {
-    std::vector<std::unique_ptr<Statement>> statements;
+    // 解析得到的根节点持有整棵树的分配区；声明在 statements 之前，保证子节点先析构
+    std::unique_ptr<AstArena> arena;
+    std::vector<NodePtr<Statement>> statements;
+    BlockStmt() : Statement(NodeKind::Block) {}
 };
 
 // if 语句
 struct IfStmt : public Statement {
-    std::unique_ptr<Expression> condition;
-    std::unique_ptr<BlockStmt> thenBlock;
-    std::unique_ptr<BlockStmt> elseBlock;
-    IfStmt(std::unique_ptr<Expression> cond, std::unique_ptr<BlockStmt> thenB, std::unique_ptr<BlockStmt> elseB)
-        : condition(std::move(cond)), thenBlock(std::move(thenB)), elseBlock(std::move(elseB)) {}
+    NodePtr<Expression> condition;
+    NodePtr<BlockStmt> thenBlock;
+    NodePtr<BlockStmt> elseBlock;
+    IfStmt(NodePtr<Expression> cond, NodePtr<BlockStmt> thenB, NodePtr<BlockStmt> elseB)
+        : Statement(NodeKind::If), condition(std::move(cond)), thenBlock(std::move(thenB)), elseBlock(std::move(elseB)) {}
 };
 
 // while 语句
 struct WhileStmt : public Statement {
-    std::unique_ptr<Expression> condition;
-    std::unique_ptr<BlockStmt> body;
-    WhileStmt(std::unique_ptr<Expression> cond, std::unique_ptr<BlockStmt> b)
-        : condition(std::move(cond)), body(std::move(b)) {}
+    NodePtr<Expression> condition;
+    NodePtr<BlockStmt> body;
+    WhileStmt(NodePtr<Expression> cond, NodePtr<BlockStmt> b)
+        : Statement(NodeKind::While), condition(std::move(cond)), body(std::move(b)) {}
+};
+
+// for 语句：for i in a..b 遍历整数区间 [a, b)，for x in arr 遍历数组元素
+struct ForStmt : public Statement {
+    std::string name;
+    VarRef ref;
+    NodePtr<Expression> start;  // 区间起点，或被遍历的数组
+    NodePtr<Expression> end;    // 区间终点；遍历数组时为空
+    NodePtr<BlockStmt> body;
+    ForStmt(const std::string& n, NodePtr<Expression> s, NodePtr<Expression> e, NodePtr<BlockStmt> b)
+        : Statement(NodeKind::For), name(n), start(std::move(s)), end(std::move(e)), body(std::move(b)) {}
+    bool is_range() const { return end != nullptr; }
 };
 
 // 函数定义
 struct FuncDefStmt : public Statement {
     std::string name;
     std::vector<std::string> params;
-    std::unique_ptr<BlockStmt> body;
-    FuncDefStmt(const std::string& n, const std::vector<std::string>& p, std::unique_ptr<BlockStmt> b)
-        : name(n), params(p), body(std::move(b)) {}
+    NodePtr<BlockStmt> body;
+    // 局部变量槽位名（参数在前），由 Resolver 填写
+    std::vector<std::string> locals;
+    bool resolved = false;
+    int line = 0;  // 定义所在行，用于调用栈显示
+    FuncDefStmt(const std::string& n, const std::vector<std::string>& p, NodePtr<BlockStmt> b)
+        : Statement(NodeKind::FuncDef), name(n), params(p), body(std::move(b)) {}
+};
+
+class Interpreter;
+
+// 调用点缓存：记录上次解析到的调用目标，函数表变化后（generation 不同）重新解析
+// 缓存的目标来自某个实例的函数表，由解释器实例（字节码中由 VM）按调用点保存，不放在共享的 AST 上
+struct CallSiteCache {
+    using Builtin = std::function<Value(const std::vector<Value>&)>;
+    // 需要访问调用方解释器的内置函数（map/filter 等），调用时传入当前实例
+    using InterpreterBuiltin = Value (*)(Interpreter&, const std::vector<Value>&);
+    uint32_t generation = 0;          // 0 表示尚未解析
+    std::string target;               // 解析时的实际函数名（经参数传入的函数名可能变化）
+    const Builtin* builtin = nullptr;
+    InterpreterBuiltin interpreter_builtin = nullptr;
+    const std::string* builtin_name = nullptr;  // 内置函数表中的键，用作调用栈帧的名称
+    FuncDefStmt* func = nullptr;
+    bool is_module = false;
 };
 
 // 函数调用
 struct CallExpr : public Expression {
     std::string callee;
-    std::vector<std::unique_ptr<Expression>> args;
-    CallExpr(const std::string& c, std::vector<std::unique_ptr<Expression>> a)
-        : callee(c), args(std::move(a)) {}
+    VarRef callee_ref;
+    std::vector<NodePtr<Expression>> args;
+    CallExpr(const std::string& c, std::vector<NodePtr<Expression>> a)
+        : Expression(NodeKind::Call), callee(c), args(std::move(a)) {}
 };
 
 // 命名空间函数调用
 struct NamespaceCallExpr : public Expression {
     std::string namespace_name;
     std::string function_name;
-    std::vector<std::unique_ptr<Expression>> args;
-    NamespaceCallExpr(const std::string& ns, const std::string& fn, std::vector<std::unique_ptr<Expression>> a)
-        : namespace_name(ns), function_name(fn), args(std::move(a)) {}
+    std::vector<NodePtr<Expression>> args;
+    NamespaceCallExpr(const std::string& ns, const std::string& fn, std::vector<NodePtr<Expression>> a)
+        : Expression(NodeKind::NamespaceCall), namespace_name(ns), function_name(fn), args(std::move(a)) {}
 };
 
 // 数组字面量
 struct ArrayExpr : public Expression {
-    std::vector<std::unique_ptr<Expression>> elements;
-    ArrayExpr(std::vector<std::unique_ptr<Expression>> elems)
-        : elements(std::move(elems)) {}
+    std::vector<NodePtr<Expression>> elements;
+    ArrayExpr(std::vector<NodePtr<Expression>> elems)
+        : Expression(NodeKind::Array), elements(std::move(elems)) {}
 };
 
 // return 语句
 struct ReturnStmt : public Statement {
-    std::unique_ptr<Expression> expr;
-    ReturnStmt(std::unique_ptr<Expression> e) : expr(std::move(e)) {}
+    NodePtr<Expression> expr;
+    ReturnStmt(NodePtr<Expression> e) : Statement(NodeKind::Return), expr(std::move(e)) {}
 };
 
 // include 语句
 struct IncludeStmt : public Statement {
     std::string module;
-    IncludeStmt(const std::string& m) : module(m) {}
+    IncludeStmt(const std::string& m) : Statement(NodeKind::Include), module(m) {}
 };
 
 // use 语句
 struct UseStmt : public Statement {
     std::string module;
-    UseStmt(const std::string& m) : module(m) {}
+    UseStmt(const std::string& m) : Statement(NodeKind::Use), module(m) {}
 };
 
 // break 语句
 struct BreakStmt : public Statement {
-    BreakStmt() {}
+    BreakStmt() : Statement(NodeKind::Break) {}
 };
 
 // continue 语句
 struct ContinueStmt : public Statement {
-    ContinueStmt() {}
+    ContinueStmt() : Statement(NodeKind::Continue) {}
 };
 
 // 表达式语句
 struct ExprStmt : public Statement {
-    std::unique_ptr<Expression> expr;
-    ExprStmt(std::unique_ptr<Expression> e) : expr(std::move(e)) {}
+    NodePtr<Expression> expr;
+    ExprStmt(NodePtr<Expression> e) : Statement(NodeKind::ExprStmt), expr(std::move(e)) {}
 };
 
 // Define语句（用于设置常量，如递归深度）
 struct DefineStmt : public Statement {
     std::string name;
-    std::unique_ptr<Expression> value;
-    DefineStmt(const std::string& n, std::unique_ptr<Expression> v) 
-        : name(n), value(std::move(v)) {}
+    NodePtr<Expression> value;
+    DefineStmt(const std::string& n, NodePtr<Expression> v) 
+        : Statement(NodeKind::Define), name(n), value(std::move(v)) {}
 };
 
 // BigInt变量声明
 struct BigIntDeclStmt : public Statement {
     std::string name;
-    std::unique_ptr<Expression> init_value;
-    BigIntDeclStmt(const std::string& n, std::unique_ptr<Expression> v = nullptr) 
-        : name(n), init_value(std::move(v)) {}
+    VarRef ref;
+    NodePtr<Expression> init_value;
+    BigIntDeclStmt(const std::string& n, NodePtr<Expression> v = nullptr) 
+        : Statement(NodeKind::BigIntDecl), name(n), init_value(std::move(v)) {}
 };
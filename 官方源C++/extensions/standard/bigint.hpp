@@ -4,112 +4,222 @@
 #include <algorithm>
 #include <iostream>
 #include <climits>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
 
+// 任意精度整数：符号 + 绝对值，绝对值按 2^32 进制存放（每个 limb 一个 uint32_t，低位在前），
+// 零的绝对值为空。limb 之间的运算使用 64 位中间结果，不依赖 __int128 等编译器扩展
 class BigInt {
 private:
-    std::vector<int> digits;  // 存储数字，低位在前
+    using Limb = uint32_t;
+    using Wide = uint64_t;
+
+    // limb 数组：不超过 INLINE_LIMBS 个 limb（即 64 位以内的值）时存放在对象内，不分配堆内存；
+    // 更长时放到堆上。clear/resize 保留已有容量，复合赋值因此可以反复复用同一块缓冲区。
+    // 接口是 std::vector 的子集，assign(first, last) 的范围不能来自自身
+    class LimbBuffer {
+    public:
+        static constexpr size_t INLINE_LIMBS = 2;
+
+        LimbBuffer() {}
+        explicit LimbBuffer(size_t n, Limb value = 0) { assign(n, value); }
+        LimbBuffer(const LimbBuffer& other) { assign(other.begin(), other.end()); }
+        LimbBuffer(LimbBuffer&& other) noexcept { steal(other); }
+        ~LimbBuffer() { release(); }
+
+        LimbBuffer& operator=(const LimbBuffer& other) {
+            if (this != &other) assign(other.begin(), other.end());
+            return *this;
+        }
+        LimbBuffer& operator=(LimbBuffer&& other) noexcept {
+            if (this != &other) {
+                release();
+                steal(other);
+            }
+            return *this;
+        }
+
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        Limb* data() { return on_heap() ? heap : local; }
+        const Limb* data() const { return on_heap() ? heap : local; }
+        Limb* begin() { return data(); }
+        Limb* end() { return data() + count; }
+        const Limb* begin() const { return data(); }
+        const Limb* end() const { return data() + count; }
+        Limb& operator[](size_t i) { return data()[i]; }
+        const Limb& operator[](size_t i) const { return data()[i]; }
+        Limb& back() { return data()[count - 1]; }
+        const Limb& back() const { return data()[count - 1]; }
+
+        void reserve(size_t n) {
+            if (n > capacity) grow(n);
+        }
+        void resize(size_t n, Limb value = 0) {
+            reserve(n);
+            if (n > count) std::fill(data() + count, data() + n, value);
+            count = n;
+        }
+        void assign(size_t n, Limb value) {
+            count = 0;
+            resize(n, value);
+        }
+        void assign(const Limb* first, const Limb* last) {
+            count = 0;
+            reserve(static_cast<size_t>(last - first));
+            std::copy(first, last, data());
+            count = static_cast<size_t>(last - first);
+        }
+        void push_back(Limb value) {
+            if (count == capacity) grow(capacity + capacity / 2 + 1);
+            data()[count++] = value;
+        }
+        void pop_back() { --count; }
+        void clear() { count = 0; }
+
+        bool operator==(const LimbBuffer& other) const {
+            return count == other.count && std::equal(begin(), end(), other.begin());
+        }
+
+    private:
+        union {
+            Limb* heap = nullptr;
+            Limb local[INLINE_LIMBS];
+        };
+        size_t count = 0;
+        size_t capacity = INLINE_LIMBS;
+
+        bool on_heap() const { return capacity > INLINE_LIMBS; }
+
+        void grow(size_t n) {
+            Limb* fresh = new Limb[n];
+            std::copy(begin(), end(), fresh);
+            release();
+            heap = fresh;
+            capacity = n;
+        }
+        void release() {
+            if (on_heap()) delete[] heap;
+            capacity = INLINE_LIMBS;
+        }
+        // 接管 other 的存储，other 变为空
+        void steal(LimbBuffer& other) {
+            count = other.count;
+            capacity = other.capacity;
+            if (other.on_heap()) {
+                heap = other.heap;
+            } else {
+                std::copy(other.local, other.local + other.count, local);
+            }
+            other.count = 0;
+            other.capacity = INLINE_LIMBS;
+        }
+    };
+
+    using Limbs = LimbBuffer;
+    static constexpr int LIMB_BITS = 32;
+    static constexpr Limb DECIMAL_CHUNK = 1000000000;  // 十进制转换时每次处理 9 位
+    static constexpr int DECIMAL_CHUNK_DIGITS = 9;
+
+    Limbs limbs;  // 绝对值，低位在前，最高位 limb 非零
     bool negative;
 
 public:
     // 友元类声明
     friend class Fraction;
     // 构造函数
-    BigInt() : negative(false) { digits.push_back(0); }
-    
-    BigInt(int n) : negative(n < 0) {
-        if (n == 0) {
-            digits.push_back(0);
-            return;
-        }
-        
-        // 处理 INT_MIN 的特殊情况
-        if (n == INT_MIN) {
-            // INT_MIN 的绝对值超出 int 范围，直接处理
-            long long ln = static_cast<long long>(n);
-            ln = -ln;  // 现在安全了
-            while (ln > 0) {
-                digits.push_back(ln % 10);
-                ln /= 10;
-            }
-        } else {
-            n = std::abs(n);
-            while (n > 0) {
-                digits.push_back(n % 10);
-                n /= 10;
-            }
+    BigInt() : negative(false) {}
+
+    BigInt(int n) : BigInt(static_cast<long long>(n)) {}
+    BigInt(long n) : BigInt(static_cast<long long>(n)) {}
+    BigInt(long long n) : negative(n < 0) {
+        // 按无符号取绝对值，LLONG_MIN 也不会溢出
+        unsigned long long mag = negative ? 0ULL - static_cast<unsigned long long>(n)
+                                          : static_cast<unsigned long long>(n);
+        while (mag > 0) {
+            limbs.push_back(static_cast<Limb>(mag));
+            mag >>= LIMB_BITS;
         }
     }
-    
+
+    // 从十进制字符串构造：可带正负号，其他非数字字符被忽略
     BigInt(const std::string& str) : negative(false) {
-        if (str.empty() || str == "0") {
-            digits.push_back(0);
-            return;
-        }
-        
-        int start = 0;
-        if (str[0] == '-') {
-            negative = true;
-            start = 1;
-        } else if (str[0] == '+') {
+        size_t start = 0;
+        if (!str.empty() && (str[0] == '-' || str[0] == '+')) {
+            negative = str[0] == '-';
             start = 1;
         }
-        
-        for (int i = str.length() - 1; i >= start; i--) {
-            if (str[i] >= '0' && str[i] <= '9') {
-                digits.push_back(str[i] - '0');
+
+        // 每凑满 9 位十进制数字做一次 limbs = limbs * 10^9 + chunk
+        Limb chunk = 0, scale = 1;
+        for (size_t i = start; i < str.size(); ++i) {
+            if (str[i] < '0' || str[i] > '9') continue;
+            chunk = chunk * 10 + static_cast<Limb>(str[i] - '0');
+            scale *= 10;
+            if (scale == DECIMAL_CHUNK) {
+                mul_small_add(limbs, scale, chunk);
+                chunk = 0;
+                scale = 1;
             }
         }
-        
-        if (digits.empty()) {
-            digits.push_back(0);
+        if (scale > 1) {
+            mul_small_add(limbs, scale, chunk);
         }
-        
+
         remove_leading_zeros();
     }
-    
-    // 移除前导零
+
+    // 移除高位的零 limb；结果为零时清除符号
     void remove_leading_zeros() {
-        while (digits.size() > 1 && digits.back() == 0) {
-            digits.pop_back();
-        }
-        if (digits.size() == 1 && digits[0] == 0) {
+        trim(limbs);
+        if (limbs.empty()) {
             negative = false;
         }
     }
-    
+
     // 转换为字符串
     std::string to_string() const {
-        if (digits.size() == 1 && digits[0] == 0) {
+        if (is_zero()) {
             return "0";
         }
-        
+
         std::string result;
         if (negative) result += "-";
-        
-        for (int i = digits.size() - 1; i >= 0; i--) {
-            result += char('0' + digits[i]);
+        if (limbs.size() < TO_STRING_THRESHOLD) {
+            append_decimal_small(limbs, result, 0);
+            return result;
+        }
+
+        // 大数分治：powers[k] = 10^(9·2^k)，按最大的幂对半拆分，两半分别转换
+        BigInt magnitude = *this;
+        magnitude.negative = false;
+        std::vector<BigInt> powers{BigInt(static_cast<long long>(DECIMAL_CHUNK))};
+        while (compare_mag(powers.back().limbs, limbs) <= 0) {
+            powers.push_back(powers.back().square());
         }
-        
+        append_decimal(magnitude, powers.size() - 2, powers, result, 0);
         return result;
     }
-    
-    // 乘法
+
+    // 乘法：按操作数大小选择逐位相乘、Karatsuba、Toom-3 或数论变换（见 multiply）
     BigInt operator*(const BigInt& other) const {
         BigInt result;
-        result.digits.assign(digits.size() + other.digits.size(), 0);
-        result.negative = (negative != other.negative);
-        
-        for (size_t i = 0; i < digits.size(); i++) {
-            for (size_t j = 0; j < other.digits.size(); j++) {
-                result.digits[i + j] += digits[i] * other.digits[j];
-                if (result.digits[i + j] >= 10) {
-                    result.digits[i + j + 1] += result.digits[i + j] / 10;
-                    result.digits[i + j] %= 10;
-                }
-            }
+        if (is_zero() || other.is_zero()) {
+            return result;
         }
-        
-        result.remove_leading_zeros();
+        if (this == &other) {
+            return square();
+        }
+        multiply(limbs, other.limbs, result.limbs);
+        result.negative = (negative != other.negative);
+        return result;
+    }
+
+    // 平方：比 x * x 少约一半的 limb 乘法（大数时只需一次正变换）
+    BigInt square() const {
+        BigInt result;
+        square_mag(limbs, result.limbs);
         return result;
     }
 
@@ -118,14 +228,8 @@ public:
         if (negative == other.negative) {
             // 同号相加
             BigInt result;
+            add_mag(limbs, other.limbs, result.limbs);
             result.negative = negative;
-            result.digits.clear();
-            int carry = 0;
-            for (size_t i = 0; i < digits.size() || i < other.digits.size() || carry; ++i) {
-                int sum = carry + (i < digits.size() ? digits[i] : 0) + (i < other.digits.size() ? other.digits[i] : 0);
-                result.digits.push_back(sum % 10);
-                carry = sum / 10;
-            }
             result.remove_leading_zeros();
             return result;
         } else {
@@ -160,179 +264,243 @@ public:
         }
 
         BigInt result;
+        sub_mag(p1->limbs, p2->limbs, result.limbs);
         result.negative = result_negative;
-        result.digits.clear();
-        int borrow = 0;
-        for (size_t i = 0; i < p1->digits.size(); ++i) {
-            int diff = p1->digits[i] - (i < p2->digits.size() ? p2->digits[i] : 0) - borrow;
-            if (diff < 0) {
-                diff += 10;
-                borrow = 1;
-            } else {
-                borrow = 0;
-            }
-            result.digits.push_back(diff);
-        }
         result.remove_leading_zeros();
         return result;
     }
 
-    // 比较绝对值大小
-    static int abs_compare(const BigInt& a, const BigInt& b) {
-        if (a.digits.size() != b.digits.size()) {
-            return a.digits.size() < b.digits.size() ? -1 : 1;
+    // 复合赋值：就地修改，尽量复用已有的 limb 缓冲区
+    BigInt& operator+=(const BigInt& other) {
+        if (negative == other.negative) {
+            add_mag_inplace(limbs, other.limbs);
+        } else if (compare_mag(limbs, other.limbs) >= 0) {
+            sub_mag_inplace(limbs, other.limbs);
+        } else {
+            sub_mag_reverse(limbs, other.limbs);
+            negative = other.negative;
         }
-        for (int i = a.digits.size() - 1; i >= 0; --i) {
-            if (a.digits[i] != b.digits[i]) {
-                return a.digits[i] < b.digits[i] ? -1 : 1;
-            }
+        remove_leading_zeros();
+        return *this;
+    }
+
+    BigInt& operator-=(const BigInt& other) {
+        if (negative != other.negative) {
+            add_mag_inplace(limbs, other.limbs);
+        } else if (compare_mag(limbs, other.limbs) >= 0) {
+            sub_mag_inplace(limbs, other.limbs);
+        } else {
+            sub_mag_reverse(limbs, other.limbs);
+            negative = !negative;
         }
-        return 0;
+        remove_leading_zeros();
+        return *this;
+    }
+
+    BigInt& operator*=(const BigInt& other) {
+        if (other.limbs.size() == 1) {
+            mul_small_add(limbs, other.limbs[0], 0);
+            negative = negative != other.negative;
+            remove_leading_zeros();
+            return *this;
+        }
+        *this = *this * other;
+        return *this;
+    }
+
+    // 乘以机器整数：绝对值小于 2^32 时单趟就地完成，不构造临时 BigInt
+    BigInt& operator*=(long long m) {
+        unsigned long long mag = m < 0 ? 0ULL - static_cast<unsigned long long>(m) : static_cast<unsigned long long>(m);
+        if (mag > 0xFFFFFFFFULL) {
+            return *this *= BigInt(m);
+        }
+        mul_small_add(limbs, static_cast<Limb>(mag), 0);
+        if (m < 0) negative = !negative;
+        remove_leading_zeros();
+        return *this;
     }
-    
+
+    // 左操作数是临时值时直接在它的缓冲区上计算
+    friend BigInt operator+(BigInt&& a, const BigInt& b) {
+        a += b;
+        return std::move(a);
+    }
+
+    friend BigInt operator-(BigInt&& a, const BigInt& b) {
+        a -= b;
+        return std::move(a);
+    }
+
+    friend BigInt operator*(BigInt&& a, const BigInt& b) {
+        a *= b;
+        return std::move(a);
+    }
+
+    // 比较绝对值大小
+    static int abs_compare(const BigInt& a, const BigInt& b) {
+        return compare_mag(a.limbs, b.limbs);
+    }
+
     // 转换为int（如果可能）
     int to_int() const {
-        if (is_zero()) return 0;
-
-        if (digits.size() > 10) {  // 太大了
-            return negative ? INT_MIN : INT_MAX;
-        }
-        
-        long long result = 0;
-        
-        for (int i = digits.size() - 1; i >= 0; i--) {
-            result = result * 10 + digits[i];
-            if (!negative && result > INT_MAX) {
-                return INT_MAX;
-            }
-            // For negative numbers, the check is against -(long long)INT_MIN
-            if (negative && result > -(long long)INT_MIN) {
-                return INT_MIN;
-            }
-        }
-        
-        if (negative) {
-            long long neg_res = -result;
-            if (neg_res < INT_MIN) return INT_MIN;
-            return static_cast<int>(neg_res);
+        long long value = to_int64();
+        if (value > INT_MAX) return INT_MAX;
+        if (value < INT_MIN) return INT_MIN;
+        return static_cast<int>(value);
+    }
+
+    // 绝对值的二进制位数
+    size_t bit_length() const {
+        if (limbs.empty()) return 0;
+        return limbs.size() * LIMB_BITS - leading_zeros(limbs.back());
+    }
+
+    // 能否用 64 位有符号整数精确表示
+    bool fits_int64() const {
+        if (limbs.size() <= 1) return true;
+        if (limbs.size() > 2) return false;
+        // 绝对值不超过 2^63 - 1（负数为 2^63）
+        unsigned long long mag = magnitude64();
+        return negative ? mag <= (1ULL << 63) : mag < (1ULL << 63);
+    }
+
+    // 转换为 64 位整数，超出范围时取边界值
+    long long to_int64() const {
+        if (!fits_int64()) return negative ? LLONG_MIN : LLONG_MAX;
+        unsigned long long mag = magnitude64();
+        return negative ? static_cast<long long>(0ULL - mag) : static_cast<long long>(mag);
+    }
+
+    double to_double() const {
+        double result = 0.0;
+        for (size_t i = limbs.size(); i-- > 0;) {
+            result = result * 4294967296.0 + limbs[i];
         }
-        
-        return static_cast<int>(result);
+        return negative ? -result : result;
     }
-    
+
     // 检查是否为零
     bool is_zero() const {
-        return digits.size() == 1 && digits[0] == 0;
+        return limbs.empty();
     }
-    
-    // 除法（整数除法）
-    BigInt operator/(const BigInt& other) const {
+
+    // 同时求商与余数：商向零取整，余数与被除数同号（与 / 和 % 一致）
+    std::pair<BigInt, BigInt> divmod(const BigInt& other) const {
         if (other.is_zero()) {
             throw std::runtime_error("Division by zero");
         }
-        
-        if (is_zero()) {
-            return BigInt(0);
-        }
-        
-        // 使用长除法算法
-        BigInt dividend = *this;
-        dividend.negative = false;
-        BigInt divisor = other;
-        divisor.negative = false;
-        
-        if (abs_compare(dividend, divisor) < 0) {
-            return BigInt(0);
-        }
-        
-        BigInt quotient;
-        quotient.digits.clear();
-        
-        BigInt current(0);
-        for (int i = dividend.digits.size() - 1; i >= 0; i--) {
-            current.digits.insert(current.digits.begin(), dividend.digits[i]);
-            current.remove_leading_zeros();
-            
-            int count = 0;
-            while (abs_compare(current, divisor) >= 0) {
-                current = current - divisor;
-                count++;
-            }
-            quotient.digits.insert(quotient.digits.begin(), count);
-        }
-        
-        quotient.negative = (negative != other.negative);
-        quotient.remove_leading_zeros();
-        return quotient;
+
+        std::pair<BigInt, BigInt> result;
+        divide_mag(limbs, other.limbs, result.first.limbs, result.second.limbs);
+        result.first.negative = (negative != other.negative);
+        result.first.remove_leading_zeros();
+        result.second.negative = negative;
+        result.second.remove_leading_zeros();
+        return result;
     }
-    
-    // 取模运算
+
+    // 除法（整数除法，向零取整）
+    BigInt operator/(const BigInt& other) const {
+        return divmod(other).first;
+    }
+
+    // 取模运算：结果与被除数同号
     BigInt operator%(const BigInt& other) const {
         if (other.is_zero()) {
             throw std::runtime_error("Modulo by zero");
         }
-        
-        BigInt quotient = *this / other;
-        BigInt remainder = *this - (quotient * other);
-        return remainder;
+        return divmod(other).second;
     }
-    
+
     // 幂运算
     BigInt power(const BigInt& exponent) const {
         if (exponent.negative) {
             throw std::runtime_error("Negative exponent not supported for integer power");
         }
-        
+
         if (exponent.is_zero()) {
             return BigInt(1);
         }
-        
+
         if (is_zero()) {
             return BigInt(0);
         }
-        
+
+        // 从低到高逐位扫描指数
         BigInt result(1);
         BigInt base = *this;
-        BigInt exp = exponent;
-        
-        while (!exp.is_zero()) {
-            if (exp.digits[0] % 2 == 1) {  // 如果指数是奇数
-                result = result * base;
+        size_t bits = exponent.bit_length();
+        for (size_t bit = 0; bit < bits; ++bit) {
+            if (exponent.test_bit(bit)) {
+                result *= base;
+            }
+            if (bit + 1 < bits) {
+                base = base.square();
             }
-            base = base * base;
-            exp = exp / BigInt(2);
         }
-        
+
         return result;
     }
-    
-    // 阶乘
+
+    // 阶乘：按素因子分解 n! = ∏ p^e（指数由 Legendre 公式给出），再用平方与乘积树合成（见 prime_power_product）
     static BigInt factorial(const BigInt& n) {
         if (n.negative) {
             throw std::runtime_error("Factorial of negative number is undefined");
         }
-        
-        if (n.is_zero() || (n.digits.size() == 1 && n.digits[0] == 1)) {
-            return BigInt(1);
+        uint32_t m = combinatorial_argument(n, "Factorial");
+        std::vector<uint32_t> primes = primes_up_to(m);
+        std::vector<uint64_t> exponents(primes.size());
+        for (size_t i = 0; i < primes.size(); ++i) {
+            exponents[i] = legendre(m, primes[i]);
         }
-        
-        BigInt result(1);
-        BigInt current(1);
-        
-        while (abs_compare(current, n) <= 0) {
-            result = result * current;
-            current = current + BigInt(1);
+        return prime_power_product(primes, exponents);
+    }
+
+    // 二项式系数 C(n, k)：各素数指数为 e(n) - e(k) - e(n-k)；k < 0 或 k > n 时为 0
+    static BigInt binomial(const BigInt& n, const BigInt& k) {
+        if (n.negative) {
+            throw std::runtime_error("Binomial coefficient of negative number is undefined");
         }
-        
-        return result;
+        if (k.negative || k > n) {
+            return BigInt();
+        }
+        uint32_t nn = combinatorial_argument(n, "Binomial");
+        uint32_t kk = static_cast<uint32_t>(k.to_int64());
+        std::vector<uint32_t> primes = primes_up_to(nn);
+        std::vector<uint64_t> exponents(primes.size());
+        for (size_t i = 0; i < primes.size(); ++i) {
+            exponents[i] = legendre(nn, primes[i]) - legendre(kk, primes[i]) - legendre(nn - kk, primes[i]);
+        }
+        return prime_power_product(primes, exponents);
     }
-    
+
+    // 多项式系数 (k1 + ... + km)! / (k1! ... km!)，各 ki 非负
+    static BigInt multinomial(const std::vector<BigInt>& parts) {
+        BigInt total;
+        for (const BigInt& part : parts) {
+            if (part.negative) {
+                throw std::runtime_error("Multinomial coefficient of negative number is undefined");
+            }
+            total += part;
+        }
+        uint32_t nn = combinatorial_argument(total, "Multinomial");
+        std::vector<uint32_t> primes = primes_up_to(nn);
+        std::vector<uint64_t> exponents(primes.size());
+        for (size_t i = 0; i < primes.size(); ++i) {
+            exponents[i] = legendre(nn, primes[i]);
+            for (const BigInt& part : parts) {
+                exponents[i] -= legendre(static_cast<uint64_t>(part.to_int64()), primes[i]);
+            }
+        }
+        return prime_power_product(primes, exponents);
+    }
+
     // 比较运算符
     bool operator<(const BigInt& other) const {
         if (negative != other.negative) {
             return negative > other.negative;  // 负数小于正数
         }
-        
+
         if (negative) {
             // 两个都是负数，绝对值大的反而小
             return abs_compare(*this, other) > 0;
@@ -341,24 +509,798 @@ public:
             return abs_compare(*this, other) < 0;
         }
     }
-    
+
     bool operator<=(const BigInt& other) const {
         return *this < other || *this == other;
     }
-    
+
     bool operator>(const BigInt& other) const {
         return !(*this <= other);
     }
-    
+
     bool operator>=(const BigInt& other) const {
         return !(*this < other);
     }
-    
+
     bool operator==(const BigInt& other) const {
-        return negative == other.negative && digits == other.digits;
+        return negative == other.negative && limbs == other.limbs;
     }
-    
+
     bool operator!=(const BigInt& other) const {
         return !(*this == other);
     }
+
+private:
+    // 绝对值的低 64 位
+    unsigned long long magnitude64() const {
+        unsigned long long mag = 0;
+        if (limbs.size() > 0) mag = limbs[0];
+        if (limbs.size() > 1) mag |= static_cast<unsigned long long>(limbs[1]) << LIMB_BITS;
+        return mag;
+    }
+
+    bool test_bit(size_t bit) const {
+        size_t index = bit / LIMB_BITS;
+        return index < limbs.size() && ((limbs[index] >> (bit % LIMB_BITS)) & 1);
+    }
+
+    static void trim(Limbs& a) {
+        while (!a.empty() && a.back() == 0) {
+            a.pop_back();
+        }
+    }
+
+    static int compare_mag(const Limbs& a, const Limbs& b) {
+        if (a.size() != b.size()) {
+            return a.size() < b.size() ? -1 : 1;
+        }
+        for (size_t i = a.size(); i-- > 0;) {
+            if (a[i] != b[i]) {
+                return a[i] < b[i] ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+
+    // out = a + b
+    static void add_mag(const Limbs& a, const Limbs& b, Limbs& out) {
+        const Limbs& longer = a.size() >= b.size() ? a : b;
+        const Limbs& shorter = a.size() >= b.size() ? b : a;
+        out.resize(longer.size() + 1);
+        Wide carry = 0;
+        for (size_t i = 0; i < longer.size(); ++i) {
+            Wide sum = carry + longer[i] + (i < shorter.size() ? shorter[i] : 0);
+            out[i] = static_cast<Limb>(sum);
+            carry = sum >> LIMB_BITS;
+        }
+        out[longer.size()] = static_cast<Limb>(carry);
+        trim(out);
+    }
+
+    // out = a - b，要求 |a| >= |b|
+    static void sub_mag(const Limbs& a, const Limbs& b, Limbs& out) {
+        out.resize(a.size());
+        Limb borrow = 0;
+        for (size_t i = 0; i < a.size(); ++i) {
+            Wide sub = static_cast<Wide>(i < b.size() ? b[i] : 0) + borrow;
+            borrow = a[i] < sub ? 1 : 0;
+            out[i] = static_cast<Limb>(a[i] - sub);
+        }
+        trim(out);
+    }
+
+    // a += b（绝对值）
+    static void add_mag_inplace(Limbs& a, const Limbs& b) {
+        if (&a == &b) {
+            Limbs copy = b;
+            add_mag_inplace(a, copy);
+            return;
+        }
+        if (a.size() < b.size()) a.resize(b.size());
+        Wide carry = 0;
+        for (size_t i = 0; i < a.size() && (carry || i < b.size()); ++i) {
+            Wide sum = carry + a[i] + (i < b.size() ? b[i] : 0);
+            a[i] = static_cast<Limb>(sum);
+            carry = sum >> LIMB_BITS;
+        }
+        if (carry) a.push_back(static_cast<Limb>(carry));
+    }
+
+    // a -= b，要求 |a| >= |b|
+    static void sub_mag_inplace(Limbs& a, const Limbs& b) {
+        Limb borrow = 0;
+        for (size_t i = 0; i < a.size() && (borrow || i < b.size()); ++i) {
+            Wide sub = static_cast<Wide>(i < b.size() ? b[i] : 0) + borrow;
+            borrow = a[i] < sub ? 1 : 0;
+            a[i] = static_cast<Limb>(a[i] - sub);
+        }
+        trim(a);
+    }
+
+    // a = b - a，要求 |b| > |a|
+    static void sub_mag_reverse(Limbs& a, const Limbs& b) {
+        size_t old_size = a.size();
+        a.resize(b.size());
+        Limb borrow = 0;
+        for (size_t i = 0; i < b.size(); ++i) {
+            Wide sub = static_cast<Wide>(i < old_size ? a[i] : 0) + borrow;
+            borrow = b[i] < sub ? 1 : 0;
+            a[i] = static_cast<Limb>(b[i] - sub);
+        }
+        trim(a);
+    }
+
+    // ---- 阶乘与组合数 ----
+    // 乘积树叶子上的素数个数：叶子内逐个就地乘以单 limb，再向上两两相乘，使各层乘法的两个操作数长度相近
+    static constexpr size_t PRODUCT_TREE_LEAF = 16;
+
+    // 组合函数的参数须不超过 2^32 - 1（结果已远超内存可容纳的规模）
+    static uint32_t combinatorial_argument(const BigInt& n, const char* what) {
+        if (n.limbs.size() > 1) {
+            throw std::runtime_error(std::string(what) + " argument too large");
+        }
+        return n.limbs.empty() ? 0 : n.limbs[0];
+    }
+
+    // 不超过 n 的全部素数（只筛奇数的埃拉托斯特尼筛法）
+    static std::vector<uint32_t> primes_up_to(uint32_t n) {
+        std::vector<uint32_t> primes;
+        if (n < 2) return primes;
+        primes.push_back(2);
+        // composite[i] 对应奇数 2i + 1
+        std::vector<bool> composite(n / 2 + 1, false);
+        for (uint64_t i = 1; 2 * i + 1 <= n; ++i) {
+            if (composite[i]) continue;
+            uint64_t p = 2 * i + 1;
+            primes.push_back(static_cast<uint32_t>(p));
+            for (uint64_t j = p * p; j <= n; j += 2 * p) {
+                composite[j / 2] = true;
+            }
+        }
+        return primes;
+    }
+
+    // n! 中素数 p 的指数：n/p + n/p^2 + ...（Legendre 公式）
+    static uint64_t legendre(uint64_t n, uint64_t p) {
+        uint64_t e = 0;
+        while (n >= p) {
+            n /= p;
+            e += n;
+        }
+        return e;
+    }
+
+    // factors[lo, hi) 之积
+    static BigInt product_tree(const std::vector<uint32_t>& factors, size_t lo, size_t hi) {
+        if (hi - lo <= PRODUCT_TREE_LEAF) {
+            BigInt result(1);
+            for (size_t i = lo; i < hi; ++i) {
+                mul_small_add(result.limbs, factors[i], 0);
+            }
+            return result;
+        }
+        size_t mid = lo + (hi - lo) / 2;
+        return product_tree(factors, lo, mid) * product_tree(factors, mid, hi);
+    }
+
+    // ∏ primes[i]^exponents[i]。2 的幂最后整体左移；其余素数按指数的二进制位分组，
+    // 从最高位起 result = result^2 · (该位为 1 的素数之积)，大部分工作落在平方上
+    static BigInt prime_power_product(const std::vector<uint32_t>& primes, const std::vector<uint64_t>& exponents) {
+        uint64_t twos = 0, max_exponent = 0;
+        for (size_t i = 0; i < primes.size(); ++i) {
+            if (primes[i] == 2) {
+                twos = exponents[i];
+            } else {
+                max_exponent = std::max(max_exponent, exponents[i]);
+            }
+        }
+
+        BigInt result(1);
+        std::vector<uint32_t> group;
+        for (int bit = 63; bit >= 0; --bit) {
+            if ((max_exponent >> bit) == 0) continue;
+            if (!result.is_one()) {
+                result = result.square();
+            }
+            group.clear();
+            for (size_t i = 0; i < primes.size(); ++i) {
+                if (primes[i] != 2 && ((exponents[i] >> bit) & 1)) {
+                    group.push_back(primes[i]);
+                }
+            }
+            if (!group.empty()) {
+                result *= product_tree(group, 0, group.size());
+            }
+        }
+
+        // 乘以 2^twos
+        if (twos > 0) {
+            BigInt shifted;
+            shifted.limbs = shift_left_bits(result.limbs, static_cast<int>(twos % LIMB_BITS));
+            result = join(shifted, BigInt(), static_cast<size_t>(twos / LIMB_BITS));
+        }
+        return result;
+    }
+
+    bool is_one() const {
+        return !negative && limbs.size() == 1 && limbs[0] == 1;
+    }
+
+    // ---- 乘法引擎 ----
+    // 较短操作数不足 KARATSUBA_THRESHOLD 个 limb 时逐位相乘；两数相差一倍以上时把长者按短者长度分段；
+    // 其余按长度依次使用 Karatsuba、Toom-3 与三模数 NTT。阈值（单位 limb）按 x86-64 上的实测选取，
+    // NTT 的变换长度按 2 的幂取整，刚越过 2 的幂时代价会翻倍，所以门槛取得偏高
+    static constexpr size_t KARATSUBA_THRESHOLD = 64;
+    static constexpr size_t TOOM3_THRESHOLD = 160;
+    static constexpr size_t NTT_THRESHOLD = 4000;
+
+    // out = a * b
+    static void multiply(const Limbs& a, const Limbs& b, Limbs& out) {
+        const Limbs& x = a.size() >= b.size() ? a : b;  // 较长者
+        const Limbs& y = a.size() >= b.size() ? b : a;
+        if (y.size() < KARATSUBA_THRESHOLD) {
+            mul_schoolbook(x, y, out);
+        } else if (y.size() >= NTT_THRESHOLD && ntt_fits(x.size(), y.size())) {
+            mul_ntt(x, y, out);
+        } else if (x.size() >= 2 * y.size()) {
+            mul_unbalanced(x, y, out);
+        } else if (y.size() < TOOM3_THRESHOLD) {
+            mul_karatsuba(x, y, out);
+        } else {
+            mul_toom3(x, y, out);
+        }
+    }
+
+    // out = a * a
+    static void square_mag(const Limbs& a, Limbs& out) {
+        if (a.size() < KARATSUBA_THRESHOLD) {
+            sqr_schoolbook(a, out);
+        } else if (a.size() >= NTT_THRESHOLD && ntt_fits(a.size(), a.size())) {
+            mul_ntt(a, a, out);
+        } else if (a.size() < TOOM3_THRESHOLD) {
+            mul_karatsuba(a, a, out);
+        } else {
+            mul_toom3(a, a, out);
+        }
+    }
+
+    // 子乘积：同一对象按平方计算
+    static BigInt product(const BigInt& x, const BigInt& y) {
+        return &x == &y ? x.square() : x * y;
+    }
+
+    // 由 limbs[from, from + count) 组成的非负数
+    static BigInt slice(const Limbs& a, size_t from, size_t count) {
+        BigInt result;
+        if (from < a.size()) {
+            size_t end = std::min(a.size(), from + count);
+            result.limbs.assign(a.begin() + from, a.begin() + end);
+            trim(result.limbs);
+        }
+        return result;
+    }
+
+    // out[shift..] += x（x 非负，out 已有足够空间）
+    static void add_shifted(Limbs& out, const Limbs& x, size_t shift) {
+        Wide carry = 0;
+        size_t i = 0;
+        for (; i < x.size(); ++i) {
+            Wide sum = static_cast<Wide>(out[shift + i]) + x[i] + carry;
+            out[shift + i] = static_cast<Limb>(sum);
+            carry = sum >> LIMB_BITS;
+        }
+        for (size_t k = shift + i; carry && k < out.size(); ++k) {
+            Wide sum = static_cast<Wide>(out[k]) + carry;
+            out[k] = static_cast<Limb>(sum);
+            carry = sum >> LIMB_BITS;
+        }
+    }
+
+    // 逐位相乘（64 位中间结果不会溢出：(2^32-1)^2 + 2(2^32-1) = 2^64-1）
+    static void mul_schoolbook(const Limbs& a, const Limbs& b, Limbs& out) {
+        out.assign(a.size() + b.size(), 0);
+        for (size_t i = 0; i < a.size(); ++i) {
+            Wide carry = 0;
+            Wide ai = a[i];
+            for (size_t j = 0; j < b.size(); ++j) {
+                Wide t = ai * b[j] + out[i + j] + carry;
+                out[i + j] = static_cast<Limb>(t);
+                carry = t >> LIMB_BITS;
+            }
+            out[i + b.size()] = static_cast<Limb>(carry);
+        }
+        trim(out);
+    }
+
+    // 逐位平方：交叉项只算一次再乘 2，最后加上各 limb 的平方
+    static void sqr_schoolbook(const Limbs& a, Limbs& out) {
+        size_t n = a.size();
+        out.assign(2 * n, 0);
+        for (size_t i = 0; i < n; ++i) {
+            Wide carry = 0;
+            Wide ai = a[i];
+            for (size_t j = i + 1; j < n; ++j) {
+                Wide t = ai * a[j] + out[i + j] + carry;
+                out[i + j] = static_cast<Limb>(t);
+                carry = t >> LIMB_BITS;
+            }
+            out[i + n] = static_cast<Limb>(carry);
+        }
+        Limb top = 0;
+        for (size_t k = 0; k < 2 * n; ++k) {
+            Limb next = out[k] >> (LIMB_BITS - 1);
+            out[k] = (out[k] << 1) | top;
+            top = next;
+        }
+        Wide carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            Wide sq = static_cast<Wide>(a[i]) * a[i];
+            Wide lo = static_cast<Wide>(out[2 * i]) + static_cast<Limb>(sq) + carry;
+            out[2 * i] = static_cast<Limb>(lo);
+            Wide hi = static_cast<Wide>(out[2 * i + 1]) + (sq >> LIMB_BITS) + (lo >> LIMB_BITS);
+            out[2 * i + 1] = static_cast<Limb>(hi);
+            carry = hi >> LIMB_BITS;
+        }
+        trim(out);
+    }
+
+    // 长者按短者长度分段相乘再错位相加（x.size() >= y.size()）
+    static void mul_unbalanced(const Limbs& x, const Limbs& y, Limbs& out) {
+        out.assign(x.size() + y.size(), 0);
+        Limbs part;
+        for (size_t from = 0; from < x.size(); from += y.size()) {
+            BigInt chunk = slice(x, from, y.size());
+            if (chunk.is_zero()) continue;
+            multiply(chunk.limbs, y, part);
+            add_shifted(out, part, from);
+        }
+        trim(out);
+    }
+
+    // Karatsuba：a = a1·B^h + a0，b 同理；a·b = z2·B^2h + ((a0+a1)(b0+b1) - z0 - z2)·B^h + z0
+    static void mul_karatsuba(const Limbs& a, const Limbs& b, Limbs& out) {
+        bool sq = &a == &b;
+        size_t h = std::max(a.size(), b.size()) / 2;
+        BigInt a0 = slice(a, 0, h), a1 = slice(a, h, a.size());
+        BigInt b0 = sq ? BigInt() : slice(b, 0, h), b1 = sq ? BigInt() : slice(b, h, b.size());
+        const BigInt& lo = sq ? a0 : b0;
+        const BigInt& hi = sq ? a1 : b1;
+
+        BigInt z0 = product(a0, lo);
+        BigInt z2 = product(a1, hi);
+        BigInt sa = a0 + a1;
+        BigInt z1 = sq ? sa.square() : sa * (b0 + b1);
+        z1 -= z0;
+        z1 -= z2;
+
+        out.assign(a.size() + b.size() + 1, 0);
+        add_shifted(out, z0.limbs, 0);
+        add_shifted(out, z1.limbs, h);
+        add_shifted(out, z2.limbs, 2 * h);
+        trim(out);
+    }
+
+    // Toom-3：各分为三段，在 0、1、-1、-2、∞ 处求值相乘，再按 Bodrato 的顺序插值
+    static void mul_toom3(const Limbs& a, const Limbs& b, Limbs& out) {
+        bool sq = &a == &b;
+        size_t k = (std::max(a.size(), b.size()) + 2) / 3;
+
+        BigInt a0 = slice(a, 0, k), a1 = slice(a, k, k), a2 = slice(a, 2 * k, k);
+        BigInt pa = a0 + a2;
+        BigInt a_1 = pa + a1, a_m1 = pa - a1;
+        BigInt a_m2 = (a_m1 + a2) + (a_m1 + a2) - a0;
+
+        BigInt r0, r1, rm1, rm2, rinf;
+        if (sq) {
+            r0 = a0.square();
+            r1 = a_1.square();
+            rm1 = a_m1.square();
+            rm2 = a_m2.square();
+            rinf = a2.square();
+        } else {
+            BigInt b0 = slice(b, 0, k), b1 = slice(b, k, k), b2 = slice(b, 2 * k, k);
+            BigInt pb = b0 + b2;
+            BigInt b_1 = pb + b1, b_m1 = pb - b1;
+            BigInt b_m2 = (b_m1 + b2) + (b_m1 + b2) - b0;
+            r0 = a0 * b0;
+            r1 = a_1 * b_1;
+            rm1 = a_m1 * b_m1;
+            rm2 = a_m2 * b_m2;
+            rinf = a2 * b2;
+        }
+
+        // 插值得到乘积多项式的系数 c0..c4（均为非负数）
+        BigInt c3 = rm2 - r1;
+        divmod_small(c3.limbs, 3);
+        BigInt c1 = r1 - rm1;
+        shift_right_one(c1.limbs);
+        BigInt c2 = rm1 - r0;
+        c3 = c2 - c3;
+        shift_right_one(c3.limbs);
+        c3 += rinf;
+        c3 += rinf;
+        c2 += c1;
+        c2 -= rinf;
+        c1 -= c3;
+
+        out.assign(a.size() + b.size() + 1, 0);
+        add_shifted(out, r0.limbs, 0);
+        add_shifted(out, c1.limbs, k);
+        add_shifted(out, c2.limbs, 2 * k);
+        add_shifted(out, c3.limbs, 3 * k);
+        add_shifted(out, rinf.limbs, 4 * k);
+        trim(out);
+    }
+
+    // a >>= 1
+    static void shift_right_one(Limbs& a) {
+        for (size_t i = 0; i < a.size(); ++i) {
+            a[i] = (a[i] >> 1) | (i + 1 < a.size() ? (a[i + 1] << (LIMB_BITS - 1)) : 0);
+        }
+        trim(a);
+    }
+
+    // ---- 数论变换（NTT）乘法 ----
+    // 在三个形如 c·2^k+1 的素数下分别做卷积，再用中国剩余定理还原每个系数。
+    // 系数上界为 min(n, m)·(2^32-1)^2，须小于三素数之积（约 2^86）；变换长度受限于 2^23
+    static constexpr uint32_t NTT_PRIMES[3] = {998244353u, 167772161u, 469762049u};  // 原根均为 3
+    static constexpr size_t NTT_MAX_LENGTH = size_t(1) << 23;
+
+    static bool ntt_fits(size_t n, size_t m) {
+        return n + m <= NTT_MAX_LENGTH && std::min(n, m) < (size_t(1) << 22);
+    }
+
+    static uint32_t pow_mod(uint64_t base, uint64_t exp, uint32_t mod) {
+        uint64_t result = 1;
+        base %= mod;
+        while (exp) {
+            if (exp & 1) result = result * base % mod;
+            base = base * base % mod;
+            exp >>= 1;
+        }
+        return static_cast<uint32_t>(result);
+    }
+
+    // 原地变换，长度为 2 的幂；invert 时为逆变换（含除以长度）。
+    // 模数作为模板参数，取模可由编译器化为乘法
+    template <uint32_t mod>
+    static void ntt(std::vector<uint32_t>& f, bool invert) {
+        size_t n = f.size();
+        for (size_t i = 1, j = 0; i < n; ++i) {
+            size_t bit = n >> 1;
+            for (; j & bit; bit >>= 1) j ^= bit;
+            j ^= bit;
+            if (i < j) std::swap(f[i], f[j]);
+        }
+        std::vector<uint32_t> roots(n / 2);
+        for (size_t len = 2; len <= n; len <<= 1) {
+            uint32_t w = pow_mod(3, (mod - 1) / len, mod);
+            if (invert) w = pow_mod(w, mod - 2, mod);
+            size_t half = len / 2;
+            roots[0] = 1;
+            for (size_t k = 1; k < half; ++k) roots[k] = static_cast<uint32_t>(uint64_t(roots[k - 1]) * w % mod);
+            for (size_t i = 0; i < n; i += len) {
+                for (size_t k = 0; k < half; ++k) {
+                    uint32_t u = f[i + k];
+                    uint32_t v = static_cast<uint32_t>(uint64_t(f[i + k + half]) * roots[k] % mod);
+                    f[i + k] = u + v >= mod ? u + v - mod : u + v;
+                    f[i + k + half] = u >= v ? u - v : u + mod - v;
+                }
+            }
+        }
+        if (invert) {
+            uint64_t inv_n = pow_mod(n, mod - 2, mod);
+            for (auto& x : f) x = static_cast<uint32_t>(x * inv_n % mod);
+        }
+    }
+
+    // a 与 b 在模 mod 下的循环卷积（长度 n）
+    template <uint32_t mod>
+    static std::vector<uint32_t> convolve(const Limbs& a, const Limbs& b, size_t n) {
+        std::vector<uint32_t> fa(n, 0);
+        for (size_t i = 0; i < a.size(); ++i) fa[i] = a[i] % mod;
+        ntt<mod>(fa, false);
+        if (&a == &b) {
+            for (auto& x : fa) x = static_cast<uint32_t>(uint64_t(x) * x % mod);
+        } else {
+            std::vector<uint32_t> fb(n, 0);
+            for (size_t i = 0; i < b.size(); ++i) fb[i] = b[i] % mod;
+            ntt<mod>(fb, false);
+            for (size_t i = 0; i < n; ++i) fa[i] = static_cast<uint32_t>(uint64_t(fa[i]) * fb[i] % mod);
+        }
+        ntt<mod>(fa, true);
+        return fa;
+    }
+
+    static void mul_ntt(const Limbs& a, const Limbs& b, Limbs& out) {
+        size_t n = 1;
+        while (n < a.size() + b.size()) n <<= 1;
+        const uint32_t p1 = NTT_PRIMES[0], p2 = NTT_PRIMES[1], p3 = NTT_PRIMES[2];
+        std::vector<uint32_t> c1 = convolve<NTT_PRIMES[0]>(a, b, n);
+        std::vector<uint32_t> c2 = convolve<NTT_PRIMES[1]>(a, b, n);
+        std::vector<uint32_t> c3 = convolve<NTT_PRIMES[2]>(a, b, n);
+
+        // 系数 x = t1 + p1·(t2 + p2·t3)，其中 t1 < p1、t2 < p2、t3 < p3（Garner 算法）
+        const uint64_t inv_p1_mod_p2 = pow_mod(p1, p2 - 2, p2);
+        const uint64_t inv_p1p2_mod_p3 = pow_mod(uint64_t(p1) * p2 % p3, p3 - 2, p3);
+        const uint64_t p1_mod_p3 = p1 % p3;
+
+        out.assign(a.size() + b.size(), 0);
+        Wide carry = 0;  // 始终小于 2^56
+        for (size_t i = 0; i < out.size(); ++i) {
+            uint64_t t1 = c1[i];
+            uint64_t t2 = (c2[i] + p2 - t1 % p2) % p2 * inv_p1_mod_p2 % p2;
+            uint64_t x12 = (t1 + p1_mod_p3 * t2) % p3;
+            uint64_t t3 = (c3[i] + p3 - x12) % p3 * inv_p1p2_mod_p3 % p3;
+            // x = t1 + p1·y，y = t2 + p2·t3 < 2^57；按 y 的高低 32 位拆开相乘
+            uint64_t y = t2 + uint64_t(p2) * t3;
+            uint64_t low = uint64_t(p1) * (y & 0xFFFFFFFFu) + t1;   // < 2^63
+            uint64_t mid = uint64_t(p1) * (y >> LIMB_BITS);         // 乘以 2^32 的部分，< 2^55
+            Wide sum = low + carry;
+            out[i] = static_cast<Limb>(sum);
+            carry = (sum >> LIMB_BITS) + mid;
+        }
+        trim(out);
+    }
+
+    // a = a * m + add
+    static void mul_small_add(Limbs& a, Limb m, Limb add) {
+        Wide carry = add;
+        for (auto& limb : a) {
+            Wide t = static_cast<Wide>(limb) * m + carry;
+            limb = static_cast<Limb>(t);
+            carry = t >> LIMB_BITS;
+        }
+        if (carry) a.push_back(static_cast<Limb>(carry));
+    }
+
+    // a = a / d，返回余数
+    static Limb divmod_small(Limbs& a, Limb d) {
+        Wide rem = 0;
+        for (size_t i = a.size(); i-- > 0;) {
+            Wide cur = (rem << LIMB_BITS) | a[i];
+            a[i] = static_cast<Limb>(cur / d);
+            rem = cur % d;
+        }
+        trim(a);
+        return static_cast<Limb>(rem);
+    }
+
+    static int leading_zeros(Limb x) {
+        int n = 0;
+        while (!(x & 0x80000000u)) {
+            x <<= 1;
+            ++n;
+        }
+        return n;
+    }
+
+    // ---- 除法引擎 ----
+    // 除数与商都达到 BURNIKEL_ZIEGLER_THRESHOLD 个 limb 时使用 Burnikel-Ziegler 递归除法，
+    // 其余使用 Knuth 算法 D（单 limb 除数走短除法）。to_string 在 TO_STRING_THRESHOLD 个 limb 以上分治转换
+    static constexpr size_t BURNIKEL_ZIEGLER_THRESHOLD = 40;
+    static constexpr size_t TO_STRING_THRESHOLD = 60;
+
+    // q = a / b，r = a % b（绝对值）；b 非零
+    static void divide_mag(const Limbs& a, const Limbs& b, Limbs& q, Limbs& r) {
+        if (compare_mag(a, b) < 0) {
+            q.clear();
+            r = a;
+            return;
+        }
+        if (b.size() == 1) {
+            q = a;
+            Limb rem = divmod_small(q, b[0]);
+            r.clear();
+            if (rem) r.push_back(rem);
+            return;
+        }
+        if (b.size() >= BURNIKEL_ZIEGLER_THRESHOLD && a.size() - b.size() >= BURNIKEL_ZIEGLER_THRESHOLD) {
+            divide_bz(a, b, q, r);
+        } else {
+            divide_knuth(a, b, q, r);
+        }
+    }
+
+    // Knuth 算法 D；要求 a >= b 且 b 至少两个 limb
+    static void divide_knuth(const Limbs& a, const Limbs& b, Limbs& q, Limbs& r) {
+        // 规格化：左移使除数最高位 limb 的最高位为 1，试商最多偏大 2
+        size_t n = b.size(), m = a.size() - n;
+        int s = leading_zeros(b.back());
+        Limbs v(n), u(a.size() + 1);
+        for (size_t i = n - 1; i > 0; --i) {
+            v[i] = (b[i] << s) | (s ? static_cast<Limb>(static_cast<Wide>(b[i - 1]) >> (LIMB_BITS - s)) : 0);
+        }
+        v[0] = b[0] << s;
+        u[a.size()] = s ? static_cast<Limb>(static_cast<Wide>(a.back()) >> (LIMB_BITS - s)) : 0;
+        for (size_t i = a.size() - 1; i > 0; --i) {
+            u[i] = (a[i] << s) | (s ? static_cast<Limb>(static_cast<Wide>(a[i - 1]) >> (LIMB_BITS - s)) : 0);
+        }
+        u[0] = a[0] << s;
+
+        const Wide base = Wide(1) << LIMB_BITS;
+        q.assign(m + 1, 0);
+        for (size_t j = m + 1; j-- > 0;) {
+            // 用被除数的最高两个 limb 估计商，再用除数次高位修正
+            Wide num = (static_cast<Wide>(u[j + n]) << LIMB_BITS) | u[j + n - 1];
+            Wide qhat = num / v[n - 1];
+            Wide rhat = num % v[n - 1];
+            while (qhat >= base || qhat * v[n - 2] > ((rhat << LIMB_BITS) | u[j + n - 2])) {
+                --qhat;
+                rhat += v[n - 1];
+                if (rhat >= base) break;
+            }
+
+            // u[j..j+n] -= qhat * v
+            Wide carry = 0;
+            Limb borrow = 0;
+            for (size_t i = 0; i < n; ++i) {
+                Wide p = qhat * v[i] + carry;
+                carry = p >> LIMB_BITS;
+                Wide sub = (p & 0xFFFFFFFFu) + borrow;
+                borrow = u[i + j] < sub ? 1 : 0;
+                u[i + j] = static_cast<Limb>(u[i + j] - sub);
+            }
+            Wide sub = carry + borrow;
+            bool overshoot = u[j + n] < sub;
+            u[j + n] = static_cast<Limb>(u[j + n] - sub);
+
+            // 试商偏大 1（概率约 2/2^32）：加回一次除数
+            if (overshoot) {
+                --qhat;
+                Wide c = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    Wide sum = static_cast<Wide>(u[i + j]) + v[i] + c;
+                    u[i + j] = static_cast<Limb>(sum);
+                    c = sum >> LIMB_BITS;
+                }
+                u[j + n] = static_cast<Limb>(u[j + n] + c);
+            }
+            q[j] = static_cast<Limb>(qhat);
+        }
+
+        // 余数右移还原
+        r.resize(n);
+        for (size_t i = 0; i < n; ++i) {
+            r[i] = (u[i] >> s) | (s ? static_cast<Limb>(static_cast<Wide>(u[i + 1]) << (LIMB_BITS - s)) : 0);
+        }
+        trim(q);
+        trim(r);
+    }
+
+    // a 左移 s 位（0 <= s < 32）
+    static Limbs shift_left_bits(const Limbs& a, int s) {
+        Limbs out(a.size() + 1, 0);
+        for (size_t i = 0; i < a.size(); ++i) {
+            Wide t = static_cast<Wide>(a[i]) << s;
+            out[i] |= static_cast<Limb>(t);
+            out[i + 1] = static_cast<Limb>(t >> LIMB_BITS);
+        }
+        trim(out);
+        return out;
+    }
+
+    // a 右移 s 位（0 <= s < 32）
+    static Limbs shift_right_bits(const Limbs& a, int s) {
+        Limbs out(a.size());
+        for (size_t i = 0; i < a.size(); ++i) {
+            Wide t = (i + 1 < a.size() ? static_cast<Wide>(a[i + 1]) << LIMB_BITS : 0) | a[i];
+            out[i] = static_cast<Limb>(t >> s);
+        }
+        trim(out);
+        return out;
+    }
+
+    // hi·B^n + lo（B = 2^32，lo < B^n）
+    static BigInt join(const BigInt& hi, const BigInt& lo, size_t n) {
+        BigInt result;
+        if (hi.is_zero()) {
+            result.limbs = lo.limbs;
+            return result;
+        }
+        result.limbs.assign(n + hi.limbs.size(), 0);
+        std::copy(lo.limbs.begin(), lo.limbs.end(), result.limbs.begin());
+        std::copy(hi.limbs.begin(), hi.limbs.end(), result.limbs.begin() + n);
+        return result;
+    }
+
+    // Burnikel-Ziegler：把 b 规格化后，将 a 按 b 的长度分块，从高到低逐块做 2n/n 递归除法
+    static void divide_bz(const Limbs& a, const Limbs& b, Limbs& q, Limbs& r) {
+        int s = leading_zeros(b.back());
+        BigInt bn, an;
+        bn.limbs = shift_left_bits(b, s);
+        an.limbs = shift_left_bits(a, s);
+        size_t n = bn.limbs.size();
+        size_t blocks = (an.limbs.size() + n - 1) / n;
+
+        q.assign(blocks * n, 0);
+        BigInt rem, qi, ri;
+        for (size_t i = blocks; i-- > 0;) {
+            // 余数小于 b，所以 rem·B^n + 当前块 < B^n·b，满足 2n/n 除法的前提
+            div_two_by_one(join(rem, slice(an.limbs, i * n, n), n), bn, n, qi, ri);
+            std::copy(qi.limbs.begin(), qi.limbs.end(), q.begin() + i * n);
+            rem = std::move(ri);
+        }
+        trim(q);
+        r = shift_right_bits(rem.limbs, s);
+    }
+
+    // 2n/n 除法：b 恰有 n 个 limb 且已规格化，a < B^n·b；q = a / b，r = a % b
+    static void div_two_by_one(const BigInt& a, const BigInt& b, size_t n, BigInt& q, BigInt& r) {
+        if (n < BURNIKEL_ZIEGLER_THRESHOLD) {
+            divide_mag(a.limbs, b.limbs, q.limbs, r.limbs);
+            q.negative = r.negative = false;
+            return;
+        }
+        if (n % 2 != 0) {
+            // 奇数长度：a、b 同乘 B 变为偶数长度，余数再除回 B
+            BigInt a2 = join(a, BigInt(), 1), b2 = join(b, BigInt(), 1);
+            div_two_by_one(a2, b2, n + 1, q, r);
+            r = slice(r.limbs, 1, r.limbs.size());
+            return;
+        }
+        size_t h = n / 2;
+        BigInt b1 = slice(b.limbs, h, h), b2 = slice(b.limbs, 0, h);
+        BigInt q1, q2, r1;
+        div_three_by_two(slice(a.limbs, n, a.limbs.size()), slice(a.limbs, h, h), b, b1, b2, h, q1, r1);
+        div_three_by_two(r1, slice(a.limbs, 0, h), b, b1, b2, h, q2, r);
+        q = join(q1, q2, h);
+    }
+
+    // 3n/2n 除法：被除数为 a12·B^n + a3，b = b1·B^n + b2，a12 < B^n·b1；q = 商，r = 余数
+    static void div_three_by_two(const BigInt& a12, const BigInt& a3, const BigInt& b, const BigInt& b1,
+                                 const BigInt& b2, size_t n, BigInt& q, BigInt& r) {
+        BigInt r1;
+        if (compare_mag(slice(a12.limbs, n, a12.limbs.size()).limbs, b1.limbs) == 0) {
+            // 商的估计值取 B^n - 1
+            q.limbs.assign(n, ~Limb(0));
+            q.negative = false;
+            r1 = a12 - join(b1, BigInt(), n) + b1;
+        } else {
+            div_two_by_one(a12, b1, n, q, r1);
+        }
+        // 估计值至多偏大 2，余数为负时修正
+        r = join(r1, a3, n) - q * b2;
+        while (r.negative) {
+            q -= BigInt(1);
+            r += b;
+        }
+    }
+
+    // 把小于 TO_STRING_THRESHOLD 个 limb 的数转换为十进制追加到 out，width 非零时左侧补零到 width 位
+    static void append_decimal_small(const Limbs& a, std::string& out, size_t width) {
+        // 反复除以 10^9，得到从低到高的 9 位十进制块
+        Limbs rest = a;
+        std::vector<Limb> chunks;
+        while (!rest.empty()) {
+            chunks.push_back(divmod_small(rest, DECIMAL_CHUNK));
+        }
+
+        std::string digits = chunks.empty() ? std::string() : std::to_string(chunks.back());
+        for (size_t i = chunks.size(); i-- > 1;) {
+            std::string part = std::to_string(chunks[i - 1]);
+            digits.append(DECIMAL_CHUNK_DIGITS - part.size(), '0');
+            digits += part;
+        }
+        if (digits.empty() && width == 0) digits = "0";
+        if (digits.size() < width) out.append(width - digits.size(), '0');
+        out += digits;
+    }
+
+    // 把非负数 x（x < powers[k + 1]）转换为十进制追加到 out，width 含义同上
+    static void append_decimal(const BigInt& x, size_t k, const std::vector<BigInt>& powers, std::string& out,
+                               size_t width) {
+        if (x.limbs.size() < TO_STRING_THRESHOLD) {
+            append_decimal_small(x.limbs, out, width);
+            return;
+        }
+        // 最高位一段不补零，跳过比 x 还大的幂，避免输出前导零
+        while (width == 0 && k > 0 && compare_mag(x.limbs, powers[k].limbs) < 0) {
+            --k;
+        }
+        std::pair<BigInt, BigInt> parts = x.divmod(powers[k]);
+        size_t low_digits = static_cast<size_t>(DECIMAL_CHUNK_DIGITS) << k;
+        append_decimal(parts.first, k - 1, powers, out, width > low_digits ? width - low_digits : 0);
+        append_decimal(parts.second, k - 1, powers, out, low_digits);
+    }
 };
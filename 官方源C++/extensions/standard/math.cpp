@@ -11,7 +11,7 @@ inline Value sqrt(const std::vector<Value>& args) {
 
      // For exact square root representation
      if (args[0].is_int()) {
-          int val = std::get<int>(args[0].data);
+          int64_t val = args[0].get<int64_t>();
           if (val < 0) {
                std::cerr << "Error: sqrt() of negative number" << std::endl;
                return Value();
@@ -20,7 +20,9 @@ inline Value sqrt(const std::vector<Value>& args) {
                return Value(val);
           }
           // Check if it's a perfect square
-          int sqrt_val = static_cast<int>(std::sqrt(val));
+          int64_t sqrt_val = static_cast<int64_t>(std::sqrt(static_cast<double>(val)));
+          while (sqrt_val > 0 && sqrt_val > val / sqrt_val) --sqrt_val;
+          while ((sqrt_val + 1) <= val / (sqrt_val + 1)) ++sqrt_val;
           if (sqrt_val * sqrt_val == val) {
                return Value(sqrt_val);
           }
@@ -132,15 +134,15 @@ inline Value det(const std::vector<Value>& args) {
 
 inline Value size(const std::vector<Value>& args) {
      if (args[0].is_array()) {
-          const auto& arr = std::get<std::vector<Value>>(args[0].data);
+          const auto& arr = args[0].get<std::vector<Value>>();
           return Value(static_cast<int>(arr.size()));
      }
      else if (args[0].is_matrix()) {
-          const auto& mat = std::get<std::vector<std::vector<Value>>>(args[0].data);
+          const auto& mat = args[0].get<std::vector<std::vector<Value>>>();
           return Value(static_cast<int>(mat.size()));
      }
      else if (args[0].is_string()) {
-          const auto& str = std::get<std::string>(args[0].data);
+          const auto& str = args[0].get<std::string>();
           return Value(static_cast<int>(str.length()));
      }
      return Value(1); // Scalar values have size 1
@@ -190,6 +192,56 @@ inline Value decimal(const std::vector<Value>& args) {
      double val = args[0].as_number();
      return Value(val);
 }
+// 组合函数的整数参数（Int 或 BigInt）
+inline ::BigInt combinatorial_arg(const Value& v, const char* func) {
+     if (v.is_int()) {
+          return ::BigInt(static_cast<long long>(v.get<int64_t>()));
+     }
+     if (!v.is_bigint()) {
+          error_and_exit(std::string(func) + "() requires integer arguments");
+     }
+     return v.get<::BigInt>();
+}
+
+// 结果能用 64 位整数表示时返回 Int，否则返回 BigInt
+inline Value combinatorial_result(::BigInt&& result) {
+     if (result.fits_int64()) {
+          return Value(static_cast<long long>(result.to_int64()));
+     }
+     return Value(std::move(result));
+}
+
+// binomial(n, k)：二项式系数，k < 0 或 k > n 时为 0
+inline Value binomial(const std::vector<Value>& args) {
+     ::BigInt n = combinatorial_arg(args[0], "binomial");
+     ::BigInt k = combinatorial_arg(args[1], "binomial");
+     try {
+          return combinatorial_result(::BigInt::binomial(n, k));
+     } catch (const std::exception& e) {
+          error_and_exit(std::string("binomial(): ") + e.what());
+     }
+     return Value();
+}
+
+// multinomial(k1, k2, ...) 或 multinomial([k1, k2, ...])：(k1 + k2 + ...)! / (k1! k2! ...)
+inline Value multinomial(const std::vector<Value>& args) {
+     const std::vector<Value>* items = &args;
+     if (args.size() == 1 && args[0].is_array()) {
+          items = &args[0].get<std::vector<Value>>();
+     }
+     std::vector<::BigInt> parts;
+     parts.reserve(items->size());
+     for (const auto& item : *items) {
+          parts.push_back(combinatorial_arg(item, "multinomial"));
+     }
+     try {
+          return combinatorial_result(::BigInt::multinomial(parts));
+     } catch (const std::exception& e) {
+          error_and_exit(std::string("multinomial(): ") + e.what());
+     }
+     return Value();
+}
+
 namespace lamina {
      LAMINA_FUNC("sqrt", sqrt, 1);
      LAMINA_FUNC("pi", pi, 0);
@@ -211,4 +263,6 @@ namespace lamina {
      LAMINA_FUNC("idiv", idiv, 2);
      LAMINA_FUNC("fraction", fraction, 1);
      LAMINA_FUNC("decimal", decimal, 1);
+     LAMINA_FUNC("binomial", binomial, 2);
+     LAMINA_FUNC_WIT_ANY_ARGS("multinomial", multinomial);
 }
@@ -15,19 +15,22 @@
 
 class LAMINA_API Parser {
 public:
-    static std::unique_ptr<ASTNode> parse(const std::vector<Token>& tokens);
-    static std::unique_ptr<Expression> parse_expression(const std::vector<Token>& tokens, size_t& i);
+    static NodePtr<ASTNode> parse(const std::vector<Token>& tokens);
+    // 本线程上一次 parse 输出的错误与警告条数；为 0 表示源码被完整无误地解析
+    static size_t diagnostics();
+    static NodePtr<Expression> parse_expression(const std::vector<Token>& tokens, size_t& i);
     // 解析不同层级的表达式，处理正确的运算符优先级
-    static std::unique_ptr<Expression> parse_comparison(const std::vector<Token>& tokens, size_t& i);
-    static std::unique_ptr<Expression> parse_addition(const std::vector<Token>& tokens, size_t& i);
-    static std::unique_ptr<Expression> parse_term(const std::vector<Token>& tokens, size_t& i);
-    static std::unique_ptr<Expression> parse_power(const std::vector<Token>& tokens, size_t& i);
-    static std::unique_ptr<Expression> parse_unary(const std::vector<Token>& tokens, size_t& i);
-    static std::unique_ptr<Expression> parse_primary(const std::vector<Token>& tokens, size_t& i);
+    static NodePtr<Expression> parse_comparison(const std::vector<Token>& tokens, size_t& i);
+    static NodePtr<Expression> parse_addition(const std::vector<Token>& tokens, size_t& i);
+    static NodePtr<Expression> parse_term(const std::vector<Token>& tokens, size_t& i);
+    static NodePtr<Expression> parse_power(const std::vector<Token>& tokens, size_t& i);
+    static NodePtr<Expression> parse_unary(const std::vector<Token>& tokens, size_t& i);
+    static NodePtr<Expression> parse_primary(const std::vector<Token>& tokens, size_t& i);
     // 解析一组语句，返回 BlockStmt
-    static std::unique_ptr<BlockStmt> parse_block(const std::vector<Token>& tokens, size_t& i, bool is_global);
-    static std::unique_ptr<BlockStmt> parse_block(const std::vector<Token>& tokens, size_t& i); // 兼容老代码
+    static NodePtr<BlockStmt> parse_block(const std::vector<Token>& tokens, size_t& i, bool is_global);
+    static NodePtr<BlockStmt> parse_block(const std::vector<Token>& tokens, size_t& i); // 兼容老代码
     // 解析单条语句
-    static std::unique_ptr<Statement> parse_statement(const std::vector<Token>& tokens, size_t& i);
-    static std::unique_ptr<Statement> parse_while(const std::vector<Token>& tokens, size_t& i);
+    static NodePtr<Statement> parse_statement(const std::vector<Token>& tokens, size_t& i);
+    static NodePtr<Statement> parse_while(const std::vector<Token>& tokens, size_t& i);
+    static NodePtr<Statement> parse_for(const std::vector<Token>& tokens, size_t& i);
 };
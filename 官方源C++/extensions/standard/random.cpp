@@ -5,8 +5,8 @@ Value randint(const std::vector<Value> &args) {
      int min;
      int max;
 
-     static std::random_device rd;
-     static std::mt19937 gen(rd());
+     // 每个线程使用自己的生成器，多个解释器实例可以并行调用
+     thread_local std::mt19937 gen(std::random_device{}());
 
      if (args[0].is_numeric() && args[1].is_numeric()) {
           min = std::stoi((args[0].to_string()));
@@ -34,8 +34,8 @@ Value randstr(const std::vector<Value> &args) {
      }
 
      static const std::string charset = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
-     static std::random_device rd;
-     static std::mt19937 gen(rd());
+     // 每个线程使用自己的生成器，多个解释器实例可以并行调用
+     thread_local std::mt19937 gen(std::random_device{}());
      std::uniform_int_distribution<> dis(0, charset.size() - 1);
 
      std::string result;
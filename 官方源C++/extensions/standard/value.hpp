@@ -2,7 +2,12 @@
 #include "bigint.hpp"
 #include "rational.hpp"
 #include "irrational.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <variant>
 #include <vector>
 #include <cmath>
@@ -18,27 +23,32 @@
 #  define LAMINA_API
 #endif
 
+// 值：16 字节的带标签联合体
+// null/bool/int/double 直接存放在值内，Int 为 64 位有符号整数，运算溢出时提升为 BigInt；字符串、数组、矩阵、BigInt、有理数、无理数放在堆上，
+// 载荷带原子引用计数并在各个副本间共享，复制与传参为 O(1)。
+// 按类型读取使用 get<T>()；需要修改时使用 get_mutable<T>()，载荷被共享时先复制一份（写时复制）。
 class LAMINA_API Value {
-public:    enum class Type { Null, Bool, Int, Float, String, Array, Matrix, BigInt, Rational, Irrational };
+public:    enum class Type : unsigned char { Null, Bool, Int, Float, String, Array, Matrix, BigInt, Rational, Irrational };
     Type type;
-    std::variant<std::nullptr_t, bool, int, double, std::string, std::vector<Value>, std::vector<std::vector<Value>>, ::BigInt, ::Rational, ::Irrational> data;
-
-    virtual ~Value() = default;
 
     // Constructors
-    Value() : type(Type::Null), data(std::in_place_index<0>, nullptr) {}  // 0对应std::nullptr_t类型
+    Value() : type(Type::Null) { storage.heap = nullptr; }
 
-    // 其他构造函数需要同步修改初始化方式
-    Value(std::nullptr_t) : type(Type::Null), data(std::in_place_index<0>, nullptr) {}
-    Value(bool b) : type(Type::Bool), data(std::in_place_index<1>, b) {}
-    Value(int i) : type(Type::Int), data(std::in_place_index<2>, i) {}
-    Value(double f) : type(Type::Float), data(std::in_place_index<3>, f) {}
-    Value(const std::string& s) : type(Type::String), data(s) {}
-    Value(const char* s) : type(Type::String), data(std::string(s)) {}
-    Value(const ::BigInt& bi) : type(Type::BigInt), data(bi) {}
-    Value(const ::Rational& r) : type(Type::Rational), data(r) {}
-    Value(const ::Irrational& ir) : type(Type::Irrational), data(ir) {}
-    Value(const std::vector<Value>& arr) {
+    Value(std::nullptr_t) : Value() {}
+    Value(bool b) : type(Type::Bool) { storage.b = b; }
+    Value(int i) : type(Type::Int) { storage.i = i; }
+    Value(long i) : type(Type::Int) { storage.i = static_cast<int64_t>(i); }
+    Value(long long i) : type(Type::Int) { storage.i = static_cast<int64_t>(i); }
+    Value(double f) : type(Type::Float) { storage.f = f; }
+    Value(const std::string& s) : type(Type::String) { storage.heap = new Box<std::string>(s); }
+    Value(std::string&& s) : type(Type::String) { storage.heap = new Box<std::string>(std::move(s)); }
+    Value(const char* s) : type(Type::String) { storage.heap = new Box<std::string>(s); }
+    Value(const ::BigInt& bi) : type(Type::BigInt) { storage.heap = new Box<::BigInt>(bi); }
+    Value(::BigInt&& bi) : type(Type::BigInt) { storage.heap = new Box<::BigInt>(std::move(bi)); }
+    Value(const ::Rational& r) : type(Type::Rational) { storage.heap = new Box<::Rational>(r); }
+    Value(const ::Irrational& ir) : type(Type::Irrational) { storage.heap = new Box<::Irrational>(ir); }
+    Value(const std::vector<Value>& arr) : Value(std::vector<Value>(arr)) {}
+    Value(std::vector<Value>&& arr) {
         // Check if this is a matrix (array of arrays)
         bool is_matrix = !arr.empty() && arr[0].is_array();
         if (is_matrix) {
@@ -46,24 +56,76 @@ public:    enum class Type { Null, Bool, Int, Float, String, Array, Matrix, BigI
             std::vector<std::vector<Value>> matrix;
             for (const auto& row : arr) {
                 if (row.is_array()) {
-                    matrix.push_back(std::get<std::vector<Value>>(row.data));
+                    matrix.push_back(row.get<std::vector<Value>>());
                 } else {
                     // Mixed types, treat as array
                     type = Type::Array;
-                    data = arr;
+                    storage.heap = new Box<std::vector<Value>>(std::move(arr));
                     return;
                 }
             }
             type = Type::Matrix;
-            data = matrix;
+            storage.heap = new Box<std::vector<std::vector<Value>>>(std::move(matrix));
         } else {
             type = Type::Array;
-            data = arr;
+            storage.heap = new Box<std::vector<Value>>(std::move(arr));
         }
     }
 
 
-    Value(const std::vector<std::vector<Value>>& mat) : type(Type::Matrix), data(mat) {}
+    Value(const std::vector<std::vector<Value>>& mat) : type(Type::Matrix) { storage.heap = new Box<std::vector<std::vector<Value>>>(mat); }
+
+    Value(const Value& other) : type(other.type), storage(other.storage) {
+        if (on_heap()) storage.heap->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    Value(Value&& other) noexcept : type(other.type), storage(other.storage) {
+        other.type = Type::Null;
+    }
+    Value& operator=(const Value& other) {
+        if (this != &other) {
+            Value copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+    Value& operator=(Value&& other) noexcept {
+        if (this != &other) {
+            release();
+            type = other.type;
+            storage = other.storage;
+            other.type = Type::Null;
+        }
+        return *this;
+    }
+    ~Value() { release(); }
+
+    // 按类型取值，类型不符时抛出 std::bad_variant_access
+    template <class T>
+    const T& get() const {
+        if (type != type_of<T>()) throw std::bad_variant_access();
+        if constexpr (std::is_same_v<T, bool>) return storage.b;
+        else if constexpr (std::is_same_v<T, int64_t>) return storage.i;
+        else if constexpr (std::is_same_v<T, double>) return storage.f;
+        else return static_cast<const Box<T>*>(storage.heap)->value;
+    }
+
+    // 取得可修改的载荷；与其他值共享时先复制，修改不会影响其他副本
+    template <class T>
+    T& get_mutable() {
+        if (type != type_of<T>()) throw std::bad_variant_access();
+        if constexpr (std::is_same_v<T, bool>) return storage.b;
+        else if constexpr (std::is_same_v<T, int64_t>) return storage.i;
+        else if constexpr (std::is_same_v<T, double>) return storage.f;
+        else {
+            auto* box = static_cast<Box<T>*>(storage.heap);
+            if (box->refs.load(std::memory_order_acquire) != 1) {
+                auto* copy = new Box<T>(box->value);
+                if (box->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete box;
+                storage.heap = box = copy;
+            }
+            return box->value;
+        }
+    }
 
     // Type checking helpers
     bool is_null() const { return type == Type::Null; }
@@ -78,59 +140,51 @@ public:    enum class Type { Null, Bool, Int, Float, String, Array, Matrix, BigI
     bool is_numeric() const { return type == Type::Int || type == Type::Float || type == Type::BigInt || type == Type::Rational || type == Type::Irrational; }
       // Get numeric value as double
     double as_number() const {
-        if (type == Type::Int) return static_cast<double>(std::get<int>(data));
-        if (type == Type::Float) return std::get<double>(data);
-        if (type == Type::BigInt) {
-            // For BigInt, try to convert to int first, then to double
-            int int_val = std::get<::BigInt>(data).to_int();
-            return static_cast<double>(int_val);
-        }
+        if (type == Type::Int) return static_cast<double>(get<int64_t>());
+        if (type == Type::Float) return get<double>();
+        if (type == Type::BigInt) return get<::BigInt>().to_double();
         if (type == Type::Rational) {
-            return std::get<::Rational>(data).to_double();
+            return get<::Rational>().to_double();
         }
         if (type == Type::Irrational) {
-            return std::get<::Irrational>(data).to_double();
+            return get<::Irrational>().to_double();
         }
         return 0.0;
     }
     
     // Get numeric value as Rational (for precise calculations)
     ::Rational as_rational() const {
-        if (type == Type::Rational) return std::get<::Rational>(data);
-        if (type == Type::Int) return ::Rational(std::get<int>(data));
-        if (type == Type::Float) return ::Rational::from_double(std::get<double>(data));
+        if (type == Type::Rational) return get<::Rational>();
+        if (type == Type::Int) return ::Rational(static_cast<long long>(get<int64_t>()));
+        if (type == Type::Float) return ::Rational::from_double(get<double>());
         if (type == Type::BigInt) {
-            int int_val = std::get<::BigInt>(data).to_int();
-            return ::Rational(int_val);
+            return ::Rational(static_cast<long long>(get<::BigInt>().to_int64()));
         }
         if (type == Type::Irrational) {
-            return ::Rational::from_double(std::get<::Irrational>(data).to_double());
+            return ::Rational::from_double(get<::Irrational>().to_double());
         }
         return ::Rational(0);
     }
     
     // Get numeric value as Irrational (for exact irrational calculations)
     ::Irrational as_irrational() const {
-        if (type == Type::Irrational) return std::get<::Irrational>(data);
-        if (type == Type::Int) return ::Irrational::constant(std::get<int>(data));
-        if (type == Type::Float) return ::Irrational::constant(std::get<double>(data));
-        if (type == Type::Rational) return ::Irrational::constant(std::get<::Rational>(data).to_double());
-        if (type == Type::BigInt) {
-            int int_val = std::get<::BigInt>(data).to_int();
-            return ::Irrational::constant(int_val);
-        }
+        if (type == Type::Irrational) return get<::Irrational>();
+        if (type == Type::Int) return ::Irrational::constant(static_cast<double>(get<int64_t>()));
+        if (type == Type::Float) return ::Irrational::constant(get<double>());
+        if (type == Type::Rational) return ::Irrational::constant(get<::Rational>().to_double());
+        if (type == Type::BigInt) return ::Irrational::constant(get<::BigInt>().to_double());
         return ::Irrational::constant(0);
     }
       // Get boolean value
     bool as_bool() const {
-        if (type == Type::Bool) return std::get<bool>(data);
-        if (type == Type::Int) return std::get<int>(data) != 0;
-        if (type == Type::Float) return std::get<double>(data) != 0.0;
-        if (type == Type::BigInt) return !std::get<::BigInt>(data).is_zero();
-        if (type == Type::Rational) return !std::get<::Rational>(data).is_zero();
-        if (type == Type::Irrational) return !std::get<::Irrational>(data).is_zero();
-        if (type == Type::String) return !std::get<std::string>(data).empty();
-        if (type == Type::Array) return !std::get<std::vector<Value>>(data).empty();
+        if (type == Type::Bool) return get<bool>();
+        if (type == Type::Int) return get<int64_t>() != 0;
+        if (type == Type::Float) return get<double>() != 0.0;
+        if (type == Type::BigInt) return !get<::BigInt>().is_zero();
+        if (type == Type::Rational) return !get<::Rational>().is_zero();
+        if (type == Type::Irrational) return !get<::Irrational>().is_zero();
+        if (type == Type::String) return !get<std::string>().empty();
+        if (type == Type::Array) return !get<std::vector<Value>>().empty();
         return false;
     }
 
@@ -138,20 +192,20 @@ public:    enum class Type { Null, Bool, Int, Float, String, Array, Matrix, BigI
     std::string to_string() const {
         switch (type) {
             case Type::Null: return "null";
-            case Type::Bool: return std::get<bool>(data) ? "true" : "false";
-            case Type::Int: return std::to_string(std::get<int>(data));
+            case Type::Bool: return get<bool>() ? "true" : "false";
+            case Type::Int: return std::to_string(get<int64_t>());
             case Type::Float: {
-                double val = std::get<double>(data);
+                double val = get<double>();
                 // Remove trailing zeros for cleaner output
                 std::string str = std::to_string(val);
                 str.erase(str.find_last_not_of('0') + 1, std::string::npos);
                 str.erase(str.find_last_not_of('.') + 1, std::string::npos);
                 return str;
             }
-            case Type::String: return std::get<std::string>(data);
+            case Type::String: return get<std::string>();
             case Type::Array: {
                 std::string res = "[";
-                const auto& arr = std::get<std::vector<Value>>(data);
+                const auto& arr = get<std::vector<Value>>();
                 for (size_t i = 0; i < arr.size(); ++i) {
                     if (i) res += ", ";
                     res += arr[i].to_string();
@@ -161,7 +215,7 @@ public:    enum class Type { Null, Bool, Int, Float, String, Array, Matrix, BigI
             }
             case Type::Matrix: {
                 std::string res = "[";
-                const auto& mat = std::get<std::vector<std::vector<Value>>>(data);
+                const auto& mat = get<std::vector<std::vector<Value>>>();
                 for (size_t i = 0; i < mat.size(); ++i) {
                     if (i) res += ", ";
                     res += "[";
@@ -174,13 +228,13 @@ public:    enum class Type { Null, Bool, Int, Float, String, Array, Matrix, BigI
                 return res;
             }
             case Type::BigInt: {
-                return std::get<::BigInt>(data).to_string();
+                return get<::BigInt>().to_string();
             }
             case Type::Rational: {
-                return std::get<::Rational>(data).to_string();
+                return get<::Rational>().to_string();
             }
             case Type::Irrational: {
-                return std::get<::Irrational>(data).to_string();
+                return get<::Irrational>().to_string();
             }
         }
         return "<unknown>";
@@ -193,8 +247,8 @@ public:    enum class Type { Null, Bool, Int, Float, String, Array, Matrix, BigI
             return Value();
         }
         
-        const auto& a = std::get<std::vector<Value>>(data);
-        const auto& b = std::get<std::vector<Value>>(other.data);
+        const auto& a = get<std::vector<Value>>();
+        const auto& b = other.get<std::vector<Value>>();
         
         if (a.size() != b.size()) {
             std::cerr << "Error: Vector addition requires same dimensions" << std::endl;
@@ -220,8 +274,8 @@ public:    enum class Type { Null, Bool, Int, Float, String, Array, Matrix, BigI
             return Value();
         }
         
-        const auto& a = std::get<std::vector<Value>>(data);
-        const auto& b = std::get<std::vector<Value>>(other.data);
+        const auto& a = get<std::vector<Value>>();
+        const auto& b = other.get<std::vector<Value>>();
         
         if (a.size() != b.size()) {
             std::cerr << "Error: Dot product requires same dimensions" << std::endl;
@@ -246,7 +300,7 @@ public:    enum class Type { Null, Bool, Int, Float, String, Array, Matrix, BigI
             return Value();
         }
         
-        const auto& arr = std::get<std::vector<Value>>(data);
+        const auto& arr = get<std::vector<Value>>();
         std::vector<Value> result;
         
         for (const auto& elem : arr) {
@@ -267,8 +321,8 @@ public:    enum class Type { Null, Bool, Int, Float, String, Array, Matrix, BigI
             return Value();
         }
         
-        const auto& a = std::get<std::vector<Value>>(data);
-        const auto& b = std::get<std::vector<Value>>(other.data);
+        const auto& a = get<std::vector<Value>>();
+        const auto& b = other.get<std::vector<Value>>();
         
         if (a.size() != 3 || b.size() != 3) {
             std::cerr << "Error: Cross product requires 3D vectors" << std::endl;
@@ -300,7 +354,7 @@ public:    enum class Type { Null, Bool, Int, Float, String, Array, Matrix, BigI
             return Value();
         }
         
-        const auto& arr = std::get<std::vector<Value>>(data);
+        const auto& arr = get<std::vector<Value>>();
         double sum = 0.0;
         
         for (const auto& elem : arr) {
@@ -332,8 +386,8 @@ public:    enum class Type { Null, Bool, Int, Float, String, Array, Matrix, BigI
             return Value();
         }
         
-        const auto& a = std::get<std::vector<std::vector<Value>>>(data);
-        const auto& b = std::get<std::vector<std::vector<Value>>>(other.data);
+        const auto& a = get<std::vector<std::vector<Value>>>();
+        const auto& b = other.get<std::vector<std::vector<Value>>>();
         
         if (a.empty() || b.empty() || a[0].size() != b.size()) {
             std::cerr << "Error: Invalid matrix dimensions for multiplication" << std::endl;
@@ -369,7 +423,7 @@ public:    enum class Type { Null, Bool, Int, Float, String, Array, Matrix, BigI
             return Value();
         }
         
-        const auto& mat = std::get<std::vector<std::vector<Value>>>(data);
+        const auto& mat = get<std::vector<std::vector<Value>>>();
         
         if (mat.size() != mat[0].size()) {
             std::cerr << "Error: Determinant requires a square matrix" << std::endl;
@@ -413,4 +467,57 @@ public:    enum class Type { Null, Bool, Int, Float, String, Array, Matrix, BigI
             return Value();
         }
     }
+
+private:
+    // 堆上载荷的引用计数头
+    struct Payload {
+        std::atomic<unsigned> refs{1};
+    };
+    template <class T>
+    struct Box : Payload {
+        T value;
+        template <class... Args>
+        explicit Box(Args&&... args) : value(std::forward<Args>(args)...) {}
+    };
+
+    union Storage {
+        bool b;
+        int64_t i;
+        double f;
+        Payload* heap;
+    } storage;
+
+    bool on_heap() const { return type >= Type::String; }
+
+    template <class T>
+    static constexpr Type type_of() {
+        if constexpr (std::is_same_v<T, bool>) return Type::Bool;
+        else if constexpr (std::is_same_v<T, int64_t>) return Type::Int;
+        else if constexpr (std::is_same_v<T, double>) return Type::Float;
+        else if constexpr (std::is_same_v<T, std::string>) return Type::String;
+        else if constexpr (std::is_same_v<T, std::vector<Value>>) return Type::Array;
+        else if constexpr (std::is_same_v<T, std::vector<std::vector<Value>>>) return Type::Matrix;
+        else if constexpr (std::is_same_v<T, ::BigInt>) return Type::BigInt;
+        else if constexpr (std::is_same_v<T, ::Rational>) return Type::Rational;
+        else {
+            static_assert(std::is_same_v<T, ::Irrational>, "unsupported Value payload type");
+            return Type::Irrational;
+        }
+    }
+
+    // 释放对载荷的引用，最后一个持有者负责销毁
+    void release() {
+        if (on_heap() && storage.heap->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            switch (type) {
+                case Type::String: delete static_cast<Box<std::string>*>(storage.heap); break;
+                case Type::Array: delete static_cast<Box<std::vector<Value>>*>(storage.heap); break;
+                case Type::Matrix: delete static_cast<Box<std::vector<std::vector<Value>>>*>(storage.heap); break;
+                case Type::BigInt: delete static_cast<Box<::BigInt>*>(storage.heap); break;
+                case Type::Rational: delete static_cast<Box<::Rational>*>(storage.heap); break;
+                case Type::Irrational: delete static_cast<Box<::Irrational>*>(storage.heap); break;
+                default: break;
+            }
+        }
+        type = Type::Null;
+    }
 };
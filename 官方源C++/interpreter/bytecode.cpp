@@ -0,0 +1,328 @@
+#include "bytecode.hpp"
+#include "interpreter.hpp"
+
+std::unique_ptr<Chunk> BytecodeCompiler::compile_statement(const NodePtr<Statement>& stmt) {
+    BytecodeCompiler compiler;
+    compiler.compile_stmt(stmt);
+    compiler.emit(OpCode::ReturnNull);
+    return std::move(compiler.chunk);
+}
+
+std::unique_ptr<Chunk> BytecodeCompiler::compile_function(const FuncDefStmt* func) {
+    BytecodeCompiler compiler;
+    if (func && func->body) {
+        compiler.compile_block(func->body.get());
+    }
+    compiler.emit(OpCode::ReturnNull);
+    return std::move(compiler.chunk);
+}
+
+size_t BytecodeCompiler::emit(OpCode op, int a, int b, int c, uint16_t aux) {
+    chunk->code.push_back(Instruction{op, aux, a, b, c});
+    return chunk->code.size() - 1;
+}
+
+int BytecodeCompiler::add_constant(const Value& v) {
+    chunk->constants.push_back(v);
+    return static_cast<int>(chunk->constants.size() - 1);
+}
+
+int BytecodeCompiler::add_name(const std::string& name, const VarRef& ref) {
+    // 同一段字节码内，同名变量的解析结果总是相同
+    auto it = name_index.find(name);
+    if (it != name_index.end()) return it->second;
+    int index = static_cast<int>(chunk->names.size());
+    chunk->names.push_back(name);
+    chunk->refs.push_back(ref);
+    name_index[name] = index;
+    return index;
+}
+
+int BytecodeCompiler::alloc_register() {
+    int reg = next_register++;
+    if (next_register > chunk->num_registers) chunk->num_registers = next_register;
+    return reg;
+}
+
+bool BytecodeCompiler::is_compilable(const Expression* expr) {
+    if (!expr) return false;
+    switch (expr->kind) {
+    case NodeKind::Literal:
+    case NodeKind::Identifier:
+    case NodeKind::Var:
+        return true;
+    case NodeKind::Binary: {
+        auto* bin = static_cast<const BinaryExpr*>(expr);
+        return is_compilable(bin->left.get()) && is_compilable(bin->right.get());
+    }
+    case NodeKind::Unary:
+        return is_compilable(static_cast<const UnaryExpr*>(expr)->operand.get());
+    case NodeKind::Call: {
+        for (const auto& arg : static_cast<const CallExpr*>(expr)->args) {
+            if (!is_compilable(arg.get())) return false;
+        }
+        return true;
+    }
+    case NodeKind::Array: {
+        for (const auto& element : static_cast<const ArrayExpr*>(expr)->elements) {
+            if (!is_compilable(element.get())) return false;
+        }
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+void BytecodeCompiler::emit_fallback(const NodePtr<Statement>& stmt) {
+    chunk->fallbacks.push_back(&stmt);
+    emit(OpCode::ExecStmt, 0, static_cast<int>(chunk->fallbacks.size() - 1));
+}
+
+void BytecodeCompiler::compile_block(const BlockStmt* block) {
+    if (!block) return;
+    for (const auto& stmt : block->statements) {
+        compile_stmt(stmt);
+    }
+}
+
+void BytecodeCompiler::compile_stmt(const NodePtr<Statement>& stmt) {
+    if (!stmt) return;
+    int mark = next_register;
+
+    switch (stmt->kind) {
+    case NodeKind::VarDecl: {
+        auto* v = static_cast<const VarDeclStmt*>(stmt.get());
+        if (!is_compilable(v->expr.get())) {
+            emit_fallback(stmt);
+            break;
+        }
+        int reg = alloc_register();
+        compile_expr(v->expr.get(), reg);
+        emit(OpCode::StoreVar, reg, add_name(v->name, v->ref));
+        break;
+    }
+    case NodeKind::Assign: {
+        auto* a = static_cast<const AssignStmt*>(stmt.get());
+        if (!is_compilable(a->expr.get())) {
+            emit_fallback(stmt);
+            break;
+        }
+        int reg = alloc_register();
+        compile_expr(a->expr.get(), reg);
+        emit(OpCode::StoreVar, reg, add_name(a->name, a->ref));
+        break;
+    }
+    case NodeKind::If: {
+        auto* ifs = static_cast<const IfStmt*>(stmt.get());
+        if (!is_compilable(ifs->condition.get())) {
+            emit_fallback(stmt);
+            break;
+        }
+        int cond = alloc_register();
+        compile_expr(ifs->condition.get(), cond);
+        size_t to_else = emit(OpCode::JumpIfFalse, cond);
+        next_register = mark;
+        compile_block(ifs->thenBlock.get());
+        if (ifs->elseBlock) {
+            size_t to_end = emit(OpCode::Jump);
+            chunk->code[to_else].b = label();
+            compile_block(ifs->elseBlock.get());
+            chunk->code[to_end].a = label();
+        } else {
+            chunk->code[to_else].b = label();
+        }
+        break;
+    }
+    case NodeKind::While: {
+        auto* ws = static_cast<const WhileStmt*>(stmt.get());
+        if (!is_compilable(ws->condition.get())) {
+            emit_fallback(stmt);
+            break;
+        }
+        compile_while(ws);
+        break;
+    }
+    case NodeKind::For: {
+        auto* fs = static_cast<const ForStmt*>(stmt.get());
+        if (!is_compilable(fs->start.get()) || (fs->end && !is_compilable(fs->end.get()))) {
+            emit_fallback(stmt);
+            break;
+        }
+        compile_for(fs);
+        break;
+    }
+    case NodeKind::Block:
+        compile_block(static_cast<const BlockStmt*>(stmt.get()));
+        break;
+    case NodeKind::Return: {
+        auto* ret = static_cast<const ReturnStmt*>(stmt.get());
+        if (!is_compilable(ret->expr.get())) {
+            emit_fallback(stmt);
+            break;
+        }
+        int reg = alloc_register();
+        compile_expr(ret->expr.get(), reg);
+        // 循环区域内的调用出错时要由区域包装，不能省去本帧
+        if (ret->expr->kind == NodeKind::Call && loops.empty()) {
+            chunk->code.back().op = OpCode::TailCall;
+        }
+        emit(OpCode::Return, reg);
+        break;
+    }
+    case NodeKind::Break:
+        if (loops.empty()) {
+            emit(OpCode::Complete, 0, 0, 0, static_cast<uint16_t>(Completion::Kind::Break));
+        } else {
+            loops.back().breaks.push_back(emit(OpCode::Jump));
+        }
+        break;
+    case NodeKind::Continue:
+        if (loops.empty()) {
+            emit(OpCode::Complete, 0, 0, 0, static_cast<uint16_t>(Completion::Kind::Continue));
+        } else {
+            emit(OpCode::Jump, loops.back().head);
+        }
+        break;
+    case NodeKind::ExprStmt: {
+        auto* exprstmt = static_cast<const ExprStmt*>(stmt.get());
+        if (!is_compilable(exprstmt->expr.get())) {
+            emit_fallback(stmt);
+            break;
+        }
+        size_t region = emit(OpCode::EnterRegion, 0, 0, 0, static_cast<uint16_t>(RegionKind::ExprStmt));
+        int reg = alloc_register();
+        compile_expr(exprstmt->expr.get(), reg);
+        emit(OpCode::LeaveRegion);
+        chunk->code[region].a = label();
+        break;
+    }
+    default:
+        // 定义类语句（func/define/bigint/include 等）不在热路径上，交给树遍历执行
+        emit_fallback(stmt);
+        break;
+    }
+
+    next_register = mark;
+}
+
+void BytecodeCompiler::compile_while(const WhileStmt* ws) {
+    emit(OpCode::EnterRegion, 0, 0, 0, static_cast<uint16_t>(RegionKind::LoopBody));
+
+    int head = label();
+    emit(OpCode::LoopTick);
+    emit(OpCode::EnterRegion, 0, 0, 0, static_cast<uint16_t>(RegionKind::LoopCondition));
+    int cond = alloc_register();
+    compile_expr(ws->condition.get(), cond);
+    emit(OpCode::LeaveRegion);
+    size_t to_exit = emit(OpCode::JumpIfFalse, cond);
+    next_register = cond;
+
+    loops.push_back(LoopLabels{head, {}});
+    compile_block(ws->body.get());
+    emit(OpCode::Jump, head);
+
+    // break 跳到这里，与正常退出一样离开循环区域
+    int exit = label();
+    chunk->code[to_exit].b = exit;
+    for (size_t jump : loops.back().breaks) {
+        chunk->code[jump].a = exit;
+    }
+    loops.pop_back();
+    emit(OpCode::LeaveRegion);
+}
+
+void BytecodeCompiler::compile_for(const ForStmt* fs) {
+    // 区间：R[iter] 为下一个值，R[limit] 为终点；数组：R[iter] 为数组，R[limit] 为下标
+    int iter = alloc_register();
+    int limit = alloc_register();
+    int element = alloc_register();
+    compile_expr(fs->start.get(), iter);
+    if (fs->is_range()) compile_expr(fs->end.get(), limit);
+    emit(OpCode::ForPrep, iter, limit, 0, fs->is_range() ? 1 : 0);
+    emit(OpCode::EnterRegion, 0, 0, 0, static_cast<uint16_t>(RegionKind::LoopBody));
+
+    int head = label();
+    emit(OpCode::LoopTick);
+    size_t next = emit(OpCode::ForNext, iter, limit, 0, static_cast<uint16_t>(element));
+    emit(OpCode::StoreVar, element, add_name(fs->name, fs->ref));
+
+    loops.push_back(LoopLabels{head, {}});
+    compile_block(fs->body.get());
+    emit(OpCode::Jump, head);
+
+    int exit = label();
+    chunk->code[next].c = exit;
+    for (size_t jump : loops.back().breaks) {
+        chunk->code[jump].a = exit;
+    }
+    loops.pop_back();
+    emit(OpCode::LeaveRegion);
+}
+
+void BytecodeCompiler::compile_expr(const Expression* expr, int dst) {
+    switch (expr->kind) {
+    case NodeKind::Literal: {
+        auto* lit = static_cast<const LiteralExpr*>(expr);
+        emit(OpCode::LoadConst, dst, add_constant(lit->value));
+        break;
+    }
+    case NodeKind::Identifier: {
+        auto* id = static_cast<const IdentifierExpr*>(expr);
+        emit(OpCode::LoadVar, dst, add_name(id->name, id->ref));
+        break;
+    }
+    case NodeKind::Var: {
+        auto* var = static_cast<const VarExpr*>(expr);
+        emit(OpCode::LoadVar, dst, add_name(var->name, var->ref));
+        break;
+    }
+    case NodeKind::Binary: {
+        auto* bin = static_cast<const BinaryExpr*>(expr);
+        // 左操作数直接写入目标寄存器，右操作数使用临时寄存器
+        compile_expr(bin->left.get(), dst);
+        int rhs = alloc_register();
+        compile_expr(bin->right.get(), rhs);
+        emit(OpCode::Binary, dst, dst, rhs, static_cast<uint16_t>(bin->op));
+        next_register = rhs;
+        break;
+    }
+    case NodeKind::Unary: {
+        auto* unary = static_cast<const UnaryExpr*>(expr);
+        compile_expr(unary->operand.get(), dst);
+        emit(OpCode::Unary, dst, dst, 0, static_cast<uint16_t>(unary->op));
+        break;
+    }
+    case NodeKind::Call: {
+        auto* call = static_cast<const CallExpr*>(expr);
+        // 实参放在连续的寄存器中
+        int base = next_register;
+        for (size_t i = 0; i < call->args.size(); ++i) {
+            alloc_register();
+        }
+        for (size_t i = 0; i < call->args.size(); ++i) {
+            compile_expr(call->args[i].get(), base + static_cast<int>(i));
+        }
+        chunk->calls.push_back(call);
+        chunk->call_caches.emplace_back();
+        emit(OpCode::Call, dst, static_cast<int>(chunk->calls.size() - 1), base, static_cast<uint16_t>(call->args.size()));
+        next_register = base;
+        break;
+    }
+    case NodeKind::Array: {
+        auto* arr = static_cast<const ArrayExpr*>(expr);
+        int base = next_register;
+        for (size_t i = 0; i < arr->elements.size(); ++i) {
+            alloc_register();
+        }
+        for (size_t i = 0; i < arr->elements.size(); ++i) {
+            compile_expr(arr->elements[i].get(), base + static_cast<int>(i));
+        }
+        emit(OpCode::MakeArray, dst, base, static_cast<int>(arr->elements.size()));
+        next_register = base;
+        break;
+    }
+    default:
+        break;
+    }
+}
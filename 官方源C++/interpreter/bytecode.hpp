@@ -0,0 +1,94 @@
+#pragma once
+#include "ast.hpp"
+#include "value.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 字节码指令（寄存器式）
+// R[x] 为当前帧寄存器，K[x] 为常量表，N[x] 为名称表，V[x] 为名称对应的变量解析结果，C[x] 为调用点表，S[x] 为回退语句表
+enum class OpCode : uint8_t {
+    LoadConst,      // R[a] = K[b]
+    LoadVar,        // R[a] = 变量 N[b]（按 V[b] 的解析结果访问）
+    StoreVar,       // 变量 N[b] = R[a]
+    Binary,         // R[a] = R[b] <aux> R[c]，aux 为 BinaryOp
+    Unary,          // R[a] = <aux> R[b]，aux 为 UnaryOp
+    MakeArray,      // R[a] = [R[b], ..., R[b+c-1]]
+    Call,           // R[a] = C[b](R[c], ..., R[c+aux-1])
+    TailCall,       // 同 Call，用于 return C[b](...)：目标为用户函数时复用当前帧，后随 Return R[a]
+    Jump,           // pc = a
+    JumpIfFalse,    // if (!R[a]) pc = b
+    LoopTick,       // 循环回边的执行预算检查
+    ForPrep,        // for 循环准备：aux 非 0 时检查 R[a]..R[b] 为整数区间，否则检查 R[a] 可遍历并令 R[b] = 0
+    ForNext,        // for 循环取下一项写入 R[aux] 并前进（区间 ++R[a]，数组 ++R[b]），遍历结束时 pc = c
+    EnterRegion,    // 进入异常处理区域，aux 为 RegionKind，a 为处理入口
+    LeaveRegion,    // 离开最内层异常处理区域
+    Return,         // 返回 R[a]
+    ReturnNull,     // 执行结束（函数返回 null）
+    Complete,       // 循环外的 break/continue：以完成信号 aux 结束执行，由调用方报告
+    ExecStmt,       // 回退到树遍历执行 S[b]
+};
+
+// 异常处理区域，与树遍历解释器中对应的 try/catch 语义一致
+enum class RegionKind : uint16_t {
+    ExprStmt,       // 表达式语句：打印错误后继续执行
+    LoopBody,       // while/for 循环体：包装为 "Loop body execution error"
+    LoopCondition,  // while 条件：包装为 "Loop condition error"
+};
+
+struct Instruction {
+    OpCode op;
+    uint16_t aux;
+    int32_t a;
+    int32_t b;
+    int32_t c;
+};
+
+// 一段编译好的字节码（顶层语句或函数体）
+struct Chunk {
+    std::vector<Instruction> code;
+    std::vector<Value> constants;
+    std::vector<std::string> names;
+    std::vector<VarRef> refs;
+    // 调用点的 AST 节点，以及本 VM 实例中各调用点的目标缓存
+    std::vector<const CallExpr*> calls;
+    mutable std::vector<CallSiteCache> call_caches;
+    std::vector<const NodePtr<Statement>*> fallbacks;
+    int num_registers = 0;
+};
+
+// AST → 字节码编译器
+class BytecodeCompiler {
+public:
+    static std::unique_ptr<Chunk> compile_statement(const NodePtr<Statement>& stmt);
+    static std::unique_ptr<Chunk> compile_function(const FuncDefStmt* func);
+
+private:
+    struct LoopLabels {
+        int head;
+        std::vector<size_t> breaks;
+    };
+
+    void compile_stmt(const NodePtr<Statement>& stmt);
+    void compile_block(const BlockStmt* block);
+    void compile_expr(const Expression* expr, int dst);
+    void compile_while(const WhileStmt* ws);
+    void compile_for(const ForStmt* fs);
+    void emit_fallback(const NodePtr<Statement>& stmt);
+
+    size_t emit(OpCode op, int a = 0, int b = 0, int c = 0, uint16_t aux = 0);
+    int add_constant(const Value& v);
+    int add_name(const std::string& name, const VarRef& ref = VarRef());
+    int alloc_register();
+    int label() const { return static_cast<int>(chunk->code.size()); }
+
+    // 表达式中含有编译器不支持的节点时，整条语句回退到树遍历执行
+    static bool is_compilable(const Expression* expr);
+
+    std::unique_ptr<Chunk> chunk = std::make_unique<Chunk>();
+    std::unordered_map<std::string, int> name_index;
+    std::vector<LoopLabels> loops;
+    int next_register = 0;
+};
@@ -2,6 +2,7 @@
 #include "bigint.hpp"
 #include <string>
 #include <stdexcept>
+#include <utility>
 
 class Fraction {
 private:
@@ -16,9 +17,9 @@ private:
         abs_b.negative = false;
         
         while (!abs_b.is_zero()) {
-            BigInt temp = abs_b;
-            abs_b = abs_a % abs_b;
-            abs_a = temp;
+            BigInt remainder = abs_a.divmod(abs_b).second;
+            abs_a = std::move(abs_b);
+            abs_b = std::move(remainder);
         }
         return abs_a;
     }
@@ -37,7 +38,7 @@ private:
         
         // 化简
         BigInt g = gcd(numerator, denominator);
-        if (!g.is_zero() && !(g.digits.size() == 1 && g.digits[0] == 1)) {
+        if (!g.is_zero() && !(g.limbs.size() == 1 && g.limbs[0] == 1)) {
             numerator = numerator / g;
             denominator = denominator / g;
         }
@@ -65,7 +66,7 @@ public:
     
     // 判断是否为整数
     bool is_integer() const {
-        return denominator.digits.size() == 1 && denominator.digits[0] == 1;
+        return denominator.limbs.size() == 1 && denominator.limbs[0] == 1;
     }
     
     // 判断是否为零
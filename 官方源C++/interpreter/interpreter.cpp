@@ -4,6 +4,12 @@
 #include "lamina.hpp"
 #include "parser.hpp"
 #include "bigint.hpp"
+#include "optimizer.hpp"
+#include "resolver.hpp"
+#include "vm.hpp"
+#include "log.hpp"
+#include "script_cache.hpp"
+#include "thread_pool.hpp"
 #include <iostream>
 #include <cmath>
 #include <exception>
@@ -11,6 +17,10 @@
 #include <sstream>
 #include <cstdlib> // For std::exit
 #include <cstring> // For strcmp
+#include <deque>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
 #ifdef _WIN32
 #include <windows.h>
 #include <io.h>
@@ -34,29 +44,155 @@
 
 // 这些异常类已经移到了 interpreter.hpp
 
+Interpreter::Interpreter() : shared_builtins(builtin_table()) {
+    register_builtin_functions();
+}
+
+Interpreter::Interpreter(NoBuiltins) {}
+
+// VM 在此处为完整类型，析构函数需在源文件中定义
+Interpreter::~Interpreter() = default;
+
 // Scope stack operations
-void Interpreter::push_scope() {
-    variable_stack.emplace_back();
+void Interpreter::push_scope(const FuncDefStmt* func) {
+    if (frame_depth == local_frames.size()) {
+        local_frames.emplace_back();
+    }
+    LocalFrame& frame = local_frames[frame_depth++];
+    size_t slot_count = func ? func->locals.size() : 0;
+    frame.func = func;
+    frame.slots.assign(slot_count, Value());
+    frame.assigned.assign(slot_count, 0);
+    if (frame.extras) frame.extras->clear();
 }
 
 void Interpreter::add_function(const std::string& name, FuncDefStmt* func) {
-    functions[name] = func;
+    FuncDefStmt*& slot = functions[name];
+    if (slot != func) {
+        slot = func;
+        invalidate_call_caches();
+    }
 }
 
-void Interpreter::save_repl_ast(std::unique_ptr<ASTNode> ast) {
+void Interpreter::save_repl_ast(NodePtr<ASTNode> ast) {
     repl_asts.push_back(std::move(ast));
 }
 
 void Interpreter::pop_scope() {
-    if (variable_stack.size() > 1) variable_stack.pop_back();
+    if (frame_depth == 0) return;
+    // 帧本身保留复用，只释放其中的值
+    LocalFrame& frame = local_frames[--frame_depth];
+    frame.slots.clear();
+    frame.assigned.clear();
 }
 
-Value Interpreter::get_variable(const std::string& name) const {
-    for (auto it = variable_stack.rbegin(); it != variable_stack.rend(); ++it) {
-        auto found = it->find(name);
-        if (found != it->end()) return found->second;
+namespace {
+
+// 全局变量名到槽位的映射，进程内所有实例共用；各实例只按槽位保存自己的值
+struct GlobalSymbols {
+    std::shared_mutex mutex;
+    std::unordered_map<std::string, int> index;
+    std::deque<std::string> names;  // 按槽位排列，deque 扩展时已有元素的地址不变
+};
+
+GlobalSymbols& global_symbols() {
+    static GlobalSymbols symbols;
+    return symbols;
+}
+
+int lookup_global(const std::string& name) {
+    GlobalSymbols& symbols = global_symbols();
+    std::shared_lock<std::shared_mutex> lock(symbols.mutex);
+    auto it = symbols.index.find(name);
+    return it != symbols.index.end() ? it->second : -1;
+}
+
+const std::string& global_name(size_t slot) {
+    GlobalSymbols& symbols = global_symbols();
+    std::shared_lock<std::shared_mutex> lock(symbols.mutex);
+    return symbols.names[slot];
+}
+
+} // namespace
+
+int Interpreter::intern_global(const std::string& name) {
+    int slot = lookup_global(name);
+    if (slot >= 0) return slot;
+    GlobalSymbols& symbols = global_symbols();
+    std::unique_lock<std::shared_mutex> lock(symbols.mutex);
+    auto inserted = symbols.index.emplace(name, static_cast<int>(symbols.names.size()));
+    if (inserted.second) symbols.names.push_back(name);
+    return inserted.first->second;
+}
+
+const Value* Interpreter::global_at(int slot) const {
+    size_t index = static_cast<size_t>(slot);
+    return index < global_assigned.size() && global_assigned[index] ? &global_values[index] : nullptr;
+}
+
+void Interpreter::assign_global(int slot, const Value& val) {
+    size_t index = static_cast<size_t>(slot);
+    if (index >= global_values.size()) {
+        global_values.resize(index + 1);
+        global_assigned.resize(index + 1, 0);
+    }
+    global_values[index] = val;
+    global_assigned[index] = 1;
+}
+
+const Value* Interpreter::find_global(const std::string& name) const {
+    int slot = lookup_global(name);
+    return slot >= 0 ? global_at(slot) : nullptr;
+}
+
+// 按名称查找：从最内层帧向外，最后是全局变量
+const Value* Interpreter::find_variable_by_name(const std::string& name) const {
+    for (size_t depth = frame_depth; depth > 0; --depth) {
+        const LocalFrame& frame = local_frames[depth - 1];
+        if (frame.func) {
+            const auto& locals = frame.func->locals;
+            for (size_t i = 0; i < locals.size(); ++i) {
+                if (locals[i] == name) {
+                    if (frame.assigned[i]) return &frame.slots[i];
+                    break;
+                }
+            }
+        }
+        if (frame.extras) {
+            auto found = frame.extras->find(name);
+            if (found != frame.extras->end()) return &found->second;
+        }
+    }
+    return find_global(name);
+}
+
+const Value* Interpreter::find_variable(const VarRef& ref, const std::string& name) const {
+    switch (ref.scope) {
+    case VarRef::Scope::Local:
+        if (frame_depth > 0) {
+            const LocalFrame& frame = local_frames[frame_depth - 1];
+            if (static_cast<size_t>(ref.slot) < frame.assigned.size() && frame.assigned[ref.slot]) {
+                return &frame.slots[ref.slot];
+            }
+        }
+        // 局部变量尚未赋值时按全局变量读取
+        return find_global(name);
+    case VarRef::Scope::Global:
+        return global_at(ref.slot);
+    default:
+        return find_variable_by_name(name);
     }
+}
+
+bool Interpreter::has_variable(const std::string& name) const {
+    return find_variable_by_name(name) != nullptr;
+}
 
+bool Interpreter::is_global_name(const std::string& name) {
+    return lookup_global(name) >= 0;
+}
+
+Value Interpreter::undefined_variable(const std::string& name) const {
     // 如果变量找不到，检查是否是函数名
     auto func_it = functions.find(name);
     if (func_it != functions.end()) {
@@ -64,73 +200,132 @@ Value Interpreter::get_variable(const std::string& name) const {
         // 暂时返回一个特殊的字符串值表示函数
         return Value("__function_" + name);
     }
+    // 内置函数同样可以作为值传递
+    if (find_builtin(name) || find_interpreter_builtin(name)) {
+        return Value("__function_" + name);
+    }
 
     RuntimeError error("Undefined variable '" + name + "'");
     error.stack_trace = get_stack_trace();
     throw error;
-    return Value(); // Unreachable, but suppress compiler warning
+}
+
+Value Interpreter::get_variable(const std::string& name) const {
+    if (const Value* found = find_variable_by_name(name)) return *found;
+    return undefined_variable(name);
+}
+
+Value Interpreter::read_variable(const VarRef& ref, const std::string& name) const {
+    if (const Value* found = find_variable(ref, name)) return *found;
+    return undefined_variable(name);
 }
 
 void Interpreter::set_variable(const std::string& name, const Value& val) {
-    if (!variable_stack.empty()) {
-        (*variable_stack.rbegin())[name] = val;
+    if (frame_depth == 0) {
+        set_global_variable(name, val);
+        return;
     }
+    LocalFrame& frame = local_frames[frame_depth - 1];
+    if (frame.func) {
+        const auto& locals = frame.func->locals;
+        for (size_t i = 0; i < locals.size(); ++i) {
+            if (locals[i] == name) {
+                frame.slots[i] = val;
+                frame.assigned[i] = 1;
+                return;
+            }
+        }
+    }
+    if (!frame.extras) {
+        frame.extras = std::make_unique<std::unordered_map<std::string, Value>>();
+    }
+    (*frame.extras)[name] = val;
 }
 
-void Interpreter::set_global_variable(const std::string& name, const Value& val) {
-    if (!variable_stack.empty()) {
-        variable_stack.front()[name] = val;
+void Interpreter::write_variable(const VarRef& ref, const std::string& name, const Value& val) {
+    switch (ref.scope) {
+    case VarRef::Scope::Local:
+        if (frame_depth > 0) {
+            LocalFrame& frame = local_frames[frame_depth - 1];
+            if (static_cast<size_t>(ref.slot) < frame.slots.size()) {
+                frame.slots[ref.slot] = val;
+                frame.assigned[ref.slot] = 1;
+                return;
+            }
+        }
+        set_variable(name, val);
+        break;
+    case VarRef::Scope::Global:
+        assign_global(ref.slot, val);
+        break;
+    default:
+        set_variable(name, val);
+        break;
     }
 }
 
-void Interpreter::execute(const std::unique_ptr<Statement>& node) {
-    if (!node) return;
+void Interpreter::set_global_variable(const std::string& name, const Value& val) {
+    assign_global(intern_global(name), val);
+}
 
-    if (auto* v = dynamic_cast<VarDeclStmt*>(node.get())) {        if (v->expr) {
-        Value val = eval(v->expr.get());
-        set_variable(v->name, val);
-    } else {
-        RuntimeError error("Variable '" + v->name + "' declaration has null expression");
-        error.stack_trace = get_stack_trace();
-        throw error;
-    }
+Completion Interpreter::execute(const NodePtr<Statement>& node) {
+    if (!node) return Completion();
+
+    switch (node->kind) {
+    case NodeKind::VarDecl: {
+        auto* v = static_cast<VarDeclStmt*>(node.get());
+        if (v->expr) {
+            Value val = eval(v->expr.get());
+            write_variable(v->ref, v->name, val);
+        } else {
+            RuntimeError error("Variable '" + v->name + "' declaration has null expression");
+            error.stack_trace = get_stack_trace();
+            throw error;
+        }
+        break;
     }
-    else if (auto* d = dynamic_cast<DefineStmt*>(node.get())) {
+    case NodeKind::Define: {
+        auto* d = static_cast<DefineStmt*>(node.get());
         if (!d->value) {
             error_and_exit("Null expression in define statement for '" + d->name + "'");
         }
         Value val = eval(d->value.get());
         if (d->name == "MAX_RECURSION_DEPTH" && val.is_int()) {
-            int new_depth = std::get<int>(val.data);
-            if (new_depth > 0 && new_depth <= 10000) {
-                max_recursion_depth = new_depth;
+            int64_t new_depth = val.get<int64_t>();
+            // 字节码模式的函数调用不占用本地栈，递归深度由调用帧内存上限约束
+            int depth_cap = vm ? std::numeric_limits<int>::max() : 10000;
+            if (new_depth > 0 && new_depth <= depth_cap) {
+                max_recursion_depth = static_cast<int>(new_depth);
+                recursion_depth_defined = true;
                 std::cout << "Recursion depth limit set to: " << new_depth << std::endl;
             } else {
-                error_and_exit("Invalid recursion depth value: " + std::to_string(new_depth) + " (must be between 1 and 10000)");
+                error_and_exit("Invalid recursion depth value: " + std::to_string(new_depth) + " (must be between 1 and " + std::to_string(depth_cap) + ")");
             }
         } else {
             // 原：std::cerr << "Error: Unknown define constant: " << d->name << std::endl;
             // 已替换
 
         }
+        break;
     }
-    else if (auto* bi = dynamic_cast<BigIntDeclStmt*>(node.get())) {
+    case NodeKind::BigIntDecl: {
+        auto* bi = static_cast<BigIntDeclStmt*>(node.get());
         if (bi->init_value) {
             Value val = eval(bi->init_value.get());
             if (val.is_bigint()) {
                 // 如果值已经是BigInt，直接使用
-                set_variable(bi->name, val);
+                write_variable(bi->ref, bi->name, val);
             } else if (val.is_int()) {
                 // 将普通整数转换为BigInt
-                ::BigInt big_val(std::get<int>(val.data));
-                set_variable(bi->name, Value(big_val));
+                ::BigInt big_val(val.get<int64_t>());
+                write_variable(bi->ref, bi->name, Value(big_val));
             } else if (val.is_string()) {
                 // 从字符串创建BigInt
                 try {
-                    ::BigInt big_val(std::get<std::string>(val.data));
-                    set_variable(bi->name, Value(big_val));
+                    ::BigInt big_val(val.get<std::string>());
+                    write_variable(bi->ref, bi->name, Value(big_val));
                 } catch (const std::exception& e) {
-                    error_and_exit("Invalid BigInt string '" + std::get<std::string>(val.data)
+                    error_and_exit("Invalid BigInt string '" + val.get<std::string>()
                                 + "' in declaration of " + bi->name);
                 }
             } else {
@@ -139,27 +334,37 @@ void Interpreter::execute(const std::unique_ptr<Statement>& node) {
                             + " to BigInt in declaration of " + bi->name);
             }
         } else {
-            set_variable(bi->name, Value(::BigInt(0)));
+            write_variable(bi->ref, bi->name, Value(::BigInt(0)));
         }
+        break;
     }
-    else if (auto* a = dynamic_cast<AssignStmt*>(node.get())) {
+    case NodeKind::Assign: {
+        auto* a = static_cast<AssignStmt*>(node.get());
         if (!a->expr) {
             error_and_exit("Null expression in assignment to '" + a->name + "'");
         }
         Value val = eval(a->expr.get());
-        set_variable(a->name, val);
-    }    else if (auto* ifs = dynamic_cast<IfStmt*>(node.get())) {
+        write_variable(a->ref, a->name, val);
+        break;
+    }
+    case NodeKind::If: {
+        auto* ifs = static_cast<IfStmt*>(node.get());
         if (!ifs->condition) {
             error_and_exit("Null condition in if statement");
         }
         Value cond = eval(ifs->condition.get());
         bool cond_true = cond.as_bool();
-        if (cond_true) {
-            for (auto& stmt : ifs->thenBlock->statements) execute(stmt);
-        } else if (ifs->elseBlock) {
-            for (auto& stmt : ifs->elseBlock->statements) execute(stmt);
+        const BlockStmt* branch = cond_true ? ifs->thenBlock.get() : ifs->elseBlock.get();
+        if (branch) {
+            for (auto& stmt : branch->statements) {
+                Completion completion = execute(stmt);
+                if (completion.kind != Completion::Kind::Normal) return completion;
+            }
         }
-    } else if (auto* ws = dynamic_cast<WhileStmt*>(node.get())) {
+        break;
+    }
+    case NodeKind::While: {
+        auto* ws = static_cast<WhileStmt*>(node.get());
         if (!ws->condition) {
             RuntimeError error("Loop condition cannot be null");
             error.stack_trace = get_stack_trace();
@@ -167,24 +372,17 @@ void Interpreter::execute(const std::unique_ptr<Statement>& node) {
         }
 
         // 更健壮的while循环实现
-        int iteration_count = 0;
-        const int MAX_ITERATIONS = 100000; // 防止无限循环
-
         try {
             while (true) {
-                // 安全检查：防止无限循环
-                if (++iteration_count > MAX_ITERATIONS) {
-                    Interpreter::print_warning("Loop exceeded " + std::to_string(MAX_ITERATIONS) +
-                                              " iterations, possible infinite loop, terminating", true);
-                    RuntimeError error("Possible infinite loop terminated");
-                    error.stack_trace = get_stack_trace();
-                    throw error;
-                }
+                // 执行预算检查：长时间运行的循环可被 fuel、时限或中断终止
+                tick();
 
                 // 评估循环条件
                 Value cond;
                 try {
                     cond = eval(ws->condition.get());
+                } catch (const ExecutionAborted&) {
+                    throw;
                 } catch (const std::exception& e) {
                     // 如果条件计算出错，优雅地退出循环
                     RuntimeError error("Loop condition error: " + std::string(e.what()));
@@ -197,28 +395,23 @@ void Interpreter::execute(const std::unique_ptr<Statement>& node) {
                     break;
                 }
 
-                bool continue_encountered = false;
-
                 // 执行循环体
                 for (auto& stmt : ws->body->statements) {
-                    if (continue_encountered) continue;
-
-                    try {
-                        execute(stmt);
-                    } catch (const BreakException&) {
+                    Completion completion = execute(stmt);
+                    if (completion.kind == Completion::Kind::Normal) continue;
+                    if (completion.kind == Completion::Kind::Break) {
                         // 退出整个循环
-                        return;
-                    } catch (const ContinueException&) {
+                        return Completion();
+                    }
+                    if (completion.kind == Completion::Kind::Continue) {
                         // 跳到下一次迭代
-                        continue_encountered = true;
+                        break;
                     }
+                    // 函数返回，直接传递给上层
+                    return completion;
                 }
             }
-        } catch (const BreakException&) {
-            // 捕获可能从嵌套块冒泡上来的break异常
-            return;
-        } catch (const ReturnException&) {
-            // 函数返回，直接传递给上层
+        } catch (const ExecutionAborted&) {
             throw;
         } catch (const std::exception& e) {
             // 所有其他异常都作为运行时错误处理
@@ -226,34 +419,48 @@ void Interpreter::execute(const std::unique_ptr<Statement>& node) {
             error.stack_trace = get_stack_trace();
             throw error;
         }
-    } else if (auto* func = dynamic_cast<FuncDefStmt*>(node.get())) {
-        functions[func->name] = func;
-    }
-    else if (auto* block = dynamic_cast<BlockStmt*>(node.get())) {
-        for (auto& stmt : block->statements) execute(stmt);
+        break;
     }
-    else if (auto* ret = dynamic_cast<ReturnStmt*>(node.get())) {
-        Value val = eval(ret->expr.get());
-        throw ReturnException(val);
+    case NodeKind::For:
+        return execute_for(static_cast<ForStmt*>(node.get()));
+    case NodeKind::FuncDef: {
+        auto* func = static_cast<FuncDefStmt*>(node.get());
+        add_function(func->name, func);
+        break;
     }
-    else if (auto* breakStmt = dynamic_cast<BreakStmt*>(node.get())) {
-        (void)breakStmt; // 避免未使用变量警告
-        throw BreakException();
+    case NodeKind::Block: {
+        auto* block = static_cast<BlockStmt*>(node.get());
+        for (auto& stmt : block->statements) {
+            Completion completion = execute(stmt);
+            if (completion.kind != Completion::Kind::Normal) return completion;
+        }
+        break;
     }
-    else if (auto* contStmt = dynamic_cast<ContinueStmt*>(node.get())) {
-        (void)contStmt; // 避免未使用变量警告
-        throw ContinueException();
+    case NodeKind::Return: {
+        auto* ret = static_cast<ReturnStmt*>(node.get());
+        return Completion{Completion::Kind::Return, eval(ret->expr.get())};
     }
-    else if (auto* includeStmt = dynamic_cast<IncludeStmt*>(node.get())) {
+    case NodeKind::Break:
+        return Completion{Completion::Kind::Break, Value()};
+    case NodeKind::Continue:
+        return Completion{Completion::Kind::Continue, Value()};
+    case NodeKind::Include: {
+        auto* includeStmt = static_cast<IncludeStmt*>(node.get());
         if (!load_module(includeStmt->module)) {
             error_and_exit("Failed to include module '" + includeStmt->module + "'");
         }
-    } else if (auto* exprstmt = dynamic_cast<ExprStmt*>(node.get())) {
+        break;
+    }
+    case NodeKind::ExprStmt: {
+        auto* exprstmt = static_cast<ExprStmt*>(node.get());
         if (exprstmt->expr) {
             try {
-                std::cerr << "DEBUG: Executing expression statement" << std::endl;
+                LAMINA_LOG(Trace, Interpreter, "Executing expression statement");
                 Value result = eval(exprstmt->expr.get());
-                std::cerr << "DEBUG: Expression result: " << result.to_string() << std::endl;
+                LAMINA_LOG(Trace, Interpreter, "Expression result: " << result.to_string());
+                (void)result;
+            } catch (const ExecutionAborted&) {
+                throw;
             } catch (const std::exception& e) {
                 std::cerr << "ERROR: Exception in expression statement: " << e.what() << std::endl;
             } catch (...) {
@@ -262,7 +469,12 @@ void Interpreter::execute(const std::unique_ptr<Statement>& node) {
         } else {
             error_and_exit("Empty expression statement");
         }
+        break;
+    }
+    default:
+        break;
     }
+    return Completion();
 }
 
 
@@ -270,608 +482,857 @@ Value Interpreter::eval(const ASTNode* node) {
     if (!node) {
         error_and_exit("Attempted to evaluate null expression");
     }
-    if (auto* lit = dynamic_cast<const LiteralExpr*>(node)) {
-        // Try to parse as number first
-        try {
-            // Check if it contains a decimal point for float
-            if (lit->value.find('.') != std::string::npos) {
-                double d = std::stod(lit->value);
-                return Value(d);
-            } else {
-                // 先尝试用 int 解析，只有溢出时才用 BigInt
-                try {
-                    int i = std::stoi(lit->value);
-                    return Value(i);
-                } catch (const std::out_of_range&) {
-                    // int 溢出，使用 BigInt
-                    ::BigInt big(lit->value);
-                    return Value(big);
-                }
-            }
-        } catch (...) {
-            // Check for boolean literals
-            if (lit->value == "true") return Value(true);
-            if (lit->value == "false") return Value(false);
-            if (lit->value == "null") return Value(nullptr);
-            // Otherwise it's a string
-            return Value(lit->value);
-        }
+    switch (node->kind) {
+    case NodeKind::Literal: {
+        return static_cast<const LiteralExpr*>(node)->value;
     }
-    else if (auto* id = dynamic_cast<const IdentifierExpr*>(node)) {
-        return get_variable(id->name);
+    case NodeKind::Identifier: {
+        auto* id = static_cast<const IdentifierExpr*>(node);
+        return read_variable(id->ref, id->name);
     }
-    else if (auto* var = dynamic_cast<const VarExpr*>(node)) {
-        return get_variable(var->name);
+    case NodeKind::Var: {
+        auto* var = static_cast<const VarExpr*>(node);
+        return read_variable(var->ref, var->name);
     }
-    else if (auto* bin = dynamic_cast<const BinaryExpr*>(node)) {
+    case NodeKind::Binary: {
+        auto* bin = static_cast<const BinaryExpr*>(node);
         Value l = eval(bin->left.get());
         Value r = eval(bin->right.get());
-
-        // Handle arithmetic operations
-        if (bin->op == "+") {
-            // String concatenation
-            if (l.is_string() || r.is_string()) {
-                return Value(l.to_string() + r.to_string());
-            }
-            // Vector addition
-            else if (l.is_array() && r.is_array()) {
-                return l.vector_add(r);
-            }
-            // Numeric addition with irrational and rational number support
-            else if (l.is_numeric() && r.is_numeric()) {
-                // BigInt 优先：如果任一为 BigInt，结果为 BigInt
-                if (l.is_bigint() || r.is_bigint()) {
-                    ::BigInt lb = l.is_bigint() ? std::get<::BigInt>(l.data) : ::BigInt(l.as_number());
-                    ::BigInt rb = r.is_bigint() ? std::get<::BigInt>(r.data) : ::BigInt(r.as_number());
-                    return Value(lb + rb);
-                }
-                // If either operand is irrational, use irrational arithmetic
-                if (l.is_irrational() || r.is_irrational()) {
-                    ::Irrational result = l.as_irrational() + r.as_irrational();
-                    return Value(result);
-                }
-                // If either operand is rational, use rational arithmetic
-                if (l.is_rational() || r.is_rational()) {
-                    ::Rational result = l.as_rational() + r.as_rational();
-                    return Value(result);
-                }
-
-                double result = l.as_number() + r.as_number();                // Return int if both operands are int and result is whole
-                if (l.is_int() && r.is_int()) {
-                    return Value(static_cast<int>(result));
-                }
-                return Value(result);
-            }
-            else {
-                error_and_exit("Cannot add " + l.to_string() + " and " + r.to_string());
+        return binary_op(bin->op, l, r);
+    }
+    case NodeKind::Unary: {
+        auto* unary = static_cast<const UnaryExpr*>(node);
+        Value v = eval(unary->operand.get());
+        return unary_op(unary->op, v);
+    }
+    // Support function calls
+    case NodeKind::Call: {
+        auto* call = static_cast<const CallExpr*>(node);
+        // 实参在调用方作用域内求值，再交给统一的调用入口
+        std::vector<Value> args;
+        args.reserve(call->args.size());
+        for (const auto& arg : call->args) {
+            if (!arg) {
+                RuntimeError err("Null argument in call to function '" + call->callee + "'");
+                err.stack_trace = get_stack_trace();
+                throw err;
             }
-        }        // Arithmetic operations (require numeric operands or vector operations)
-        if (bin->op == "-" || bin->op == "*" || bin->op == "/" ||
-            bin->op == "%" || bin->op == "^") {
-
-            // Special handling for multiplication
-            if (bin->op == "*") {
-                // Vector and matrix operations
-                if (l.is_array() && r.is_array()) {
-                    // Try dot product for same-size vectors
-                    const auto& la = std::get<std::vector<Value>>(l.data);
-                    const auto& ra = std::get<std::vector<Value>>(r.data);
-                    if (la.size() == ra.size()) {
-                        return l.dot_product(r);
-                    }
-                }
-                // Matrix multiplication
-                if (l.is_matrix() && r.is_matrix()) {
-                    return l.matrix_multiply(r);
-                }
-                // Scalar multiplication for vectors
-                if (l.is_array() && r.is_numeric()) {
-                    return l.scalar_multiply(r.as_number());
-                }
-                if (l.is_numeric() && r.is_array()) {
-                    return r.scalar_multiply(l.as_number());
-                }
-                // Regular multiplication (both must be numeric)
-                if (l.is_numeric() && r.is_numeric()) {
-                    // BigInt 优先：如果任一为 BigInt，结果为 BigInt
-                    if (l.is_bigint() || r.is_bigint()) {
-                        ::BigInt lb = l.is_bigint() ? std::get<::BigInt>(l.data) : ::BigInt(l.as_number());
-                        ::BigInt rb = r.is_bigint() ? std::get<::BigInt>(r.data) : ::BigInt(r.as_number());
-                        return Value(lb * rb);
-                    }
-                    // If either operand is irrational, use irrational arithmetic
-                    if (l.is_irrational() || r.is_irrational()) {
-                        ::Irrational result = l.as_irrational() * r.as_irrational();
-                        return Value(result);
-                    }
-                    // If either operand is rational, use rational arithmetic
-                    if (l.is_rational() || r.is_rational()) {
-                        ::Rational result = l.as_rational() * r.as_rational();
-                        return Value(result);
-                    }
-
-                    double result = l.as_number() * r.as_number();
-                    return (l.is_int() && r.is_int()) ? Value(static_cast<int>(result)) : Value(result);
-                }
-                // Error case
-                error_and_exit("Cannot multiply " + l.to_string() + " and " + r.to_string());
+            args.push_back(eval(arg.get()));
+        }
+        return call_function(call, args);
+    }
+    case NodeKind::Array: {
+        auto* arr = static_cast<const ArrayExpr*>(node);
+        std::vector<Value> elements;
+        for (const auto& element : arr->elements) {
+            if (element) {
+                elements.push_back(eval(element.get()));
+            } else {
+                std::cerr << "Error: Null element in array literal" << std::endl;
+                return Value();
             }
+        }
+        return Value(elements);
+    }
+    default:
+        break;
+    }
+    std::cerr << "Error: Unsupported expression type" << std::endl;
+    return Value("<type error>");
+}
 
-            // Other arithmetic operations require both operands to be numeric
-            if (!l.is_numeric() || !r.is_numeric()) {
-                error_and_exit("Arithmetic operation '" + bin->op + "' requires numeric operands");
-            }
+// 二元运算处理函数：每个运算符一个，操作数已求值，树遍历与字节码 VM 共用
 
-            // For division, always use rational arithmetic for precise results
-            if (bin->op == "/") {
-                // BigInt 优先：如果任一为 BigInt，结果为 BigInt（如果整除）或 Rational
-                if (l.is_bigint() || r.is_bigint()) {
-                    ::BigInt lb = l.is_bigint() ? std::get<::BigInt>(l.data) : ::BigInt(l.as_number());
-                    ::BigInt rb = r.is_bigint() ? std::get<::BigInt>(r.data) : ::BigInt(r.as_number());
-                    if (rb.is_zero()) {
-                        error_and_exit("Division by zero");
-                    }
-                    // 对于BigInt除法，如果能整除则返回BigInt，否则返回Rational
-                    try {
-                        ::BigInt quotient = lb / rb;
-                        ::BigInt remainder = lb - (quotient * rb);
-                        if (remainder.is_zero()) {
-                            return Value(quotient);
-                        } else {
-                            // 不能整除，返回有理数
-                            return Value(::Rational(lb.to_int(), rb.to_int()));
-                        }
-                    } catch (...) {
-                        // 如果BigInt运算失败，回退到Rational
-                        return Value(::Rational(lb.to_int(), rb.to_int()));
-                    }
-                }
-                // If either operand is irrational, use irrational arithmetic
-                if (l.is_irrational() || r.is_irrational()) {
-                    ::Irrational lr = l.as_irrational();
-                    ::Irrational rr = r.as_irrational();
-                    if (rr.is_zero()) {
-                        error_and_exit("Division by zero");
-                    }
-                    return Value(lr / rr);
-                }
+static ::BigInt to_bigint(const Value& v) {
+    if (v.is_bigint()) return v.get<::BigInt>();
+    // Int 精确转换；其他数值按截断后的整数处理
+    if (v.is_int()) return ::BigInt(static_cast<long long>(v.get<int64_t>()));
+    return ::BigInt(static_cast<long long>(v.as_number()));
+}
 
-                ::Rational lr = l.as_rational();
-                ::Rational rr = r.as_rational();
-                if (rr.is_zero()) {
-                    error_and_exit("Division by zero");
-                }
-                return Value(lr / rr);
-            }
+// 64 位整数的带溢出检查运算，溢出时返回 false，由调用方改用 BigInt 计算
+static bool checked_add(int64_t a, int64_t b, int64_t& out) {
+#if defined(__GNUC__) || defined(__clang__)
+    return !__builtin_add_overflow(a, b, &out);
+#else
+    if ((b > 0 && a > INT64_MAX - b) || (b < 0 && a < INT64_MIN - b)) return false;
+    out = a + b;
+    return true;
+#endif
+}
 
-            // Use irrational arithmetic if either operand is irrational
-            if (l.is_irrational() || r.is_irrational()) {
-                ::Irrational lr = l.as_irrational();
-                ::Irrational rr = r.as_irrational();
+static bool checked_sub(int64_t a, int64_t b, int64_t& out) {
+#if defined(__GNUC__) || defined(__clang__)
+    return !__builtin_sub_overflow(a, b, &out);
+#else
+    if ((b < 0 && a > INT64_MAX + b) || (b > 0 && a < INT64_MIN + b)) return false;
+    out = a - b;
+    return true;
+#endif
+}
 
-                if (bin->op == "-") {
-                    return Value(lr - rr);
-                }
-                // Note: Other operations (%, ^) may fall back to double arithmetic
-                // for irrational numbers as they're complex to handle exactly
-            }
+static bool checked_mul(int64_t a, int64_t b, int64_t& out) {
+#if defined(__GNUC__) || defined(__clang__)
+    return !__builtin_mul_overflow(a, b, &out);
+#else
+    if (a == 0 || b == 0) {
+        out = 0;
+        return true;
+    }
+    if ((a == -1 && b == INT64_MIN) || (b == -1 && a == INT64_MIN)) return false;
+    int64_t product = static_cast<int64_t>(static_cast<uint64_t>(a) * static_cast<uint64_t>(b));
+    if (product / b != a) return false;
+    out = product;
+    return true;
+#endif
+}
 
-            // Use rational arithmetic if either operand is rational
-            if (l.is_rational() || r.is_rational()) {
-                ::Rational lr = l.as_rational();
-                ::Rational rr = r.as_rational();
+static void require_numeric(BinaryOp op, const Value& l, const Value& r) {
+    // Arithmetic operations require both operands to be numeric
+    if (!l.is_numeric() || !r.is_numeric()) {
+        error_and_exit(std::string("Arithmetic operation '") + binary_op_name(op) + "' requires numeric operands");
+    }
+}
 
-                if (bin->op == "-") {
-                    return Value(lr - rr);
-                }
-                if (bin->op == "%") {
-                    // For rational modulo, convert to double temporarily
-                    double ld = lr.to_double();
-                    double rd = rr.to_double();
-                    if (rd == 0.0) {
-                        error_and_exit("Modulo by zero");
-                    }
-                    return Value(static_cast<int>(ld) % static_cast<int>(rd));
-                }
-                if (bin->op == "^") {
-                    // For rational exponentiation, use integer exponent if possible
-                    if (rr.is_integer() && rr.get_denominator() == 1) {
-                        int exp = static_cast<int>(rr.get_numerator());
-                        if (exp >= -1000 && exp <= 1000) { // Reasonable range
-                            return Value(lr.pow(exp));
-                        }
-                    }
-                    // Fall back to double arithmetic for non-integer or large exponents
-                    return Value(std::pow(lr.to_double(), rr.to_double()));
-                }
-            }
+static Value op_add(const Value& l, const Value& r) {
+    // 整数快速路径，溢出时提升为 BigInt
+    if (l.is_int() && r.is_int()) {
+        int64_t result;
+        if (checked_add(l.get<int64_t>(), r.get<int64_t>(), result)) return Value(result);
+        return Value(to_bigint(l) + to_bigint(r));
+    }
+    // String concatenation
+    if (l.is_string() || r.is_string()) {
+        return Value(l.to_string() + r.to_string());
+    }
+    // Vector addition
+    if (l.is_array() && r.is_array()) {
+        return l.vector_add(r);
+    }
+    // Numeric addition with irrational and rational number support
+    if (l.is_numeric() && r.is_numeric()) {
+        // BigInt 优先：如果任一为 BigInt，结果为 BigInt
+        if (l.is_bigint() || r.is_bigint()) {
+            return Value(to_bigint(l) + to_bigint(r));
+        }
+        // If either operand is irrational, use irrational arithmetic
+        if (l.is_irrational() || r.is_irrational()) {
+            return Value(l.as_irrational() + r.as_irrational());
+        }
+        // If either operand is rational, use rational arithmetic
+        if (l.is_rational() || r.is_rational()) {
+            return Value(l.as_rational() + r.as_rational());
+        }
 
-            // BigInt 运算优先：如果任一为 BigInt，结果为 BigInt
-            if (l.is_bigint() || r.is_bigint()) {
-                ::BigInt lb = l.is_bigint() ? std::get<::BigInt>(l.data) : ::BigInt(l.as_number());
-                ::BigInt rb = r.is_bigint() ? std::get<::BigInt>(r.data) : ::BigInt(r.as_number());
-                
-                if (bin->op == "-") {
-                    return Value(lb - rb);
-                }
-                if (bin->op == "%") {
-                    if (rb.is_zero()) {
-                        error_and_exit("Modulo by zero");
-                    }
-                    // BigInt 模运算需要实现，这里暂时转换为int处理
-                    int li = lb.to_int();
-                    int ri = rb.to_int();
-                    return Value(li % ri);
-                }
-                if (bin->op == "^") {
-                    // BigInt 幂运算，转换为double处理大数
-                    double ld = lb.to_int();
-                    double rd = rb.to_int();
-                    return Value(std::pow(ld, rd));
-                }
-            }
+        return Value(l.as_number() + r.as_number());
+    }
+    error_and_exit("Cannot add " + l.to_string() + " and " + r.to_string());
+    return Value();
+}
 
-            // Fall back to double arithmetic
-            double ld = l.as_number();
-            double rd = r.as_number();
+static Value op_sub(const Value& l, const Value& r) {
+    if (l.is_int() && r.is_int()) {
+        int64_t result;
+        if (checked_sub(l.get<int64_t>(), r.get<int64_t>(), result)) return Value(result);
+        return Value(to_bigint(l) - to_bigint(r));
+    }
+    require_numeric(BinaryOp::Sub, l, r);
+    if (l.is_irrational() || r.is_irrational()) {
+        return Value(l.as_irrational() - r.as_irrational());
+    }
+    if (l.is_rational() || r.is_rational()) {
+        return Value(l.as_rational() - r.as_rational());
+    }
+    // BigInt 运算优先：如果任一为 BigInt，结果为 BigInt
+    if (l.is_bigint() || r.is_bigint()) {
+        return Value(to_bigint(l) - to_bigint(r));
+    }
+    return Value(l.as_number() - r.as_number());
+}
 
-            if (bin->op == "-") {
-                double result = ld - rd;
-                return (l.is_int() && r.is_int()) ? Value(static_cast<int>(result)) : Value(result);
-            }
-            if (bin->op == "%") {
-                if (rd == 0.0) {
-                    // 原：std::cerr << "Error: Modulo by zero" << std::endl;
-                    error_and_exit("Modulo by zero");
-                }
-                return Value(static_cast<int>(ld) % static_cast<int>(rd));
-            }
-            if (bin->op == "^") {
-                return Value(std::pow(ld, rd));
-            }
+static Value op_mul(const Value& l, const Value& r) {
+    if (l.is_int() && r.is_int()) {
+        int64_t result;
+        if (checked_mul(l.get<int64_t>(), r.get<int64_t>(), result)) return Value(result);
+        return Value(to_bigint(l) * to_bigint(r));
+    }
+    // Vector and matrix operations
+    if (l.is_array() && r.is_array()) {
+        // Try dot product for same-size vectors
+        const auto& la = l.get<std::vector<Value>>();
+        const auto& ra = r.get<std::vector<Value>>();
+        if (la.size() == ra.size()) {
+            return l.dot_product(r);
+        }
+    }
+    // Matrix multiplication
+    if (l.is_matrix() && r.is_matrix()) {
+        return l.matrix_multiply(r);
+    }
+    // Scalar multiplication for vectors
+    if (l.is_array() && r.is_numeric()) {
+        return l.scalar_multiply(r.as_number());
+    }
+    if (l.is_numeric() && r.is_array()) {
+        return r.scalar_multiply(l.as_number());
+    }
+    // Regular multiplication (both must be numeric)
+    if (l.is_numeric() && r.is_numeric()) {
+        // BigInt 优先：如果任一为 BigInt，结果为 BigInt
+        if (l.is_bigint() || r.is_bigint()) {
+            return Value(to_bigint(l) * to_bigint(r));
+        }
+        // If either operand is irrational, use irrational arithmetic
+        if (l.is_irrational() || r.is_irrational()) {
+            return Value(l.as_irrational() * r.as_irrational());
+        }
+        // If either operand is rational, use rational arithmetic
+        if (l.is_rational() || r.is_rational()) {
+            return Value(l.as_rational() * r.as_rational());
         }
 
-        // Comparison operators
-        if (bin->op == "==" || bin->op == "!=" || bin->op == "<" ||
-            bin->op == "<=" || bin->op == ">" || bin->op == ">=") {
-
-            // Handle different type combinations
-            if (l.is_numeric() && r.is_numeric()) {
-                // BigInt 比较优先
-                if (l.is_bigint() || r.is_bigint()) {
-                    ::BigInt lb = l.is_bigint() ? std::get<::BigInt>(l.data) : ::BigInt(l.as_number());
-                    ::BigInt rb = r.is_bigint() ? std::get<::BigInt>(r.data) : ::BigInt(r.as_number());
-                    
-                    // 使用字符串比较来判断大小（这是一个简化的实现）
-                    std::string ls = lb.to_string();
-                    std::string rs = rb.to_string();
-                    
-                    if (bin->op == "==") return Value(ls == rs);
-                    if (bin->op == "!=") return Value(ls != rs);
-                    
-                    // 对于大小比较，需要考虑符号和长度
-                    bool lb_neg = ls[0] == '-';
-                    bool rb_neg = rs[0] == '-';
-                    
-                    if (lb_neg && !rb_neg) {
-                        // 左负右正
-                        if (bin->op == "<") return Value(true);
-                        if (bin->op == "<=") return Value(true);
-                        if (bin->op == ">") return Value(false);
-                        if (bin->op == ">=") return Value(false);
-                    } else if (!lb_neg && rb_neg) {
-                        // 左正右负
-                        if (bin->op == "<") return Value(false);
-                        if (bin->op == "<=") return Value(false);
-                        if (bin->op == ">") return Value(true);
-                        if (bin->op == ">=") return Value(true);
-                    } else {
-                        // 同号比较：比较绝对值的长度和字典序
-                        std::string labs = lb_neg ? ls.substr(1) : ls;
-                        std::string rabs = rb_neg ? rs.substr(1) : rs;
-                        
-                        bool abs_less;
-                        if (labs.length() != rabs.length()) {
-                            abs_less = labs.length() < rabs.length();
-                        } else {
-                            abs_less = labs < rabs;
-                        }
-                        
-                        bool result_less = lb_neg ? !abs_less : abs_less;
-                        
-                        if (bin->op == "<") return Value(result_less);
-                        if (bin->op == "<=") return Value(result_less || ls == rs);
-                        if (bin->op == ">") return Value(!result_less && ls != rs);
-                        if (bin->op == ">=") return Value(!result_less);
-                    }
-                } else {
-                    double ld = l.as_number();
-                    double rd = r.as_number();
-
-                    if (bin->op == "==") return Value(ld == rd);
-                    if (bin->op == "!=") return Value(ld != rd);
-                    if (bin->op == "<") return Value(ld < rd);
-                    if (bin->op == "<=") return Value(ld <= rd);
-                    if (bin->op == ">") return Value(ld > rd);
-                    if (bin->op == ">=") return Value(ld >= rd);
-                }
-            }
-            else if (l.is_string() && r.is_string()) {
-                std::string ls = std::get<std::string>(l.data);
-                std::string rs = std::get<std::string>(r.data);
-
-                if (bin->op == "==") return Value(ls == rs);
-                if (bin->op == "!=") return Value(ls != rs);
-                if (bin->op == "<") return Value(ls < rs);
-                if (bin->op == "<=") return Value(ls <= rs);
-                if (bin->op == ">") return Value(ls > rs);
-                if (bin->op == ">=") return Value(ls >= rs);
-            }
-            else if (l.is_bool() && r.is_bool()) {
-                bool lb = std::get<bool>(l.data);
-                bool rb = std::get<bool>(r.data);
-
-                if (bin->op == "==") return Value(lb == rb);
-                if (bin->op == "!=") return Value(lb != rb);
-                // For booleans, false < true
-                if (bin->op == "<") return Value(lb < rb);
-                if (bin->op == "<=") return Value(lb <= rb);
-                if (bin->op == ">") return Value(lb > rb);
-                if (bin->op == ">=") return Value(lb >= rb);
-            }
-            else {
-                // Type mismatch - only equality/inequality make sense
-                if (bin->op == "==") return Value(false); // Different types are never equal
-                if (bin->op == "!=") return Value(true); // Different types are always not equal
+        return Value(l.as_number() * r.as_number());
+    }
+    // Error case
+    error_and_exit("Cannot multiply " + l.to_string() + " and " + r.to_string());
+    return Value();
+}
 
-                error_and_exit("Cannot compare different types with operator '" + bin->op + "'");
-                return Value();
-            }
+static Value op_div(const Value& l, const Value& r) {
+    require_numeric(BinaryOp::Div, l, r);
+    // BigInt 优先：如果任一为 BigInt，结果为 BigInt（如果整除）或 Rational
+    if (l.is_bigint() || r.is_bigint()) {
+        ::BigInt lb = to_bigint(l);
+        ::BigInt rb = to_bigint(r);
+        if (rb.is_zero()) {
+            error_and_exit("Division by zero");
+        }
+        // 对于BigInt除法，如果能整除则返回BigInt，否则返回约分后的Rational
+        std::pair<::BigInt, ::BigInt> qr = lb.divmod(rb);
+        if (qr.second.is_zero()) {
+            return Value(qr.first);
         }
+        // 辗转相除求最大公约数（符号不影响约分结果）
+        ::BigInt a = rb;
+        ::BigInt b = std::move(qr.second);
+        while (!b.is_zero()) {
+            ::BigInt remainder = a.divmod(b).second;
+            a = std::move(b);
+            b = std::move(remainder);
+        }
+        ::BigInt num = lb / a;
+        ::BigInt den = rb / a;
+        // Rational 的分子分母为 64 位整数，约分后仍放不下时报错，不返回截断的结果
+        if (!num.fits_int64() || !den.fits_int64()) {
+            throw RuntimeError("Non-integer division result exceeds the rational number range");
+        }
+        return Value(::Rational(num.to_int64(), den.to_int64()));
+    }
+    // If either operand is irrational, use irrational arithmetic
+    if (l.is_irrational() || r.is_irrational()) {
+        ::Irrational lr = l.as_irrational();
+        ::Irrational rr = r.as_irrational();
+        if (rr.is_zero()) {
+            error_and_exit("Division by zero");
+        }
+        return Value(lr / rr);
+    }
 
-        error_and_exit("Unknown binary operator '" + bin->op + "'");
+    // For division, always use rational arithmetic for precise results
+    ::Rational lr = l.as_rational();
+    ::Rational rr = r.as_rational();
+    if (rr.is_zero()) {
+        error_and_exit("Division by zero");
+    }
+    return Value(lr / rr);
+}
 
+static Value op_mod(const Value& l, const Value& r) {
+    if (l.is_int() && r.is_int()) {
+        int64_t rv = r.get<int64_t>();
+        if (rv == 0) {
+            error_and_exit("Modulo by zero");
+        }
+        // INT64_MIN % -1 在 C++ 中未定义，结果为 0
+        if (rv == -1) return Value(0);
+        return Value(l.get<int64_t>() % rv);
     }
-    else if (auto* unary = dynamic_cast<const UnaryExpr*>(node)) {
-        Value v = eval(unary->operand.get());
-          if (v.type != Value::Type::Int && v.type != Value::Type::BigInt) {
-            RuntimeError error("Unary operator requires integer or big integer operand");
-            error.stack_trace = get_stack_trace();
-            throw error;
+    require_numeric(BinaryOp::Mod, l, r);
+    // 无理数取模与其他运算一样回退到有理数或浮点运算
+    if (l.is_rational() || r.is_rational()) {
+        // For rational modulo, convert to double temporarily
+        double ld = l.as_rational().to_double();
+        double rd = r.as_rational().to_double();
+        if (rd == 0.0) {
+            error_and_exit("Modulo by zero");
+        }
+        return Value(static_cast<int>(ld) % static_cast<int>(rd));
+    }
+    if (l.is_bigint() || r.is_bigint()) {
+        ::BigInt rb = to_bigint(r);
+        if (rb.is_zero()) {
+            error_and_exit("Modulo by zero");
         }
+        return Value(to_bigint(l) % rb);
+    }
+    double ld = l.as_number();
+    double rd = r.as_number();
+    if (rd == 0.0) {
+        error_and_exit("Modulo by zero");
+    }
+    return Value(static_cast<int>(ld) % static_cast<int>(rd));
+}
 
-        if (unary->op == "-") {
-            if (v.type == Value::Type::Int) {
-                int vi = std::get<int>(v.data);
-                return Value(-vi);
-            } else {
-                // For BigInt, we need to implement negation
-                ::BigInt big_val = std::get<::BigInt>(v.data);
-                // For now, convert to int if possible
-                return Value(-big_val.to_int());
-            }
+// 整数幂结果超过该位数时不再精确计算，退回浮点运算
+static constexpr size_t MAX_EXACT_POWER_BITS = size_t(1) << 24;
+
+// 整数的非负整数次幂：先用 64 位整数计算，溢出或有 BigInt 操作数时用 BigInt::power
+static Value integer_power(const Value& l, const Value& r) {
+    if (l.is_int() && r.is_int()) {
+        int64_t base = l.get<int64_t>();
+        int64_t exp = r.get<int64_t>();
+        int64_t result = 1;
+        bool overflow = false;
+        while (exp > 0 && !overflow) {
+            if ((exp & 1) && !checked_mul(result, base, result)) overflow = true;
+            exp >>= 1;
+            // 还有更高位时才需要平方，此时平方溢出意味着结果溢出
+            if (exp > 0 && !overflow && !checked_mul(base, base, base)) overflow = true;
         }
+        if (!overflow) return Value(result);
+    }
+    ::BigInt base = to_bigint(l);
+    ::BigInt exp = to_bigint(r);
+    // 结果至少有 exp * (bit_length - 1) 位；0、1、-1 的幂不会变大
+    size_t base_bits = base.bit_length();
+    if (base_bits > 1 &&
+        (!exp.fits_int64() || static_cast<unsigned long long>(exp.to_int64()) > MAX_EXACT_POWER_BITS / (base_bits - 1))) {
+        return Value(std::pow(base.to_double(), exp.to_double()));
+    }
+    return Value(base.power(exp));
+}
 
-        if (unary->op == "!") {
-            int vi;
-            if (v.type == Value::Type::Int) {
-                vi = std::get<int>(v.data);
-            } else {
-                vi = std::get<::BigInt>(v.data).to_int();
+static Value op_pow(const Value& l, const Value& r) {
+    require_numeric(BinaryOp::Pow, l, r);
+    if (l.is_rational() || r.is_rational()) {
+        ::Rational lr = l.as_rational();
+        ::Rational rr = r.as_rational();
+        // For rational exponentiation, use integer exponent if possible
+        if (rr.is_integer() && rr.get_denominator() == 1) {
+            int exp = static_cast<int>(rr.get_numerator());
+            if (exp >= -1000 && exp <= 1000) { // Reasonable range
+                return Value(lr.pow(exp));
             }
+        }
+        // Fall back to double arithmetic for non-integer or large exponents
+        return Value(std::pow(lr.to_double(), rr.to_double()));
+    }
+    bool integral = (l.is_int() || l.is_bigint()) && (r.is_int() || r.is_bigint());
+    bool negative_exp = r.is_int() ? r.get<int64_t>() < 0 : r.as_number() < 0;
+    if (integral && !negative_exp) {
+        return integer_power(l, r);
+    }
+    return Value(std::pow(l.as_number(), r.as_number()));
+}
 
-            if (vi < 0) {
-                RuntimeError error("Cannot calculate factorial of negative number");
-                error.stack_trace = get_stack_trace();
-                throw error;
-            }
+// x^2 的强度削减形式：整数与浮点数直接相乘（结果与 op_pow(x, 2) 相同），其余按幂运算处理
+static Value op_square(const Value& v) {
+    if (v.is_int()) {
+        int64_t result;
+        if (checked_mul(v.get<int64_t>(), v.get<int64_t>(), result)) return Value(result);
+        return Value(to_bigint(v) * to_bigint(v));
+    }
+    if (v.is_float()) {
+        double d = v.get<double>();
+        return Value(d * d);
+    }
+    return op_pow(v, Value(2));
+}
 
-            // Use BigInt for factorial if the number is large or result would be large
-            if (vi > 20) {
-                ::BigInt result(1);
-                for (int j = 2; j <= vi; ++j) {
-                    result = result * ::BigInt(j);
-                }
-                return Value(result);
-            } else {
-                // Use regular int for small factorials
-                int res = 1;
-                for (int j = 1; j <= vi; ++j) res *= j;
-                return Value(res);
-            }
+// 比较运算共用同一套类型规则
+template <class T>
+static Value compare_ordered(BinaryOp op, const T& a, const T& b) {
+    switch (op) {
+    case BinaryOp::Eq: return Value(a == b);
+    case BinaryOp::Ne: return Value(a != b);
+    case BinaryOp::Lt: return Value(a < b);
+    case BinaryOp::Le: return Value(a <= b);
+    case BinaryOp::Gt: return Value(a > b);
+    default: return Value(a >= b);
+    }
+}
+
+static Value compare_values(BinaryOp op, const Value& l, const Value& r) {
+    // 整数直接比较，不经过浮点数
+    if (l.is_int() && r.is_int()) {
+        return compare_ordered(op, l.get<int64_t>(), r.get<int64_t>());
+    }
+    // Handle different type combinations
+    if (l.is_numeric() && r.is_numeric()) {
+        // BigInt 比较优先，Int 精确转换后按大整数比较
+        if (l.is_bigint() || r.is_bigint()) {
+            return compare_ordered(op, to_bigint(l), to_bigint(r));
+        }
+        return compare_ordered(op, l.as_number(), r.as_number());
+    }
+    if (l.is_string() && r.is_string()) {
+        return compare_ordered(op, l.get<std::string>(), r.get<std::string>());
+    }
+    if (l.is_bool() && r.is_bool()) {
+        // For booleans, false < true
+        bool lb = l.get<bool>();
+        bool rb = r.get<bool>();
+        switch (op) {
+        case BinaryOp::Eq: return Value(lb == rb);
+        case BinaryOp::Ne: return Value(lb != rb);
+        case BinaryOp::Lt: return Value(lb < rb);
+        case BinaryOp::Le: return Value(lb <= rb);
+        case BinaryOp::Gt: return Value(lb > rb);
+        default: return Value(lb >= rb);
         }
+    }
+
+    // Type mismatch - only equality/inequality make sense
+    if (op == BinaryOp::Eq) return Value(false); // Different types are never equal
+    if (op == BinaryOp::Ne) return Value(true); // Different types are always not equal
+
+    error_and_exit(std::string("Cannot compare different types with operator '") + binary_op_name(op) + "'");
+    return Value();
+}
+
+static Value op_eq(const Value& l, const Value& r) { return compare_values(BinaryOp::Eq, l, r); }
+static Value op_ne(const Value& l, const Value& r) { return compare_values(BinaryOp::Ne, l, r); }
+static Value op_lt(const Value& l, const Value& r) { return compare_values(BinaryOp::Lt, l, r); }
+static Value op_le(const Value& l, const Value& r) { return compare_values(BinaryOp::Le, l, r); }
+static Value op_gt(const Value& l, const Value& r) { return compare_values(BinaryOp::Gt, l, r); }
+static Value op_ge(const Value& l, const Value& r) { return compare_values(BinaryOp::Ge, l, r); }
+
+// 处理函数表，按 BinaryOp 的枚举顺序排列
+using BinaryHandler = Value (*)(const Value&, const Value&);
+static const BinaryHandler binary_handlers[] = {
+    op_add, op_sub, op_mul, op_div, op_mod, op_pow,
+    op_eq, op_ne, op_lt, op_le, op_gt, op_ge,
+};
+static_assert(sizeof(binary_handlers) / sizeof(binary_handlers[0]) == static_cast<size_t>(BinaryOp::Count),
+              "binary_handlers must cover every BinaryOp");
+
+Value Interpreter::binary_op(BinaryOp op, const Value& l, const Value& r) {
+    try {
+        return binary_handlers[static_cast<size_t>(op)](l, r);
+    } catch (RuntimeError& error) {
+        // 运算函数不持有解释器，在这里补上调用栈
+        if (error.stack_trace.empty()) error.stack_trace = get_stack_trace();
+        throw;
+    }
+}
 
-        std::cerr << "Error: Unknown unary operator '" << unary->op << "'" << std::endl;
-        return Value("<unknown op>");
-    }    // Support function calls
-    else if (auto* call = dynamic_cast<const CallExpr*>(node)) {
-        std::string actual_callee = call->callee;
-//        std::cout << "DEBUG: Call expression with callee: '" << actual_callee << "'" << std::endl;
+static Value unary_negate(const Value& v) {
+    if (v.type == Value::Type::Int) {
+        int64_t i = v.get<int64_t>();
+        // -INT64_MIN 超出范围，提升为 BigInt
+        if (i == INT64_MIN) return Value(::BigInt(0) - to_bigint(v));
+        return Value(-i);
+    }
+    return Value(::BigInt(0) - v.get<::BigInt>());
+}
 
-        // 检查调用的名称是否是一个参数，如果是，获取其实际值
+// 一元运算：同上，作用于已求值的操作数
+Value Interpreter::unary_op(UnaryOp op, const Value& v) {
+    if (op == UnaryOp::Square) {
+        return op_square(v);
+    }
+    if (v.type != Value::Type::Int && v.type != Value::Type::BigInt) {
+        RuntimeError error("Unary operator requires integer or big integer operand");
+        error.stack_trace = get_stack_trace();
+        throw error;
+    }
+    return op == UnaryOp::Negate ? unary_negate(v) : unary_factorial(v);
+}
+
+Value Interpreter::unary_factorial(const Value& v) {
+    int64_t vi;
+    if (v.type == Value::Type::Int) {
+        vi = v.get<int64_t>();
+    } else {
+        vi = v.get<::BigInt>().to_int64();
+    }
+
+    if (vi < 0) {
+        RuntimeError error("Cannot calculate factorial of negative number");
+        error.stack_trace = get_stack_trace();
+        throw error;
+    }
+
+    // 20! 是 int64 能表示的最大阶乘，更大时使用 BigInt 的素因子分解算法
+    if (vi > 20) {
         try {
-            Value callee_value = get_variable(actual_callee);
-            if (callee_value.is_string() && std::get<std::string>(callee_value.data).substr(0, 11) == "__function_") {
-                // 这是一个函数参数，提取实际的函数名
-                actual_callee = std::get<std::string>(callee_value.data).substr(11);
-             //   std::cout << "DEBUG: Function parameter resolved to: '" << actual_callee << "'" << std::endl;
-            }
-        } catch (const RuntimeError&) {
-            // 如果不是变量，保持原名称
-           // std::cout << "DEBUG: Not a variable or parameter, using direct name: '" << actual_callee << "'" << std::endl;
+            return Value(::BigInt::factorial(::BigInt(static_cast<long long>(vi))));
+        } catch (const std::runtime_error& e) {
+            RuntimeError error(e.what());
+            error.stack_trace = get_stack_trace();
+            throw error;
         }
+    } else {
+        int64_t res = 1;
+        for (int64_t j = 1; j <= vi; ++j) res *= j;
+        return Value(res);
+    }
+}
+
+// 解析调用目标（内置 → 用户定义 → 模块），结果记入调用点缓存
+void Interpreter::resolve_call_target(CallSiteCache& cache, const std::string& name) {
+    cache.generation = function_generation;
+    cache.target = name;
+    cache.builtin = nullptr;
+    cache.interpreter_builtin = nullptr;
+    cache.builtin_name = nullptr;
+    cache.func = nullptr;
+    cache.is_module = false;
+
+    if (const BuiltinFunction* builtin = find_builtin(name, &cache.builtin_name)) {
+        cache.builtin = builtin;
+        return;
+    }
+    if (InterpreterBuiltin builtin = find_interpreter_builtin(name, &cache.builtin_name)) {
+        cache.interpreter_builtin = builtin;
+        return;
+    }
+    auto it = functions.find(name);
+    if (it != functions.end()) {
+        cache.func = it->second;
+        return;
+    }
+    cache.is_module = name.find(".") != std::string::npos;
+}
+
+// 解析调用点的目标；只在首次调用、函数表变化或间接调用的函数名改变后重新解析
+const CallSiteCache& Interpreter::resolve_call(const CallExpr* call, CallSiteCache& cache) {
+    // 内置函数表可能被扩展直接修改，数量变化时同样视为函数表变化
+    if (builtin_functions.size() != known_builtin_count) {
+        known_builtin_count = builtin_functions.size();
+        invalidate_call_caches();
+    }
 
-        // Check builtin functions first
-     //   std::cout << "DEBUG: Looking for builtin function: '" << actual_callee << "'" << std::endl;
-     //   std::cout << "DEBUG: Available builtin functions:" << std::endl;
-        for (const auto& pair : builtin_functions) {
-            std::cout << "  - '" << pair.first << "'" << std::endl;
+    // 检查调用的名称是否是一个参数，如果是，按其值中的函数名调用；不是变量则保持原名称
+    const Value* callee_value = find_variable(call->callee_ref, call->callee);
+    if (callee_value && callee_value->is_string() &&
+        callee_value->get<std::string>().compare(0, 11, "__function_") == 0) {
+        const std::string& target = callee_value->get<std::string>();
+        if (cache.generation != function_generation || target.compare(11, std::string::npos, cache.target) != 0) {
+            resolve_call_target(cache, target.substr(11));
         }
-        
-        auto builtin_it = builtin_functions.find(actual_callee);
-        if (builtin_it != builtin_functions.end()) {
-       //     std::cout << "DEBUG: Found builtin function: '" << actual_callee << "'" << std::endl;
-            
-            // 检查是否是模块函数
-            bool is_module_func = actual_callee.find(".") != std::string::npos;
-            if (is_module_func) {
-         //       std::cout << "DEBUG: This is a module function with dot notation" << std::endl;
-            }
-            
-            // Handle builtin call with stack frame and unified error handling
-            push_frame(actual_callee, "<builtin>", 0);
-
-            std::vector<Value> args;
-            for (const auto& arg : call->args) {
-                if (!arg) {
-                    pop_frame();
-                    RuntimeError err("Null argument in call to builtin function '" + actual_callee + "'");
-                    err.stack_trace = get_stack_trace();
-                    throw err;
-                }
-                args.push_back(eval(arg.get()));
-            }
+    } else if (cache.generation != function_generation || cache.target != call->callee) {
+        resolve_call_target(cache, call->callee);
+    }
+    return cache;
+}
 
-            Value result;
-            try {
-                result = builtin_it->second(args);
-            } catch (...) {
-                pop_frame();
-                throw;
-            }
+// 调用函数，实参已求值
+Value Interpreter::call_function(const CallExpr* call, std::vector<Value>& args) {
+    return call_target(resolve_call(call, call_caches[call]), args);
+}
 
+Value Interpreter::call_target(const CallSiteCache& cache, std::vector<Value>& args) {
+    if (cache.builtin || cache.interpreter_builtin) {
+        // Handle builtin call with stack frame and unified error handling
+        push_frame(CallRecord{nullptr, cache.builtin_name});
+
+        Value result;
+        try {
+            result = cache.builtin ? (*cache.builtin)(args) : cache.interpreter_builtin(*this, args);
+        } catch (...) {
             pop_frame();
+            throw;
+        }
+
+        pop_frame();
+        return result;
+    }
+
+    if (cache.func) {
+        // 递归调用可能重新解析同一调用点，名称取自函数定义而非缓存
+        return call_user_function(cache.func, cache.func->name, args);
+    }
+
+    // Check if it's a module function before reporting undefined
+    if (cache.is_module) {
+        // Try to call the module function
+        Value result = call_module_function(cache.target, args);
+        if (result.to_string() != "null") {  // 检查是否成功调用
             return result;
         }
+        // If module function call failed, fall through to undefined function error
+    }
 
-        // Check user-defined functions
-        auto it = functions.find(actual_callee);
-        if (it != functions.end()) {
-            FuncDefStmt* func = it->second;
-            if (!func) {
-                std::cerr << "Error: Function object for '" << actual_callee << "' is null" << std::endl;
-                return Value("<func error>");
-            }
+    std::cerr << "Error: Call to undefined function '" << cache.target << "'" << std::endl;
+    return Value("<undefined function>");
+}
 
-            // Check recursion depth
-            if (recursion_depth >= max_recursion_depth) {
-                RuntimeError error("Maximum recursion depth exceeded (" + std::to_string(max_recursion_depth) + ")");
-                error.stack_trace = get_stack_trace();
-                throw error;
-            }
+// 进入用户函数：检查递归深度，建立作用域与栈帧，绑定参数
+void Interpreter::enter_function(FuncDefStmt* func, const std::string& name, const std::vector<Value>& args) {
+    tick();
+    // Check recursion depth
+    if (recursion_depth >= max_recursion_depth) {
+        RuntimeError error("Maximum recursion depth exceeded (" + std::to_string(max_recursion_depth) + ")");
+        error.stack_trace = get_stack_trace();
+        throw error;
+    }
+    bind_function(func, name, args);
+}
 
-            recursion_depth++;
-            push_scope();
-            push_frame(actual_callee, "<script>", 0); // Add to call stack
+// 尾调用：调用方的帧已无用处，先退出再进入 func，递归深度不变；省去的帧只在调用栈记录中计数
+void Interpreter::tail_call_function(FuncDefStmt* func, const std::string& name, const std::vector<Value>& args) {
+    tick();
+    uint32_t tail_calls = call_stack.empty() ? 0 : call_stack.back().tail_calls;
+    leave_function();
+    bind_function(func, name, args);
+    if (tail_calls < UINT32_MAX) ++tail_calls;
+    call_stack.back().tail_calls = tail_calls;
+}
 
-            // Check parameter count
-            if (call->args.size() > func->params.size()) {
-                Interpreter::print_warning("Too many arguments provided to function '" + actual_callee +
-                                          "'. Expected " + std::to_string(func->params.size()) +
-                                          ", got " + std::to_string(call->args.size()), true);
-            }
+// 建立作用域与栈帧并绑定参数
+void Interpreter::bind_function(FuncDefStmt* func, const std::string& name, const std::vector<Value>& args) {
+    recursion_depth++;
+    push_scope(func);
+    push_frame(CallRecord{func, nullptr}); // Add to call stack
+
+    // Check parameter count
+    if (args.size() > func->params.size()) {
+        Interpreter::print_warning("Too many arguments provided to function '" + name +
+                                  "'. Expected " + std::to_string(func->params.size()) +
+                                  ", got " + std::to_string(args.size()), true);
+    }
 
-            // Pass arguments
-            for (size_t j = 0; j < func->params.size(); ++j) {
-                if (j < call->args.size()) {
-                    if (call->args[j]) {
-                        set_variable(func->params[j], eval(call->args[j].get()));
-                    } else {
-                        Interpreter::print_error("Null argument " + std::to_string(j+1) + " in call to function '" + actual_callee + "'", true);
-                        set_variable(func->params[j], Value("<null arg>"));
-                    }
-                } else {
-                    Interpreter::print_warning("Missing argument '" + func->params[j] + "' in call to function '" + actual_callee + "'", true);
-                    set_variable(func->params[j], Value("<undefined>"));
-                }
-            }
+    // Pass arguments
+    for (size_t j = 0; j < func->params.size(); ++j) {
+        if (j < args.size()) {
+            set_variable(func->params[j], args[j]);
+        } else {
+            Interpreter::print_warning("Missing argument '" + func->params[j] + "' in call to function '" + name + "'", true);
+            set_variable(func->params[j], Value("<undefined>"));
+        }
+    }
+}
 
-            // Execute function body, capture return
-            try {
-                for (const auto& stmt : func->body->statements) {
-                    try {
-                        execute(stmt);
-                    } catch (const ReturnException& re) {
-                        // Normal return handling
-                        pop_frame();
-                        pop_scope();
-                        recursion_depth--;
-                        return re.value;
-                    } catch (const RuntimeError& re) {
-                        // If the error doesn't have a stack trace yet, capture current state
-                        RuntimeError enriched(re.message);
-                        if (re.stack_trace.empty()) {
-                            enriched.stack_trace = get_stack_trace();
-                        } else {
-                            enriched.stack_trace = re.stack_trace; // Preserve existing trace
-                        }
-                        pop_frame();
-                        pop_scope();
-                        recursion_depth--;
-                        throw enriched;
-                    } catch (const std::exception& e) {
-                        // Wrap standard exception as RuntimeError
-                        RuntimeError enriched("In function '" + actual_callee + "': " + std::string(e.what()));
-                        enriched.stack_trace = get_stack_trace(); // Get stack trace before cleanup
-                        pop_frame();
-                        pop_scope();
-                        recursion_depth--;
-                        throw enriched;
-                    }
-                }
-            } catch (const ReturnException& re) {
-                // Ensure cleanup in any case
-                pop_frame();
-                pop_scope();
-                recursion_depth--;
-                return re.value;
-            }
+void Interpreter::leave_function() {
+    pop_frame();
+    pop_scope();
+    recursion_depth--;
+}
 
-            pop_frame();
-            pop_scope();
-            recursion_depth--;
-            return Value(); // Default value when no return
+std::exception_ptr Interpreter::function_error(std::exception_ptr error, const std::string& name) const {
+    try {
+        std::rethrow_exception(error);
+    } catch (const ExecutionAborted&) {
+        // 中断与延迟退出保持原类型向外传递
+        return error;
+    } catch (const RuntimeError& re) {
+        // 已带调用栈的错误原样向外传递，否则补上当前调用栈
+        if (!re.stack_trace.empty()) return error;
+        RuntimeError enriched(re.message);
+        enriched.stack_trace = get_stack_trace();
+        return std::make_exception_ptr(enriched);
+    } catch (const std::exception& e) {
+        // Wrap standard exception as RuntimeError
+        RuntimeError enriched("In function '" + name + "': " + std::string(e.what()));
+        enriched.stack_trace = get_stack_trace();
+        return std::make_exception_ptr(enriched);
+    } catch (...) {
+        return error;
+    }
+}
+
+// 调用用户定义函数：进入函数后由当前执行引擎运行函数体
+Value Interpreter::call_user_function(FuncDefStmt* func, const std::string& name, const std::vector<Value>& args) {
+    if (!func) {
+        std::cerr << "Error: Function object for '" << name << "' is null" << std::endl;
+        return Value("<func error>");
+    }
+
+    enter_function(func, name, args);
+
+    // Execute function body, capture return
+    try {
+        Completion completion = vm ? vm->run_function(func) : execute_function_body(func);
+        if (completion.kind == Completion::Kind::Break || completion.kind == Completion::Kind::Continue) {
+            RuntimeError error(std::string(completion.kind == Completion::Kind::Break ? "Break" : "Continue")
+                               + " statement used outside loop");
+            error.stack_trace = get_stack_trace();
+            throw error;
         }
+        leave_function();
+        return completion.value;
+    } catch (...) {
+        std::exception_ptr error = function_error(std::current_exception(), name);
+        leave_function();
+        std::rethrow_exception(error);
+    }
+}
 
-        // Check if it's a module function before reporting undefined
-        bool is_module_func = actual_callee.find(".") != std::string::npos;
-        if (is_module_func) {
-            // Prepare arguments for module function call
-            std::vector<Value> args;
-            for (const auto& arg : call->args) {
-                if (!arg) {
-                    std::cerr << "Error: Null argument in call to module function '" << actual_callee << "'" << std::endl;
-                    args.push_back(Value());
-                } else {
-                    args.push_back(eval(arg.get()));
-                }
+// for 循环：区间在进入循环前求值一次，循环变量用本地整数计数，每次迭代写入变量；
+// 遍历数组时持有数组值的一份引用，循环体修改原变量不影响遍历，也不复制数组
+Completion Interpreter::execute_for(ForStmt* fs) {
+    Value first = eval(fs->start.get());
+    Value last = fs->is_range() ? eval(fs->end.get()) : Value();
+    if (fs->is_range() && !(first.is_int() && last.is_int())) {
+        RuntimeError error("For range bounds must be integers");
+        error.stack_trace = get_stack_trace();
+        throw error;
+    }
+    if (!fs->is_range() && !first.is_array() && !first.is_matrix()) {
+        RuntimeError error("For loop can only iterate over a range or an array");
+        error.stack_trace = get_stack_trace();
+        throw error;
+    }
+
+    // 执行一次循环体；返回 false 表示循环结束，result 为 return 等需要向外传递的完成信号
+    Completion result;
+    auto iterate = [&](const Value& item) {
+        tick();
+        write_variable(fs->ref, fs->name, item);
+        for (auto& stmt : fs->body->statements) {
+            Completion completion = execute(stmt);
+            if (completion.kind == Completion::Kind::Normal) continue;
+            if (completion.kind == Completion::Kind::Continue) return true;
+            if (completion.kind != Completion::Kind::Break) result = completion;
+            return false;
+        }
+        return true;
+    };
+
+    try {
+        if (fs->is_range()) {
+            for (int64_t i = first.get<int64_t>(), end = last.get<int64_t>(); i < end; ++i) {
+                if (!iterate(Value(i))) break;
+            }
+        } else if (first.is_array()) {
+            for (const auto& element : first.get<std::vector<Value>>()) {
+                if (!iterate(element)) break;
             }
-            
-            // Try to call the module function
-            Value result = call_module_function(actual_callee, args);
-            if (result.to_string() != "null") {  // 检查是否成功调用
-                return result;
+        } else {
+            // 矩阵按行遍历
+            for (const auto& row : first.get<std::vector<std::vector<Value>>>()) {
+                if (!iterate(Value(row))) break;
             }
-            // If module function call failed, fall through to undefined function error
         }
+    } catch (const ExecutionAborted&) {
+        throw;
+    } catch (const std::exception& e) {
+        RuntimeError error("Loop body execution error: " + std::string(e.what()));
+        error.stack_trace = get_stack_trace();
+        throw error;
+    }
+    return result;
+}
 
-        std::cerr << "Error: Call to undefined function '" << actual_callee << "'" << std::endl;
-        return Value("<undefined function>");
+// 树遍历方式执行函数体
+Completion Interpreter::execute_function_body(FuncDefStmt* func) {
+    for (const auto& stmt : func->body->statements) {
+        Completion completion = execute(stmt);
+        if (completion.kind != Completion::Kind::Normal) return completion;
     }
-    else if (auto* arr = dynamic_cast<const ArrayExpr*>(node)) {
-        std::vector<Value> elements;
-        for (const auto& element : arr->elements) {
-            if (element) {
-                elements.push_back(eval(element.get()));
-            } else {
-                std::cerr << "Error: Null element in array literal" << std::endl;
-                return Value();
-            }
+    return Completion(); // Default value when no return
+}
+
+// 选择执行引擎
+void Interpreter::set_engine(ExecutionEngine new_engine) {
+    engine = new_engine;
+    if (engine == ExecutionEngine::Bytecode) {
+        if (!vm) vm = std::make_unique<VM>(*this);
+    } else {
+        vm.reset();
+    }
+    update_recursion_limit();
+}
+
+void Interpreter::set_call_stack_budget(size_t bytes) {
+    call_stack_budget = bytes;
+    update_recursion_limit();
+}
+
+// 树遍历的调用占用本地栈，使用固定的默认上限；字节码模式的调用帧在堆上，
+// 默认上限取调用帧内存上限能容纳的最小帧数，实际深度由内存上限约束
+void Interpreter::update_recursion_limit() {
+    if (recursion_depth_defined) return;
+    if (vm) {
+        size_t frames = call_stack_budget / VM::min_frame_bytes();
+        max_recursion_depth = static_cast<int>(std::min<size_t>(frames, std::numeric_limits<int>::max()));
+    } else {
+        max_recursion_depth = DEFAULT_MAX_RECURSION_DEPTH;
+    }
+}
+
+void Interpreter::set_fuel_limit(uint64_t fuel) {
+    fuel_limit = fuel;
+    reset_execution_budget();
+}
+
+void Interpreter::set_time_limit(std::chrono::milliseconds limit) {
+    time_limit = limit;
+    reset_execution_budget();
+}
+
+void Interpreter::reset_execution_budget() {
+    fuel_spent = 0;
+    deadline = std::chrono::steady_clock::now() + time_limit;
+    interrupt_flag->store(false, std::memory_order_relaxed);
+    start_budget_slice();
+}
+
+// 下一段检查间隔：有 fuel 上限时不越过上限，使 fuel 恰好在第 fuel_limit + 1 个检查点耗尽
+void Interpreter::start_budget_slice() {
+    uint64_t limit = shared_budget ? shared_budget->fuel_limit : fuel_limit;
+    uint64_t spent = shared_budget ? shared_budget->fuel_spent.load(std::memory_order_relaxed) : fuel_spent;
+    budget_slice = BUDGET_CHECK_INTERVAL;
+    if (limit && limit - std::min(spent, limit) < static_cast<uint64_t>(budget_slice)) {
+        budget_slice = static_cast<int64_t>(limit - std::min(spent, limit)) + 1;
+    }
+    budget_countdown = budget_slice;
+}
+
+void Interpreter::check_budget() {
+    uint64_t used = static_cast<uint64_t>(budget_slice - budget_countdown);
+    fuel_spent += used;
+
+    // 并行任务中按调用方的预算检查，本段 fuel 计入所有参与线程的合计
+    SharedBudget* shared = shared_budget;
+    uint64_t spent = shared ? shared->fuel_spent.fetch_add(used, std::memory_order_relaxed) + used : fuel_spent;
+    uint64_t limit = shared ? shared->fuel_limit : fuel_limit;
+    std::chrono::milliseconds timeout = shared ? shared->time_limit : time_limit;
+
+    std::string reason;
+    if ((shared ? *shared->interrupt : *interrupt_flag).load(std::memory_order_relaxed)) {
+        reason = "Execution interrupted";
+    } else if (limit && spent > limit) {
+        reason = "Execution fuel exhausted (" + std::to_string(limit) + ")";
+    } else if (timeout.count() && std::chrono::steady_clock::now() >= (shared ? shared->deadline : deadline)) {
+        reason = "Execution time limit exceeded (" + std::to_string(timeout.count()) + " ms)";
+    }
+    if (!reason.empty()) {
+        // 保持已耗尽状态，调用方捕获后继续执行时下一个检查点再次报告
+        budget_countdown = budget_slice = 1;
+        fuel_spent -= 1;
+        ExecutionAborted error(reason);
+        error.stack_trace = get_stack_trace();
+        throw error;
+    }
+    start_budget_slice();
+}
+
+// 用当前执行引擎运行一条顶层语句
+Completion Interpreter::run_statement(const NodePtr<Statement>& stmt) {
+    // 执行前先做常量折叠，再完成名称解析；函数体随其定义一并处理。
+    // 两者都会改写 AST，而同一棵 AST 可能由多个实例同时执行，只在第一次执行前处理一次
+    if (!stmt->prepared.load(std::memory_order_acquire)) {
+        static std::mutex prepare_mutex;
+        std::lock_guard<std::mutex> lock(prepare_mutex);
+        if (!stmt->prepared.load(std::memory_order_relaxed)) {
+            Optimizer(*this).optimize(stmt.get());
+            Resolver(*this).resolve(stmt.get());
+            stmt->prepared.store(true, std::memory_order_release);
         }
-        return Value(elements);
     }
-    std::cerr << "Error: Unsupported expression type" << std::endl;
-    return Value("<type error>");
+    return vm ? vm->execute(stmt) : execute(stmt);
 }
 
 // Load and execute module
@@ -1032,9 +1493,8 @@ bool Interpreter::load_module(const std::string& module_name) {
     file.close();
 
 
-    // Lexical and syntax analysis
-    auto tokens = Lexer::tokenize(source);
-    auto ast = Parser::parse(tokens);
+    // Lexical and syntax analysis（源码未变时直接使用语法树缓存）
+    auto ast = ScriptCache::load(full_path, source);
 
     if (!ast) {
         std::cerr << "Error: Failed to parse module '" << module_name << "'" << std::endl;
@@ -1047,11 +1507,20 @@ bool Interpreter::load_module(const std::string& module_name) {
         // This allows variables and functions to be accessible after inclusion
         try {
             for (auto& stmt : block->statements) {
-                execute(stmt);
+                if (run_statement(stmt).kind != Completion::Kind::Normal) {
+                    throw RuntimeError("return/break/continue used outside function or loop");
+                }
             }
+        } catch (const ExecutionAborted&) {
+            // 中断时同样保留 AST，向上交给执行入口
+            loaded_modules.erase(module_name);
+            loaded_module_asts.push_back(std::move(ast));
+            throw;
         } catch (const std::exception& e) {
             std::cerr << "Error: Exception while executing module '" << module_name << "': " << e.what() << std::endl;
             loaded_modules.erase(module_name); // 失败时移除，防止死锁
+            // 已注册的函数和字节码缓存仍引用该 AST，失败时同样保留
+            loaded_module_asts.push_back(std::move(ast));
             return false;
         }
 
@@ -1069,20 +1538,84 @@ static std::vector<Interpreter::EntryFunction>& get_entry_functions() {
     return entry_functions;
 }
 
+// 保护注册入口列表与共享内置函数表
+static std::mutex& builtin_registry_mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
 void Interpreter::register_entry(EntryFunction func) {
+    std::lock_guard<std::mutex> lock(builtin_registry_mutex());
     get_entry_functions().push_back(func);
 }
 
+// 在一个空实例上执行全部注册入口，收集其注册的函数与全局变量；
+// 之后注册了新入口（如动态加载的扩展）时重新生成，已有实例继续使用旧表
+std::shared_ptr<const Interpreter::BuiltinTable> Interpreter::builtin_table() {
+    std::lock_guard<std::mutex> lock(builtin_registry_mutex());
+    static std::shared_ptr<const BuiltinTable> table;
+    const auto& entries = get_entry_functions();
+    if (!table || table->entry_count != entries.size()) {
+        Interpreter scratch{NoBuiltins{}};
+        for (auto entry : entries) {
+            entry(scratch);
+        }
+        auto built = std::make_shared<BuiltinTable>();
+        built->functions = std::move(scratch.builtin_functions);
+        register_parallel_builtins(*built);
+        for (size_t i = 0; i < scratch.global_assigned.size(); ++i) {
+            if (scratch.global_assigned[i]) {
+                built->globals.emplace_back(global_name(i), scratch.global_values[i]);
+            }
+        }
+        built->entry_count = entries.size();
+        table = std::move(built);
+    }
+    return table;
+}
+
 // Register builtin mathematical functions
 void Interpreter::register_builtin_functions()
 {
-    for (auto entry : get_entry_functions()) {
-        entry(*this);
+    // 函数直接引用共享表，只需为本实例设置内置全局变量
+    for (const auto& [name, value] : shared_builtins->globals) {
+        set_global_variable(name, value);
+    }
+}
+
+const Interpreter::BuiltinFunction* Interpreter::find_builtin(const std::string& name, const std::string** key) const {
+    auto own = builtin_functions.find(name);
+    if (own != builtin_functions.end()) {
+        if (key) *key = &own->first;
+        return &own->second;
     }
+    if (!shared_builtins) return nullptr;
+    auto shared = shared_builtins->functions.find(name);
+    if (shared == shared_builtins->functions.end()) return nullptr;
+    if (key) *key = &shared->first;
+    return &shared->second;
+}
+
+Interpreter::InterpreterBuiltin Interpreter::find_interpreter_builtin(const std::string& name, const std::string** key) const {
+    if (!shared_builtins) return nullptr;
+    auto it = shared_builtins->interpreter_functions.find(name);
+    if (it == shared_builtins->interpreter_functions.end()) return nullptr;
+    if (key) *key = &it->first;
+    return it->second;
+}
+
+const Interpreter::BuiltinFunction* Interpreter::find_shared_builtin(const std::string& name) const {
+    if (!shared_builtins) return nullptr;
+    auto it = shared_builtins->functions.find(name);
+    return it != shared_builtins->functions.end() ? &it->second : nullptr;
 }
 
 // 在文件顶端添加错误处理函数
 LAMINA_EXPORT void error_and_exit(const std::string& msg) {
+    // 线程池任务中不能直接退出（其他线程仍在执行解释器代码），交给发起并行调用的线程处理
+    if (ThreadPool::in_task()) {
+        throw DeferredExit(msg);
+    }
     std::cerr << "Error: " << msg << std::endl;
     std::exit(EXIT_FAILURE);
 }
@@ -1094,22 +1627,29 @@ LAMINA_EXPORT void error_and_exit(const std::string& msg) {
 
 // 打印当前所有变量
 void Interpreter::printVariables() const {
-    if (variable_stack.empty()) {
-        std::cout << "No variables defined." << std::endl;
-        return;
-    }
-
     std::cout << "\nCurrent variable list:" << std::endl;
     std::cout << "--------------------" << std::endl;
 
     // 从最内层作用域开始打印
     bool hasVars = false;
-    for (auto it = variable_stack.rbegin(); it != variable_stack.rend(); ++it) {
-        const auto& scope = *it;
-        for (const auto& [name, value] : scope) {
-            std::cout << name << " = " << value.to_string() << std::endl;
+    for (size_t depth = frame_depth; depth > 0; --depth) {
+        const LocalFrame& frame = local_frames[depth - 1];
+        for (size_t i = 0; i < frame.slots.size(); ++i) {
+            if (!frame.assigned[i]) continue;
+            std::cout << frame.func->locals[i] << " = " << frame.slots[i].to_string() << std::endl;
             hasVars = true;
         }
+        if (frame.extras) {
+            for (const auto& [name, value] : *frame.extras) {
+                std::cout << name << " = " << value.to_string() << std::endl;
+                hasVars = true;
+            }
+        }
+    }
+    for (size_t i = 0; i < global_assigned.size(); ++i) {
+        if (!global_assigned[i]) continue;
+        std::cout << global_name(i) << " = " << global_values[i].to_string() << std::endl;
+        hasVars = true;
     }
 
     if (!hasVars) {
@@ -1126,21 +1666,6 @@ void Interpreter::printVariables() const {
     }
 }
 
-// Stack trace management functions
-void Interpreter::push_frame(const std::string& function_name, const std::string& file_name, int line_number) {
-    call_stack.emplace_back(function_name, file_name, line_number);
-}
-
-void Interpreter::pop_frame() {
-    if (!call_stack.empty()) {
-        call_stack.pop_back();
-    }
-}
-
-std::vector<StackFrame> Interpreter::get_stack_trace() const {
-    return call_stack;
-}
-
 void Interpreter::print_stack_trace(const RuntimeError& error, bool use_colors) const {
     bool colors_enabled = supports_colors() && use_colors;
 
@@ -1155,8 +1680,18 @@ void Interpreter::print_stack_trace(const RuntimeError& error, bool use_colors)
             std::cerr << "Traceback (most recent call last):\n";
         }
 
-        // Print stack frames
-        for (const auto& frame : trace) {
+        // Print stack frames；深度递归时只显示首尾各 TRACE_EDGE 帧
+        const size_t TRACE_EDGE = 20;
+        for (size_t i = 0; i < trace.size(); ++i) {
+            if (trace.size() > 2 * TRACE_EDGE + 1 && i == TRACE_EDGE) {
+                std::cerr << "  ... " << trace.size() - 2 * TRACE_EDGE << " more frames ...\n";
+                i = trace.size() - TRACE_EDGE - 1;
+                continue;
+            }
+            if (trace[i].tail_calls) {
+                std::cerr << "  ... " << trace[i].tail_calls << " tail call frames ...\n";
+            }
+            StackFrame frame = trace[i].materialize();
             if (colors_enabled) {
                 std::cerr << "  File \"\033[1;34m" << frame.file_name << "\033[0m\", line "
                           << frame.line_number << ", in \033[1;33m" << frame.function_name << "\033[0m\n";
@@ -1176,11 +1711,9 @@ void Interpreter::print_stack_trace(const RuntimeError& error, bool use_colors)
 }
 
 bool Interpreter::supports_colors() {
-    static bool checked = false;
-    static bool colors_supported = false;
-
-    if (!checked) {
-        checked = true;
+    // 静态局部变量的初始化是线程安全的，多个线程上的实例同时报错时只检测一次
+    static const bool colors_supported = [] {
+        bool colors_supported = false;
 
         // Check for NO_COLOR environment variable (universal standard)
         if (getenv("NO_COLOR") != nullptr) {
@@ -1218,7 +1751,8 @@ bool Interpreter::supports_colors() {
             colors_supported = false;
         }
         #endif
-    }
+        return colors_supported;
+    }();
 
     return colors_supported;
 }
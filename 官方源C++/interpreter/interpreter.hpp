@@ -20,8 +20,18 @@
 #include <set>
 #include <functional>
 #include <stack>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 
 class ModuleLoader;
+class VM;
+
+// 执行引擎：树遍历解释器（参考实现）或字节码寄存器虚拟机
+enum class ExecutionEngine {
+    TreeWalker,
+    Bytecode,
+};
 
 // 前向声明在 lamina.hpp 中已定义，无需重复声明
 
@@ -35,42 +45,73 @@ struct StackFrame {
         : function_name(func), file_name(file), line_number(line) {}
 };
 
+// 调用栈中的一帧：只记录被调用的函数，压栈时不分配内存；打印错误时才转换为 StackFrame
+struct CallRecord {
+    const FuncDefStmt* func = nullptr;      // 用户函数的定义
+    const std::string* builtin = nullptr;   // 内置函数名，指向内置函数表中的键
+    uint32_t tail_calls = 0;                // 经尾调用省去的调用方帧数（字节码模式）
+
+    StackFrame materialize() const {
+        if (func) return StackFrame(func->name, "<script>", func->line);
+        return StackFrame(builtin ? *builtin : std::string("<builtin>"), "<builtin>", 0);
+    }
+};
+
 // Enhanced runtime error class with stack trace support
 class RuntimeError : public std::exception {
 public:
     std::string message;
-    std::vector<StackFrame> stack_trace;
+    std::vector<CallRecord> stack_trace;
     
     RuntimeError(const std::string& msg) : message(msg) {}
-    RuntimeError(const std::string& msg, const std::vector<StackFrame>& trace) 
+    RuntimeError(const std::string& msg, const std::vector<CallRecord>& trace) 
         : message(msg), stack_trace(trace) {}
+
+    // 生成可显示的调用栈
+    std::vector<StackFrame> frames() const {
+        std::vector<StackFrame> result;
+        result.reserve(stack_trace.size());
+        for (const auto& record : stack_trace) result.push_back(record.materialize());
+        return result;
+    }
     
     const char* what() const noexcept override {
         return message.c_str();
     }
 };
 
-// Exception for return statements
-class ReturnException : public std::exception {
+// 执行预算耗尽或被外部中断：不被循环、表达式语句等错误恢复逻辑吸收，一直传递到执行入口
+class ExecutionAborted : public RuntimeError {
 public:
-    Value value;
-    explicit ReturnException(const Value& v) : value(v) {}
+    using RuntimeError::RuntimeError;
 };
 
-
-// Exception for break statements
-class BreakException : public std::exception {
+// 线程池任务中调用 error_and_exit：不在工作线程上结束进程，而是作为异常带回发起并行调用的线程，
+// 由它在所有任务结束后输出错误并退出
+class DeferredExit : public ExecutionAborted {
 public:
-    BreakException() = default;
+    using ExecutionAborted::ExecutionAborted;
 };
 
+// 语句执行的完成信号：return/break/continue 作为普通返回值逐层传递，不借助异常
+struct Completion {
+    enum class Kind : unsigned char { Normal, Return, Break, Continue };
+    Kind kind = Kind::Normal;
+    Value value;  // Return 时的返回值
+};
 
-// Exception for continue statements
-class ContinueException : public std::exception {
-public:
-    ContinueException() = default;
+// 函数调用的局部帧：局部变量按 Resolver 分配的槽位平铺存放
+struct LocalFrame {
+    const FuncDefStmt* func = nullptr;
+    std::vector<Value> slots;
+    std::vector<unsigned char> assigned;
+    // 按名称写入、且不属于任何槽位的变量（未解析的代码或扩展调用 set_variable）
+    std::unique_ptr<std::unordered_map<std::string, Value>> extras;
 };
 
+// 线程安全：不同的 Interpreter 实例之间不共享可变状态，可以在不同线程上同时运行，也可以执行同一棵 AST：
+// 语句在第一次执行前（加锁）完成优化与名称解析，之后只读，调用点缓存等执行状态随实例保存。
+// 同一个实例同一时间只能由一个线程使用。内置函数表在所有实例间只读共享，全局变量名的槽位编号由进程统一分配。
 class LAMINA_API Interpreter {
     // 禁止拷贝，允许移动
     Interpreter(const Interpreter&) = delete;
@@ -78,20 +119,65 @@ class LAMINA_API Interpreter {
     Interpreter(Interpreter&&) = default;
     Interpreter& operator=(Interpreter&&) = default;
 public:
-    Interpreter() {
-        register_builtin_functions();
-    }
-    void execute(const std::unique_ptr<Statement>& node);
+    Interpreter();
+    ~Interpreter();
+    Completion execute(const NodePtr<Statement>& node);
     Value eval(const ASTNode* node);
+    // Run a top-level statement with the selected execution engine
+    Completion run_statement(const NodePtr<Statement>& stmt);
+    void set_engine(ExecutionEngine new_engine);
+    ExecutionEngine get_engine() const { return engine; }
+    // 执行预算检查点，位于循环回边与函数调用处；每 BUDGET_CHECK_INTERVAL 次才真正检查一次
+    void tick() {
+        if (--budget_countdown <= 0) check_budget();
+    }
+    // 执行预算：fuel 为允许经过的检查点次数，time_limit 为执行时限，0 表示不限制
+    // 设置后重新开始计量
+    void set_fuel_limit(uint64_t fuel);
+    void set_time_limit(std::chrono::milliseconds limit);
+    uint64_t get_fuel_used() const { return fuel_spent + (budget_slice - budget_countdown); }
+    // 清零已用 fuel、重新计算截止时间并清除中断请求，每次开始执行前调用
+    void reset_execution_budget();
+    // 请求中断当前执行，可在其他线程或信号处理函数中调用；执行在下一次检查时抛出 ExecutionAborted
+    void request_interrupt() { interrupt_flag->store(true, std::memory_order_relaxed); }
+    bool interrupt_pending() const { return interrupt_flag->load(std::memory_order_relaxed); }
+    // 运算与调用语义，树遍历和字节码 VM 共用
+    Value binary_op(BinaryOp op, const Value& l, const Value& r);
+    Value unary_op(UnaryOp op, const Value& v);
+    Value call_function(const CallExpr* call, std::vector<Value>& args);
+    // 解析调用点当前的目标并刷新调用方保存的缓存；call_target 按解析结果调用
+    const CallSiteCache& resolve_call(const CallExpr* call, CallSiteCache& cache);
+    Value call_target(const CallSiteCache& target, std::vector<Value>& args);
+    // 用户函数的进入与退出（递归深度、作用域、调用栈、参数绑定），VM 在显式帧栈上直接使用
+    void enter_function(FuncDefStmt* func, const std::string& name, const std::vector<Value>& args);
+    // 尾调用：当前函数的作用域与调用栈记录换成 func 的，递归深度不变
+    void tail_call_function(FuncDefStmt* func, const std::string& name, const std::vector<Value>& args);
+    void leave_function();
+    // 把函数体内抛出的异常转换为调用方看到的形式，需在 leave_function 之前调用
+    std::exception_ptr function_error(std::exception_ptr error, const std::string& name) const;
+    // 字节码模式下调用帧占用内存的上限（字节），决定可达到的递归深度
+    // 未 define MAX_RECURSION_DEPTH 时，字节码模式的递归深度上限由它换算
+    void set_call_stack_budget(size_t bytes);
+    size_t get_call_stack_budget() const { return call_stack_budget; }
+    // 函数表被直接修改后调用，使所有调用点缓存失效
+    void invalidate_call_caches() { ++function_generation; }
+    // 按解析结果读写变量，未解析的引用退回按名称查找
+    Value read_variable(const VarRef& ref, const std::string& name) const;
+    void write_variable(const VarRef& ref, const std::string& name, const Value& val);
+    bool has_variable(const std::string& name) const;
+    // 是否有任何实例使用过该名称的全局变量
+    static bool is_global_name(const std::string& name);
+    // 为全局变量名分配槽位（Resolver 使用）；编号在进程内统一分配，同一棵 AST 的解析结果对所有实例有效
+    static int intern_global(const std::string& name);
     // Print all variables in current scope
     void printVariables() const;
     void add_function(const std::string& name, FuncDefStmt* func);
     // Save AST in REPL mode to keep function pointers valid
-    void save_repl_ast(std::unique_ptr<ASTNode> ast);
+    void save_repl_ast(NodePtr<ASTNode> ast);
     // Stack trace management
-    void push_frame(const std::string& function_name, const std::string& file_name = "<script>", int line_number = 0);
-    void pop_frame();
-    std::vector<StackFrame> get_stack_trace() const;
+    void push_frame(const CallRecord& record) { call_stack.push_back(record); }
+    void pop_frame() { if (!call_stack.empty()) call_stack.pop_back(); }
+    std::vector<CallRecord> get_stack_trace() const { return call_stack; }
     void print_stack_trace(const RuntimeError& error, bool use_colors = true) const;
     
     // Utility functions for error display
@@ -100,10 +186,15 @@ public:
     static void print_warning(const std::string& message, bool use_colors = true);
     // Builtin function type
     using BuiltinFunction = std::function<Value(const std::vector<Value>&)>;
-    // Store builtin functions
+    using InterpreterBuiltin = CallSiteCache::InterpreterBuiltin;
+    // 本实例额外注册或覆盖的内置函数（模块、扩展在运行时添加），查找时优先于共享内置函数表
     std::unordered_map<std::string, BuiltinFunction> builtin_functions;
     using EntryFunction = void(*)(Interpreter&);
     static void register_entry(EntryFunction func);
+    // 按名称查找内置函数，key 不为空时返回函数表中键的地址；找不到时返回 nullptr
+    const BuiltinFunction* find_builtin(const std::string& name, const std::string** key = nullptr) const;
+    // 只查找所有实例共享的内置函数表，不含本实例另外注册的函数
+    const BuiltinFunction* find_shared_builtin(const std::string& name) const;
     // Variable assignment
     void set_variable(const std::string& name, const Value& val);
     // built global variable in interpreter
@@ -112,32 +203,109 @@ public:
     Value get_variable(const std::string& name) const;
     // Call module function
     Value call_module_function(const std::string& func_name, const std::vector<Value>& args);
-    // Variable scope stack, top is the current scope
-    std::vector<std::unordered_map<std::string, Value>> variable_stack{ { } };
 private:
+    // 全局变量：按 intern_global 分配的槽位存放，用到更大的槽位时再扩展
+    std::vector<Value> global_values;
+    std::vector<unsigned char> global_assigned;
+    // 函数调用的局部帧栈，frame_depth 之上的帧保留以复用内存
+    std::vector<LocalFrame> local_frames;
+    size_t frame_depth = 0;
     // Store function definitions
     std::unordered_map<std::string, FuncDefStmt*> functions;
+    // 树遍历执行时各调用点的目标缓存，以 AST 节点为键
+    std::unordered_map<const CallExpr*, CallSiteCache> call_caches;
+    // functions/builtin_functions 的版本号，任一变化时递增
+    uint32_t function_generation = 1;
+    size_t known_builtin_count = 0;
     // List of loaded modules to prevent circular imports
     std::set<std::string> loaded_modules;
     // Store loaded module ASTs to keep function pointers valid
-    std::vector<std::unique_ptr<ASTNode>> loaded_module_asts;
+    std::vector<NodePtr<ASTNode>> loaded_module_asts;
     // Store REPL ASTs to keep function pointers valid in interactive mode
-    std::vector<std::unique_ptr<ASTNode>> repl_asts;
+    std::vector<NodePtr<ASTNode>> repl_asts;
     // Store loaded module loaders for function calls
     std::vector<std::unique_ptr<ModuleLoader>> module_loaders;
 
     // Stack trace for function calls
-    std::vector<StackFrame> call_stack;
+    std::vector<CallRecord> call_stack;
     // Recursion depth tracking
     int recursion_depth = 0;
-    int max_recursion_depth = 100;  // 可变的递归深度限制
+    static constexpr int DEFAULT_MAX_RECURSION_DEPTH = 100;
+    int max_recursion_depth = DEFAULT_MAX_RECURSION_DEPTH;  // 可变的递归深度限制
+    bool recursion_depth_defined = false;  // 脚本用 define MAX_RECURSION_DEPTH 设置过
+    size_t call_stack_budget = size_t(512) << 20;
+    // 执行预算状态：budget_countdown 在每个检查点递减，到 0 时由 check_budget 结算本段 fuel
+    static constexpr int64_t BUDGET_CHECK_INTERVAL = 1024;
+    int64_t budget_countdown = BUDGET_CHECK_INTERVAL;
+    int64_t budget_slice = BUDGET_CHECK_INTERVAL;
+    uint64_t fuel_spent = 0;
+    uint64_t fuel_limit = 0;
+    std::chrono::milliseconds time_limit{0};
+    std::chrono::steady_clock::time_point deadline;
+    std::unique_ptr<std::atomic<bool>> interrupt_flag = std::make_unique<std::atomic<bool>>(false);
+    // 并行任务中代调用方执行时改用调用方的预算：fuel 按所有参与线程合计，时限与中断沿用调用方的设置
+    struct SharedBudget {
+        std::atomic<uint64_t> fuel_spent{0};
+        uint64_t fuel_limit = 0;
+        std::chrono::milliseconds time_limit{0};
+        std::chrono::steady_clock::time_point deadline;
+        const std::atomic<bool>* interrupt = nullptr;
+    };
+    SharedBudget* shared_budget = nullptr;
+    void check_budget();
+    void start_budget_slice();
     // Enter/exit scope
-    void push_scope();
+    void push_scope(const FuncDefStmt* func);
     void pop_scope();
+    // 按执行引擎与调用帧内存上限重新计算默认的递归深度上限
+    void update_recursion_limit();
+    // 进入函数与尾调用共用：建立作用域、栈帧并绑定参数
+    void bind_function(FuncDefStmt* func, const std::string& name, const std::vector<Value>& args);
+    // 变量查找，找不到时返回 nullptr
+    const Value* find_variable(const VarRef& ref, const std::string& name) const;
+    const Value* find_variable_by_name(const std::string& name) const;
+    const Value* find_global(const std::string& name) const;
+    const Value* global_at(int slot) const;
+    void assign_global(int slot, const Value& val);
+    Value undefined_variable(const std::string& name) const;
+    // 阶乘需要在出错时附带调用栈
+    Value unary_factorial(const Value& v);
     // Load and execute module
     bool load_module(const std::string& module_name);
+    // 所有注册入口生成的内置函数与全局变量，只读，由各实例共享；
+    // interpreter_functions 中的函数不绑定实例，调用时接收发起调用的解释器
+    struct BuiltinTable {
+        std::unordered_map<std::string, BuiltinFunction> functions;
+        std::unordered_map<std::string, InterpreterBuiltin> interpreter_functions;
+        std::vector<std::pair<std::string, Value>> globals;
+        size_t entry_count = 0;
+    };
+    static std::shared_ptr<const BuiltinTable> builtin_table();
+    std::shared_ptr<const BuiltinTable> shared_builtins;
+    InterpreterBuiltin find_interpreter_builtin(const std::string& name, const std::string** key = nullptr) const;
+    // 生成内置函数表时使用的空实例，不加载内置函数
+    struct NoBuiltins {};
+    explicit Interpreter(NoBuiltins);
     // Register builtin functions
     void register_builtin_functions();
+    // 解析调用目标并写入调用点缓存
+    void resolve_call_target(CallSiteCache& cache, const std::string& name);
+    // Call a user-defined function with evaluated arguments
+    Value call_user_function(FuncDefStmt* func, const std::string& name, const std::vector<Value>& args);
+    Completion execute_function_body(FuncDefStmt* func);
+    Completion execute_for(ForStmt* fs);
+    // 数据并行的数组内置函数（parallel.cpp）
+    struct ArrayCallback;
+    struct ParallelRun;
+    static void register_parallel_builtins(BuiltinTable& table);
+    Value builtin_map(const std::vector<Value>& args);
+    Value builtin_filter(const std::vector<Value>& args);
+    Value builtin_reduce(const std::vector<Value>& args);
+    Value builtin_sum(const std::vector<Value>& args);
+    Value builtin_zip_with(const std::vector<Value>& args);
+    // 当前执行引擎；字节码模式下持有 VM 实例
+    ExecutionEngine engine = ExecutionEngine::TreeWalker;
+    std::unique_ptr<VM> vm;
     // 移除静态成员变量声明，改用函数内静态变量
     // static std::vector<EntryFunction> entry_functions;
 
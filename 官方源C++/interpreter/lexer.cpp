@@ -2,10 +2,18 @@
 #include <cctype>
 #include <iostream>
 
+// 本线程上一次 tokenize 输出的错误条数
+static thread_local size_t diagnostic_count = 0;
+
+size_t Lexer::diagnostics() {
+    return diagnostic_count;
+}
+
 std::vector<Token> Lexer::tokenize(const std::string& src) {
     std::vector<Token> tokens;
     size_t i = 0;
     int line = 1, col = 1;
+    diagnostic_count = 0;
     // Clear log for debugging
     // Debug: std::cerr << "Starting tokenization of " << src.length() << " characters" << std::endl;
     while (i < src.size()) {
@@ -31,6 +39,9 @@ std::vector<Token> Lexer::tokenize(const std::string& src) {
         } else if (src.compare(i, 3, "for") == 0 && !isalnum(src[i+3])) {
             tokens.push_back(Token(TokenType::For, "for", line, start_col));
             i += 3; col += 3;
+        } else if (src.compare(i, 2, "in") == 0 && !isalnum(src[i+2]) && src[i+2] != '_') {
+            tokens.push_back(Token(TokenType::In, "in", line, start_col));
+            i += 2; col += 2;
         } else if (src.compare(i, 6, "return") == 0 && !isalnum(src[i+6])) {
             tokens.push_back(Token(TokenType::Return, "return", line, start_col));
             i += 6; col += 6;
@@ -83,12 +94,16 @@ std::vector<Token> Lexer::tokenize(const std::string& src) {
             ++i; ++col;
         } else if (src[i] == '>') {
             tokens.push_back(Token(TokenType::Greater, ">", line, start_col));
-            ++i; ++col;        } else if (isdigit(src[i]) || (src[i] == '.' && i + 1 < src.size() && isdigit(src[i+1]))) {
+            ++i; ++col;        } else if (src[i] == '.' && i + 1 < src.size() && src[i+1] == '.') {
+            tokens.push_back(Token(TokenType::DotDot, "..", line, start_col));
+            i += 2; col += 2;
+        } else if (isdigit(src[i]) || (src[i] == '.' && i + 1 < src.size() && isdigit(src[i+1]))) {
             size_t j = i;
             bool has_dot = false;
             
-            // Handle decimal numbers
-            while (j < src.size() && (isdigit(src[j]) || (src[j] == '.' && !has_dot))) {
+            // Handle decimal numbers；"1..5" 中的 ".." 是区间记号，不属于数字
+            while (j < src.size() && (isdigit(src[j]) ||
+                   (src[j] == '.' && !has_dot && !(j + 1 < src.size() && src[j+1] == '.')))) {
                 if (src[j] == '.') has_dot = true;
                 ++j;
             }
@@ -132,6 +147,7 @@ std::vector<Token> Lexer::tokenize(const std::string& src) {
             }
 
             if (j >= src.size()) { // Unterminated string
+                ++diagnostic_count;
                 std::cerr << "Error: Unterminated string literal at line " << line << std::endl;
                 i = src.size(); // Stop tokenizing
             } else {
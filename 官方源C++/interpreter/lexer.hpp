@@ -18,7 +18,9 @@ enum class TokenType {
     If,        
     Else,      
     While,     
-    For,     Return,    
+    For,     
+    In,        // in
+    Return,    
     Include,   // 新增
     Break,     // 新增
     Continue,  // 新增
@@ -39,6 +41,7 @@ enum class TokenType {
     RBracket,   // ]
     Comma,
     Dot,       // 新增
+    DotDot,    // ..
     String,
     Semicolon,
     Plus,    
@@ -69,4 +72,6 @@ struct Token {
 class LAMINA_API Lexer {
 public:
     static std::vector<Token> tokenize(const std::string& src);
+    // 本线程上一次 tokenize 输出的错误条数
+    static size_t diagnostics();
 };
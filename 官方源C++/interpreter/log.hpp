@@ -0,0 +1,172 @@
+#pragma once
+/*
+ * 诊断与跟踪输出
+ *
+ * 按类别设置输出级别（默认只输出 Warn 及以上），消息交给可替换的输出目标（默认 std::cerr）。
+ *   LAMINA_LOG(Debug, Parser, "token " << i << " = '" << text << "'");
+ * 级别未开启时只做一次比较，不会格式化消息；编译时定义 LAMINA_LOG_DISABLED
+ * 则所有 LAMINA_LOG 调用被整体消除。
+ *
+ * 运行时配置串（--log=<spec> 或环境变量 LAMINA_LOG）：
+ *   debug                    所有类别设为 debug
+ *   parser=trace,module=info 分别设置各类别
+ */
+#include <atomic>
+#include <cctype>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+
+enum class LogLevel : unsigned char {
+    Trace,
+    Debug,
+    Info,
+    Warn,
+    Error,
+    Off,
+};
+
+enum class LogCategory : unsigned char {
+    Parser,
+    Interpreter,
+    Module,
+    VM,
+    Count
+};
+
+class Log {
+public:
+    // 输出目标：接收级别、类别与格式化好的消息
+    using Sink = std::function<void(LogLevel, LogCategory, const std::string&)>;
+
+    static bool enabled(LogLevel level, LogCategory category) {
+        return static_cast<unsigned char>(level) >=
+               thresholds()[static_cast<size_t>(category)].load(std::memory_order_relaxed);
+    }
+
+    static void set_level(LogCategory category, LogLevel level) {
+        thresholds()[static_cast<size_t>(category)].store(static_cast<unsigned char>(level), std::memory_order_relaxed);
+    }
+
+    static void set_level(LogLevel level) {
+        for (size_t c = 0; c < static_cast<size_t>(LogCategory::Count); ++c) {
+            set_level(static_cast<LogCategory>(c), level);
+        }
+    }
+
+    // 设置输出目标；传入空函数时恢复为 std::cerr
+    static void set_sink(Sink sink) {
+        std::lock_guard<std::mutex> lock(sink_mutex());
+        sink_slot() = std::move(sink);
+    }
+
+    static void write(LogLevel level, LogCategory category, const std::string& message) {
+        std::lock_guard<std::mutex> lock(sink_mutex());
+        if (sink_slot()) {
+            sink_slot()(level, category, message);
+        } else {
+            std::cerr << "[" << level_name(level) << "][" << category_name(category) << "] " << message << std::endl;
+        }
+    }
+
+    // 解析配置串，返回是否全部有效；无效的项被忽略
+    static bool configure(const std::string& spec) {
+        bool ok = true;
+        size_t pos = 0;
+        while (pos <= spec.size()) {
+            size_t comma = spec.find(',', pos);
+            if (comma == std::string::npos) comma = spec.size();
+            std::string item = spec.substr(pos, comma - pos);
+            pos = comma + 1;
+            if (item.empty()) continue;
+
+            LogLevel level;
+            size_t eq = item.find('=');
+            if (eq == std::string::npos) {
+                if (parse_level(item, level)) set_level(level); else ok = false;
+                continue;
+            }
+            LogCategory category;
+            if (parse_category(item.substr(0, eq), category) && parse_level(item.substr(eq + 1), level)) {
+                set_level(category, level);
+            } else {
+                ok = false;
+            }
+        }
+        return ok;
+    }
+
+    static const char* level_name(LogLevel level) {
+        static const char* const names[] = {"trace", "debug", "info", "warn", "error", "off"};
+        return names[static_cast<size_t>(level)];
+    }
+
+    static const char* category_name(LogCategory category) {
+        static const char* const names[] = {"parser", "interpreter", "module", "vm"};
+        return category < LogCategory::Count ? names[static_cast<size_t>(category)] : "?";
+    }
+
+private:
+    static std::atomic<unsigned char>* thresholds() {
+        static std::atomic<unsigned char> levels[static_cast<size_t>(LogCategory::Count)] = {
+            {static_cast<unsigned char>(LogLevel::Warn)},
+            {static_cast<unsigned char>(LogLevel::Warn)},
+            {static_cast<unsigned char>(LogLevel::Warn)},
+            {static_cast<unsigned char>(LogLevel::Warn)},
+        };
+        return levels;
+    }
+
+    static std::mutex& sink_mutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static Sink& sink_slot() {
+        static Sink sink;
+        return sink;
+    }
+
+    static std::string lower(const std::string& text) {
+        std::string result = text;
+        for (auto& ch : result) ch = static_cast<char>(std::tolower(static_cast<unsigned char>(ch)));
+        return result;
+    }
+
+    static bool parse_level(const std::string& text, LogLevel& out) {
+        std::string name = lower(text);
+        for (unsigned char l = 0; l <= static_cast<unsigned char>(LogLevel::Off); ++l) {
+            if (name == level_name(static_cast<LogLevel>(l))) {
+                out = static_cast<LogLevel>(l);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool parse_category(const std::string& text, LogCategory& out) {
+        std::string name = lower(text);
+        for (unsigned char c = 0; c < static_cast<unsigned char>(LogCategory::Count); ++c) {
+            if (name == category_name(static_cast<LogCategory>(c))) {
+                out = static_cast<LogCategory>(c);
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+#ifdef LAMINA_LOG_DISABLED
+#define LAMINA_LOG(level, category, message) do { } while (0)
+#else
+#define LAMINA_LOG(level, category, message)                                              \
+    do {                                                                                  \
+        if (Log::enabled(LogLevel::level, LogCategory::category)) {                       \
+            std::ostringstream lamina_log_stream;                                         \
+            lamina_log_stream << message;                                                 \
+            Log::write(LogLevel::level, LogCategory::category, lamina_log_stream.str());  \
+        }                                                                                 \
+    } while (0)
+#endif
@@ -1,20 +1,131 @@
 // main.cpp
 #include "interpreter.hpp"  // 首先包含
 #include "module_loader.hpp"
+#include "log.hpp"
 #include "lexer.hpp"
 #include "parser.hpp"
+#include "script_cache.hpp"
 #include "trackback.hpp"
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <typeinfo>
 #include "repl_input.hpp"
 
+// Ctrl+C 中断正在执行的代码而不结束进程；上一次中断尚未生效时再次按下则按默认方式退出
+static std::atomic<Interpreter*> interrupt_target{nullptr};
+
+static void handle_sigint(int) {
+    Interpreter* interp = interrupt_target.load();
+    if (!interp || interp->interrupt_pending()) {
+        std::signal(SIGINT, SIG_DFL);
+        std::raise(SIGINT);
+        return;
+    }
+    interp->request_interrupt();
+    // Windows 在调用处理函数前会恢复默认处理，需要重新安装
+    std::signal(SIGINT, handle_sigint);
+}
+
+// 解析 --name=<正整数> 形式的参数；前缀不匹配时返回 false，数值无效时报错退出
+static bool parse_count_flag(const std::string& arg, const std::string& prefix, unsigned long long& out) {
+    if (arg.rfind(prefix, 0) != 0) return false;
+    std::string text = arg.substr(prefix.size());
+    try {
+        size_t used = 0;
+        long long n = std::stoll(text, &used);
+        if (n > 0 && used == text.size()) {
+            out = static_cast<unsigned long long>(n);
+            return true;
+        }
+    } catch (const std::exception&) {
+    }
+    std::cerr << "Invalid value: " << arg << std::endl;
+    std::exit(1);
+}
+
+// 顶层语句以 return/break/continue 结束时给出警告；返回是否发出了警告
+static bool warn_stray_completion(const Completion& completion, int line) {
+    switch (completion.kind) {
+    case Completion::Kind::Return:
+        Interpreter::print_warning("Return statement used outside function (line " + std::to_string(line) + ")", true);
+        return true;
+    case Completion::Kind::Break:
+        Interpreter::print_warning("Break statement used outside loop (line " + std::to_string(line) + ")", true);
+        return true;
+    case Completion::Kind::Continue:
+        Interpreter::print_warning("Continue statement used outside loop (line " + std::to_string(line) + ")", true);
+        return true;
+    default:
+        return false;
+    }
+}
+
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
+    // 命令行参数：--vm 使用字节码虚拟机执行，--tree 使用树遍历解释器（默认）
+    // --stack-budget=<MB> 设置字节码模式下调用帧可用的内存，决定最大递归深度
+    // --fuel=<N> 限制循环迭代与函数调用的总次数，--timeout=<ms> 限制执行时间（REPL 中按每次输入计算）
+    // --log=<spec> 设置诊断输出级别（见 log.hpp，也可用环境变量 LAMINA_LOG），--log-file=<path> 将其写入文件
+    // --no-cache 不读写脚本的语法树缓存（.lmc，见 script_cache.hpp）
+    ExecutionEngine engine = ExecutionEngine::TreeWalker;
+    unsigned long long stack_budget = 0, fuel = 0, timeout = 0;
+    const char* script_path = nullptr;
+    std::ofstream log_file;
+    if (const char* spec = std::getenv("LAMINA_LOG")) {
+        Log::configure(spec);
+    }
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.rfind("--log=", 0) == 0) {
+            if (!Log::configure(arg.substr(6))) {
+                std::cerr << "Invalid value: " << arg << std::endl;
+                return 1;
+            }
+        } else if (arg.rfind("--log-file=", 0) == 0) {
+            log_file.open(arg.substr(11), std::ios::app);
+            if (!log_file) {
+                std::cerr << "Unable to open log file: " << arg.substr(11) << std::endl;
+                return 1;
+            }
+            Log::set_sink([&log_file](LogLevel level, LogCategory category, const std::string& message) {
+                log_file << "[" << Log::level_name(level) << "][" << Log::category_name(category) << "] "
+                         << message << std::endl;
+            });
+        } else if (arg == "--vm") {
+            engine = ExecutionEngine::Bytecode;
+        } else if (arg == "--tree") {
+            engine = ExecutionEngine::TreeWalker;
+        } else if (arg == "--no-cache") {
+            ScriptCache::set_enabled(false);
+        } else if (parse_count_flag(arg, "--stack-budget=", stack_budget) ||
+                   parse_count_flag(arg, "--fuel=", fuel) ||
+                   parse_count_flag(arg, "--timeout=", timeout)) {
+            continue;
+        } else if (!script_path) {
+            script_path = argv[i];
+        } else {
+            std::cerr << "Unexpected argument: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    auto configure = [&](Interpreter& interpreter) {
+        interpreter.set_engine(engine);
+        if (stack_budget) interpreter.set_call_stack_budget(static_cast<size_t>(stack_budget) << 20);
+        if (fuel) interpreter.set_fuel_limit(fuel);
+        if (timeout) interpreter.set_time_limit(std::chrono::milliseconds(timeout));
+        interrupt_target.store(&interpreter);
+        std::signal(SIGINT, handle_sigint);
+    };
+
+    if (!script_path) {
         std::cout << "Lamina REPL. Press Ctrl+C or :exit to exit.\n";
         std::cout << "Type :help for help.\n";
         Interpreter interpreter;
+        configure(interpreter);
         int lineno = 1;
         while (true) {
             try {
@@ -74,23 +185,16 @@ int main(int argc, char* argv[]) {
                     auto* block = dynamic_cast<BlockStmt*>(ast.get());
                     if (block) {
                         interpreter.save_repl_ast(std::move(ast));
+                        // 每次输入重新计算执行预算
+                        interpreter.reset_execution_budget();
                         
                         try {
                             for (auto& stmt : block->statements) {
                                 try {
-                                    interpreter.execute(stmt);
+                                    if (warn_stray_completion(interpreter.run_statement(stmt), lineno)) break;
                                 } catch (const RuntimeError& re) {
                                     interpreter.print_stack_trace(re, true);
                                     break;
-                                } catch (const ReturnException&) {
-                                    Interpreter::print_warning("Return statement used outside function (line " + std::to_string(lineno) + ")", true);
-                                    break;
-                                } catch (const BreakException&) {
-                                    Interpreter::print_warning("Break statement used outside loop (line " + std::to_string(lineno) + ")", true);
-                                    break;
-                                } catch (const ContinueException&) {
-                                    Interpreter::print_warning("Continue statement used outside loop (line " + std::to_string(lineno) + ")", true);
-                                    break;
                                 } catch (const std::exception& e) {
                                     Interpreter::print_error(e.what(), true);
                                     break;
@@ -98,8 +202,6 @@ int main(int argc, char* argv[]) {
                             }
                         } catch (const RuntimeError& re) {
                             interpreter.print_stack_trace(re, true);
-                        } catch (const ReturnException&) {
-                            Interpreter::print_warning("Return statement used outside function", true);
                         } catch (...) {
                             Interpreter::print_error("Unknown error occurred", true);
                         }
@@ -112,27 +214,27 @@ int main(int argc, char* argv[]) {
         }
         return 0;
     }
-    std::ifstream file(argv[1]);
+    std::ifstream file(script_path);
     if (!file) {
-        std::cerr << "Unable to open file: " << argv[1] << std::endl;
+        std::cerr << "Unable to open file: " << script_path << std::endl;
         return 1;
     }
-    std::cout << "Executing file: " << argv[1] << std::endl;
+    std::cout << "Executing file: " << script_path << std::endl;
     std::stringstream buffer;
     buffer << file.rdbuf();
     std::string source = buffer.str();
-    auto tokens = Lexer::tokenize(source);
-    auto ast = Parser::parse(tokens);
+    auto ast = ScriptCache::load(script_path, source);
     Interpreter interpreter;
+    configure(interpreter);
     
     // 加载minimal模块
-    std::cout << "Loading minimal module..." << std::endl;
+    LAMINA_LOG(Info, Module, "Loading minimal module...");
     try {
         auto moduleLoader = std::make_unique<ModuleLoader>("minimal.dll");
         if (moduleLoader->isLoaded()) {
-            std::cout << "Module loaded successfully, registering to interpreter..." << std::endl;
+            LAMINA_LOG(Info, Module, "Module loaded successfully, registering to interpreter...");
             if (moduleLoader->registerToInterpreter(interpreter)) {
-                std::cout << "Module registered successfully!" << std::endl;
+                LAMINA_LOG(Info, Module, "Module registered successfully!");
             } else {
                 std::cerr << "Failed to register module to interpreter!" << std::endl;
             }
@@ -144,25 +246,25 @@ int main(int argc, char* argv[]) {
     }
     
     if (!ast) {
-        print_traceback(argv[1], 1);
+        print_traceback(script_path, 1);
         return 2;
     }
     
     auto* block = dynamic_cast<BlockStmt*>(ast.get());
     if (block) {
         int currentLine = 0;
+        interpreter.reset_execution_budget();
         for (auto& stmt : block->statements) {
             currentLine++;
             try {
-                interpreter.execute(stmt);
+                warn_stray_completion(interpreter.run_statement(stmt), currentLine);
+            } catch (const ExecutionAborted& aborted) {
+                // 预算耗尽或被中断时不再执行后续语句
+                interpreter.print_stack_trace(aborted, true);
+                std::cout << "\nProgram execution aborted." << std::endl;
+                return 1;
             } catch (const RuntimeError& re) {
                 interpreter.print_stack_trace(re, true);
-            } catch (const ReturnException&) {
-                Interpreter::print_warning("Return statement used outside function (line " + std::to_string(currentLine) + ")", true);
-            } catch (const BreakException&) {
-                Interpreter::print_warning("Break statement used outside loop (line " + std::to_string(currentLine) + ")", true);
-            } catch (const ContinueException&) {
-                Interpreter::print_warning("Continue statement used outside loop (line " + std::to_string(currentLine) + ")", true);
             } catch (const std::exception& e) {
                 Interpreter::print_error(std::string(e.what()) + " (line " + std::to_string(currentLine) + ")", true);
             } catch (...) {
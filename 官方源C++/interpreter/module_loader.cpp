@@ -2,6 +2,8 @@
  * 合并后的模块加载器实现
  */
 #include "module_loader.hpp"
+#include "log.hpp"
+#include <climits>
 #include <iostream>
 
 // Helper functions for conversion
@@ -13,13 +15,18 @@ LaminaValue ModuleLoader::valueToLamina(const Value& val) {
             result = LAMINA_MAKE_NULL();
             break;
         case Value::Type::Bool:
-            result = LAMINA_MAKE_BOOL(std::get<bool>(val.data));
+            result = LAMINA_MAKE_BOOL(val.get<bool>());
             break;
         case Value::Type::Int:
-            result = LAMINA_MAKE_INT(std::get<int>(val.data));
+            // 模块接口中的整数为 32 位，超出范围的值按浮点数传递
+            if (val.get<int64_t>() >= INT_MIN && val.get<int64_t>() <= INT_MAX) {
+                result = LAMINA_MAKE_INT(static_cast<int>(val.get<int64_t>()));
+            } else {
+                result = LAMINA_MAKE_DOUBLE(static_cast<double>(val.get<int64_t>()));
+            }
             break;
         case Value::Type::Float:
-            result = LAMINA_MAKE_DOUBLE(std::get<double>(val.data));
+            result = LAMINA_MAKE_DOUBLE(val.get<double>());
             break;
         case Value::Type::String:
             result = LAMINA_MAKE_STRING(val.to_string().c_str());
@@ -76,7 +83,7 @@ std::vector<Value> ModuleLoader::laminaToVector(const LaminaValue* vals, int cou
 
 // 构造函数
 ModuleLoader::ModuleLoader(const std::string& path) : m_path(path) {
-    std::cout << "Loading module: " << path << std::endl;
+    LAMINA_LOG(Info, Module, "Loading module: " << path);
     
     // 基本安全检查
     std::ifstream file(path, std::ios::binary);
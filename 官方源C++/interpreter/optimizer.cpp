@@ -0,0 +1,303 @@
+#include "optimizer.hpp"
+#include "interpreter.hpp"
+#include <climits>
+
+namespace {
+
+const Value* literal_value(const Expression* expr) {
+    if (expr && expr->kind == NodeKind::Literal) {
+        return &static_cast<const LiteralExpr*>(expr)->value;
+    }
+    return nullptr;
+}
+
+bool is_int_literal(const Expression* expr, int n) {
+    const Value* v = literal_value(expr);
+    return v && v->is_int() && v->get<int64_t>() == n;
+}
+
+// 两个常量能否在编译期运算：运行时会报错退出或行为未定义的组合保持原样
+bool can_fold_binary(BinaryOp op, const Value& l, const Value& r) {
+    switch (op) {
+    case BinaryOp::Add:
+        return l.is_string() || r.is_string() || (l.is_numeric() && r.is_numeric());
+    case BinaryOp::Sub:
+    case BinaryOp::Mul:
+    case BinaryOp::Pow:
+        return l.is_numeric() && r.is_numeric();
+    case BinaryOp::Div:
+        if (!l.is_numeric() || !r.is_numeric() || l.is_bigint() || r.is_bigint()) return false;
+        if (l.is_irrational() || r.is_irrational()) return !r.as_irrational().is_zero();
+        return !r.as_rational().is_zero();
+    case BinaryOp::Mod:
+        // 只折叠两侧均为整数且不会除零的情况
+        return l.is_int() && r.is_int() && r.get<int64_t>() != 0;
+    default:
+        if ((l.is_numeric() && r.is_numeric()) || (l.is_string() && r.is_string()) ||
+            (l.is_bool() && r.is_bool())) {
+            return true;
+        }
+        // 类型不同时只有 == 与 != 有定义
+        return op == BinaryOp::Eq || op == BinaryOp::Ne;
+    }
+}
+
+bool can_fold_unary(UnaryOp op, const Value& v) {
+    switch (op) {
+    case UnaryOp::Negate:
+        return v.is_int() || v.is_bigint();
+    case UnaryOp::Factorial: {
+        // 过大的阶乘留到运行时
+        if (!v.is_int()) return false;
+        int64_t n = v.get<int64_t>();
+        return n >= 0 && n <= 1000;
+    }
+    default:
+        return v.is_numeric();
+    }
+}
+
+// 已知无副作用的内置函数；参数不合法时内置函数会打印错误，这类调用不折叠
+struct PureBuiltin {
+    const char* name;
+    size_t arity;
+    bool non_negative;
+};
+
+const PureBuiltin pure_builtins[] = {
+    {"pi", 0, false},
+    {"e", 0, false},
+    {"sqrt", 1, true},
+    {"abs", 1, false},
+    {"sin", 1, false},
+    {"cos", 1, false},
+    {"tan", 1, false},
+};
+
+NodePtr<Expression> make_literal(const Value& value, const Expression* original) {
+    auto lit = make_node<LiteralExpr>(value);
+    lit->source = original->source;
+    return lit;
+}
+
+} // namespace
+
+bool is_pure_builtin(const std::string& name) {
+    for (const auto& entry : pure_builtins) {
+        if (name == entry.name) return true;
+    }
+    return false;
+}
+
+void Optimizer::optimize(Statement* stmt) {
+    assigned_names.clear();
+    collect_names(stmt);
+    optimize_stmt(stmt);
+}
+
+void Optimizer::collect_names(const Statement* stmt) {
+    if (!stmt) return;
+    switch (stmt->kind) {
+    case NodeKind::VarDecl:
+        assigned_names.insert(static_cast<const VarDeclStmt*>(stmt)->name);
+        break;
+    case NodeKind::Assign:
+        assigned_names.insert(static_cast<const AssignStmt*>(stmt)->name);
+        break;
+    case NodeKind::BigIntDecl:
+        assigned_names.insert(static_cast<const BigIntDeclStmt*>(stmt)->name);
+        break;
+    case NodeKind::If: {
+        auto* ifs = static_cast<const IfStmt*>(stmt);
+        collect_names(ifs->thenBlock.get());
+        collect_names(ifs->elseBlock.get());
+        break;
+    }
+    case NodeKind::While:
+        collect_names(static_cast<const WhileStmt*>(stmt)->body.get());
+        break;
+    case NodeKind::For: {
+        auto* fs = static_cast<const ForStmt*>(stmt);
+        assigned_names.insert(fs->name);
+        collect_names(fs->body.get());
+        break;
+    }
+    case NodeKind::FuncDef: {
+        auto* func = static_cast<const FuncDefStmt*>(stmt);
+        assigned_names.insert(func->params.begin(), func->params.end());
+        collect_names(func->body.get());
+        break;
+    }
+    case NodeKind::Block:
+        for (const auto& s : static_cast<const BlockStmt*>(stmt)->statements) {
+            collect_names(s.get());
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void Optimizer::optimize_block(BlockStmt* block) {
+    if (!block) return;
+    for (auto& stmt : block->statements) {
+        optimize_stmt(stmt.get());
+    }
+}
+
+void Optimizer::optimize_stmt(Statement* stmt) {
+    if (!stmt) return;
+    switch (stmt->kind) {
+    case NodeKind::VarDecl:
+        optimize_expr(static_cast<VarDeclStmt*>(stmt)->expr);
+        break;
+    case NodeKind::Assign:
+        optimize_expr(static_cast<AssignStmt*>(stmt)->expr);
+        break;
+    case NodeKind::BigIntDecl:
+        optimize_expr(static_cast<BigIntDeclStmt*>(stmt)->init_value);
+        break;
+    case NodeKind::Define:
+        optimize_expr(static_cast<DefineStmt*>(stmt)->value);
+        break;
+    case NodeKind::If: {
+        auto* ifs = static_cast<IfStmt*>(stmt);
+        optimize_expr(ifs->condition);
+        optimize_block(ifs->thenBlock.get());
+        optimize_block(ifs->elseBlock.get());
+        break;
+    }
+    case NodeKind::While: {
+        auto* ws = static_cast<WhileStmt*>(stmt);
+        optimize_expr(ws->condition);
+        optimize_block(ws->body.get());
+        break;
+    }
+    case NodeKind::For: {
+        auto* fs = static_cast<ForStmt*>(stmt);
+        optimize_expr(fs->start);
+        optimize_expr(fs->end);
+        optimize_block(fs->body.get());
+        break;
+    }
+    case NodeKind::FuncDef:
+        optimize_block(static_cast<FuncDefStmt*>(stmt)->body.get());
+        break;
+    case NodeKind::Block:
+        optimize_block(static_cast<BlockStmt*>(stmt));
+        break;
+    case NodeKind::Return:
+        optimize_expr(static_cast<ReturnStmt*>(stmt)->expr);
+        break;
+    case NodeKind::ExprStmt:
+        optimize_expr(static_cast<ExprStmt*>(stmt)->expr);
+        break;
+    default:
+        break;
+    }
+}
+
+void Optimizer::optimize_expr(NodePtr<Expression>& expr) {
+    if (!expr) return;
+    NodePtr<Expression> replacement;
+
+    // 先优化子表达式，再尝试改写当前节点
+    switch (expr->kind) {
+    case NodeKind::Binary: {
+        auto* bin = static_cast<BinaryExpr*>(expr.get());
+        optimize_expr(bin->left);
+        optimize_expr(bin->right);
+        if (bin->left && bin->right) replacement = fold_binary(bin);
+        break;
+    }
+    case NodeKind::Unary: {
+        auto* unary = static_cast<UnaryExpr*>(expr.get());
+        optimize_expr(unary->operand);
+        if (unary->operand) replacement = fold_unary(unary);
+        break;
+    }
+    case NodeKind::Call: {
+        auto* call = static_cast<CallExpr*>(expr.get());
+        for (auto& arg : call->args) optimize_expr(arg);
+        replacement = fold_call(call);
+        break;
+    }
+    case NodeKind::NamespaceCall:
+        for (auto& arg : static_cast<NamespaceCallExpr*>(expr.get())->args) optimize_expr(arg);
+        break;
+    case NodeKind::Array:
+        for (auto& element : static_cast<ArrayExpr*>(expr.get())->elements) optimize_expr(element);
+        break;
+    default:
+        break;
+    }
+
+    if (replacement) expr = std::move(replacement);
+}
+
+NodePtr<Expression> Optimizer::fold_binary(BinaryExpr* bin) {
+    const Value* l = literal_value(bin->left.get());
+    const Value* r = literal_value(bin->right.get());
+
+    if (l && r) {
+        try {
+            if (can_fold_binary(bin->op, *l, *r)) {
+                return make_literal(interp.binary_op(bin->op, *l, *r), bin);
+            }
+        } catch (...) {
+            // 运行时会抛出的错误留到运行时报告
+        }
+        return nullptr;
+    }
+
+    // x ^ 2 改为平方运算，省去 std::pow 调用
+    if (bin->op == BinaryOp::Pow && is_int_literal(bin->right.get(), 2)) {
+        auto square = make_node<UnaryExpr>(UnaryOp::Square, std::move(bin->left));
+        square->source = bin->source;
+        return square;
+    }
+    return nullptr;
+}
+
+NodePtr<Expression> Optimizer::fold_unary(UnaryExpr* unary) {
+    const Value* v = literal_value(unary->operand.get());
+    if (!v) return nullptr;
+    try {
+        if (can_fold_unary(unary->op, *v)) {
+            return make_literal(interp.unary_op(unary->op, *v), unary);
+        }
+    } catch (...) {
+    }
+    return nullptr;
+}
+
+NodePtr<Expression> Optimizer::fold_call(CallExpr* call) {
+    const PureBuiltin* pure = nullptr;
+    for (const auto& entry : pure_builtins) {
+        if (call->callee == entry.name) {
+            pure = &entry;
+            break;
+        }
+    }
+    if (!pure || call->args.size() != pure->arity) return nullptr;
+    // 同名变量可能保存着另一个函数。AST 可能由多个实例执行，不依赖当前实例的变量与扩展函数：
+    // 任何实例用过该名称的全局变量时都不折叠，并且只按共享内置函数表求值
+    if (assigned_names.count(call->callee) || Interpreter::is_global_name(call->callee)) return nullptr;
+
+    const Interpreter::BuiltinFunction* builtin = interp.find_shared_builtin(call->callee);
+    if (!builtin) return nullptr;
+
+    std::vector<Value> args;
+    for (const auto& arg : call->args) {
+        const Value* v = literal_value(arg.get());
+        if (!v || !v->is_numeric()) return nullptr;
+        if (pure->non_negative && v->as_number() < 0) return nullptr;
+        args.push_back(*v);
+    }
+
+    try {
+        return make_literal((*builtin)(args), call);
+    } catch (...) {
+        return nullptr;
+    }
+}
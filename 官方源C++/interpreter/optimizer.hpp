@@ -0,0 +1,32 @@
+#pragma once
+#include "ast.hpp"
+#include <memory>
+#include <set>
+#include <string>
+
+class Interpreter;
+
+// 已知无副作用、可在多个线程上同时调用的内置函数
+bool is_pure_builtin(const std::string& name);
+
+// AST 优化：在名称解析之前进行常量折叠与强度削减
+// 折叠直接调用解释器的运算实现，结果与运行时求值完全一致；运行时会报错的表达式保持原样
+class Optimizer {
+public:
+    explicit Optimizer(Interpreter& interpreter) : interp(interpreter) {}
+    void optimize(Statement* stmt);
+
+private:
+    void optimize_stmt(Statement* stmt);
+    void optimize_block(BlockStmt* block);
+    void optimize_expr(NodePtr<Expression>& expr);
+    // 返回替换后的节点，无法优化时返回 nullptr
+    NodePtr<Expression> fold_binary(BinaryExpr* bin);
+    NodePtr<Expression> fold_unary(UnaryExpr* unary);
+    NodePtr<Expression> fold_call(CallExpr* call);
+    void collect_names(const Statement* stmt);
+
+    Interpreter& interp;
+    // 当前语句中被声明或赋值的名称，同名的函数调用可能指向变量中保存的函数，不能按内置函数折叠
+    std::set<std::string> assigned_names;
+};
@@ -0,0 +1,407 @@
+/*
+ * 数据并行的数组内置函数：map / filter / reduce / sum / zip_with
+ *
+ * 数组按元素、矩阵按行遍历（与 for 循环一致）。元素较多、且回调不会访问调用方解释器的状态时，
+ * 切块交给共享线程池并行执行；否则在调用方解释器中依次调用。可以并行的回调有两类：
+ *   - 纯内置函数（见 optimizer.cpp 中的 pure_builtins）
+ *   - 隔离的用户函数：只读写参数与局部变量，不调用其他函数，不含 while 循环，
+ *     在每个工作线程自己的解释器实例中执行
+ * reduce 并行时先在各块内归约再依次合并，要求回调满足结合律（与 std::reduce 相同）。
+ */
+#include "interpreter.hpp"
+#include "lamina.hpp"
+#include "optimizer.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <unordered_set>
+
+namespace {
+
+// 元素数不少于 PARALLEL_THRESHOLD 时并行，每个任务处理 PARALLEL_GRAIN 个元素
+constexpr size_t PARALLEL_THRESHOLD = 2048;
+constexpr size_t PARALLEL_GRAIN = 256;
+
+// 检查用户函数是否与调用方隔离；局部变量必须先赋值再读取，否则运行时会退回读取全局变量
+class IsolationCheck {
+public:
+    bool function(const FuncDefStmt* func) {
+        if (!func || !func->resolved || !func->body) return false;
+        assigned.clear();
+        assigned.insert(func->params.begin(), func->params.end());
+        return block(func->body.get());
+    }
+
+private:
+    // 块内的赋值只在块内（其后的语句中）视为已赋值
+    bool block(const BlockStmt* b) {
+        if (!b) return true;
+        auto saved = assigned;
+        for (const auto& s : b->statements) {
+            if (!statement(s.get())) return false;
+        }
+        assigned = std::move(saved);
+        return true;
+    }
+
+    bool statement(const Statement* s) {
+        if (!s) return true;
+        switch (s->kind) {
+        case NodeKind::VarDecl: {
+            auto* v = static_cast<const VarDeclStmt*>(s);
+            if (!local(v->ref) || !expr(v->expr.get())) return false;
+            assigned.insert(v->name);
+            return true;
+        }
+        case NodeKind::Assign: {
+            auto* a = static_cast<const AssignStmt*>(s);
+            if (!local(a->ref) || !expr(a->expr.get())) return false;
+            assigned.insert(a->name);
+            return true;
+        }
+        case NodeKind::If: {
+            auto* ifs = static_cast<const IfStmt*>(s);
+            return expr(ifs->condition.get()) && block(ifs->thenBlock.get()) && block(ifs->elseBlock.get());
+        }
+        case NodeKind::For: {
+            auto* fs = static_cast<const ForStmt*>(s);
+            if (!local(fs->ref) || !expr(fs->start.get()) || (fs->end && !expr(fs->end.get()))) return false;
+            auto saved = assigned;
+            assigned.insert(fs->name);
+            bool ok = block(fs->body.get());
+            assigned = std::move(saved);
+            return ok;
+        }
+        case NodeKind::Block:
+            return block(static_cast<const BlockStmt*>(s));
+        case NodeKind::Return: {
+            auto* ret = static_cast<const ReturnStmt*>(s);
+            return !ret->expr || expr(ret->expr.get());
+        }
+        case NodeKind::ExprStmt:
+            return expr(static_cast<const ExprStmt*>(s)->expr.get());
+        case NodeKind::Break:
+        case NodeKind::Continue:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool expr(const Expression* e) {
+        if (!e) return false;
+        switch (e->kind) {
+        case NodeKind::Literal:
+            return true;
+        case NodeKind::Identifier: {
+            auto* id = static_cast<const IdentifierExpr*>(e);
+            return local(id->ref) && assigned.count(id->name);
+        }
+        case NodeKind::Var: {
+            auto* var = static_cast<const VarExpr*>(e);
+            return local(var->ref) && assigned.count(var->name);
+        }
+        case NodeKind::Binary: {
+            auto* bin = static_cast<const BinaryExpr*>(e);
+            return expr(bin->left.get()) && expr(bin->right.get());
+        }
+        case NodeKind::Unary:
+            return expr(static_cast<const UnaryExpr*>(e)->operand.get());
+        case NodeKind::Array:
+            for (const auto& element : static_cast<const ArrayExpr*>(e)->elements) {
+                if (!expr(element.get())) return false;
+            }
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    static bool local(const VarRef& ref) { return ref.scope == VarRef::Scope::Local; }
+
+    std::unordered_set<std::string> assigned;
+};
+
+// 工作线程上执行隔离函数与求和的解释器，每个线程一个，跨调用复用
+Interpreter& worker_interpreter() {
+    thread_local Interpreter worker;
+    return worker;
+}
+
+RuntimeError builtin_error(const Interpreter& interp, const std::string& message) {
+    RuntimeError error(message);
+    error.stack_trace = interp.get_stack_trace();
+    return error;
+}
+
+// 可遍历的元素：数组直接引用其元素，矩阵按行生成数组值
+class Items {
+public:
+    Items(const Interpreter& interp, const Value& v, const char* func) {
+        if (v.is_array()) {
+            items = &v.get<std::vector<Value>>();
+        } else if (v.is_matrix()) {
+            for (const auto& row : v.get<std::vector<std::vector<Value>>>()) {
+                rows.emplace_back(row);
+            }
+            items = &rows;
+        } else {
+            throw builtin_error(interp, std::string(func) + "() requires an array or matrix");
+        }
+    }
+    size_t size() const { return items->size(); }
+    const Value& operator[](size_t i) const { return (*items)[i]; }
+
+private:
+    const std::vector<Value>* items = nullptr;
+    std::vector<Value> rows;
+};
+
+void check_arity(const Interpreter& interp, const std::vector<Value>& args, size_t min, size_t max, const char* func) {
+    if (args.size() < min || args.size() > max) {
+        std::string expected = min == max ? std::to_string(min) : std::to_string(min) + " or " + std::to_string(max);
+        throw builtin_error(interp, std::string(func) + "() requires " + expected + " arguments");
+    }
+}
+
+} // namespace
+
+// 一次并行调用。各块在所在线程的工作解释器上执行，期间使用调用方的执行预算（fuel 合计、时限与中断），
+// 使 --fuel、--timeout 与 Ctrl+C 同样作用于回调中的循环；结束时各线程用掉的 fuel 计入调用方
+struct Interpreter::ParallelRun {
+    explicit ParallelRun(Interpreter& interpreter) : caller(interpreter), start(interpreter.get_fuel_used()) {
+        budget.fuel_spent.store(start);
+        budget.fuel_limit = caller.fuel_limit;
+        budget.time_limit = caller.time_limit;
+        budget.deadline = caller.deadline;
+        budget.interrupt = caller.interrupt_flag.get();
+    }
+
+    ~ParallelRun() {
+        caller.fuel_spent += budget.fuel_spent.load() - start;
+        caller.fuel_spent += static_cast<uint64_t>(caller.budget_slice - caller.budget_countdown);
+        caller.start_budget_slice();
+    }
+
+    // 在共享线程池上执行 parallel_for。任务中的 error_and_exit 以 DeferredExit 抛出，待所有块结束后在这里
+    // 重新调用 error_and_exit：调用线程不在任务中时输出错误并退出，否则继续抛给外层任务
+    void operator()(size_t n, const std::function<void(size_t, size_t)>& body) {
+        try {
+            ThreadPool::shared().parallel_for(n, PARALLEL_GRAIN, [&](size_t begin, size_t end) {
+                Lease lease(worker_interpreter(), budget);
+                body(begin, end);
+            });
+        } catch (const DeferredExit& exit) {
+            error_and_exit(exit.message);
+        }
+    }
+
+    // 按 PARALLEL_GRAIN 把 [0, n) 分块并行调用 body(chunk, begin, end)。线程池在单线程时会把整个区间
+    // 一次交给调用方，这里再拆成固定大小的块，使分块方式（以及 reduce/sum 的合并顺序）与线程数无关
+    template <class Body>
+    void chunks(size_t n, Body body) {
+        (*this)(n, [&](size_t begin, size_t end) {
+            for (size_t b = begin; b < end; b += PARALLEL_GRAIN) {
+                body(b / PARALLEL_GRAIN, b, std::min(end, b + PARALLEL_GRAIN));
+            }
+        });
+    }
+
+    // 工作解释器在一个块内改用调用方的预算，结束时把未结算的 fuel 计入合计
+    struct Lease {
+        Lease(Interpreter& interpreter, SharedBudget& budget) : worker(interpreter) {
+            worker.shared_budget = &budget;
+            worker.start_budget_slice();
+        }
+        ~Lease() {
+            worker.shared_budget->fuel_spent.fetch_add(static_cast<uint64_t>(worker.budget_slice - worker.budget_countdown),
+                                                       std::memory_order_relaxed);
+            worker.shared_budget = nullptr;
+            worker.start_budget_slice();
+        }
+        Interpreter& worker;
+    };
+
+    Interpreter& caller;
+    uint64_t start;
+    SharedBudget budget;
+};
+
+// 数组内置函数的回调：函数名字符串或函数值（__function_ 形式）
+struct Interpreter::ArrayCallback {
+    enum class Mode { Serial, PureBuiltin, Isolated };
+
+    ArrayCallback(Interpreter& interpreter, const Value& callee, const char* func) : interp(interpreter) {
+        if (!callee.is_string()) {
+            throw builtin_error(interp, std::string(func) + "() callback must be a function");
+        }
+        std::string name = callee.get<std::string>();
+        if (name.compare(0, 11, "__function_") == 0) name = name.substr(11);
+        interp.resolve_call_target(cache, name);
+        if (cache.builtin || cache.interpreter_builtin) {
+            mode = cache.builtin && is_pure_builtin(name) ? Mode::PureBuiltin : Mode::Serial;
+        } else if (cache.func) {
+            mode = IsolationCheck().function(cache.func) ? Mode::Isolated : Mode::Serial;
+        } else {
+            throw builtin_error(interp, std::string(func) + "() callback '" + name + "' is not a function");
+        }
+    }
+
+    bool parallel() const { return mode != Mode::Serial; }
+
+    // 在调用方线程上按普通函数调用执行
+    Value call(std::vector<Value>& args) const { return interp.call_target(cache, args); }
+
+    // 在任意线程上执行，仅当 parallel() 时可用
+    Value call_isolated(std::vector<Value>& args) const {
+        if (mode == Mode::PureBuiltin) return (*cache.builtin)(args);
+        return worker_interpreter().call_user_function(cache.func, cache.func->name, args);
+    }
+
+    // n 个元素时是否切块并行
+    bool split(size_t n) const {
+        return parallel() && n >= PARALLEL_THRESHOLD && ThreadPool::shared().concurrency() > 1;
+    }
+
+    // 对 [0, n) 的每个下标调用 body(i, call)，大输入时并行
+    template <class Body>
+    void for_each(size_t n, Body body) const {
+        if (split(n)) {
+            ParallelRun run(interp);
+            run(n, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    body(i, [this](std::vector<Value>& args) { return call_isolated(args); });
+                }
+            });
+        } else {
+            for (size_t i = 0; i < n; ++i) {
+                body(i, [this](std::vector<Value>& args) { return call(args); });
+            }
+        }
+    }
+
+    Interpreter& interp;
+    CallSiteCache cache;
+    Mode mode = Mode::Serial;
+};
+
+// 回调要在发起调用的实例中解析与执行，因此登记为接收调用方解释器的共享内置函数
+void Interpreter::register_parallel_builtins(BuiltinTable& table) {
+    table.interpreter_functions["map"] = [](Interpreter& in, const std::vector<Value>& args) { return in.builtin_map(args); };
+    table.interpreter_functions["filter"] = [](Interpreter& in, const std::vector<Value>& args) { return in.builtin_filter(args); };
+    table.interpreter_functions["reduce"] = [](Interpreter& in, const std::vector<Value>& args) { return in.builtin_reduce(args); };
+    table.interpreter_functions["sum"] = [](Interpreter& in, const std::vector<Value>& args) { return in.builtin_sum(args); };
+    table.interpreter_functions["zip_with"] = [](Interpreter& in, const std::vector<Value>& args) { return in.builtin_zip_with(args); };
+}
+
+// map(arr, f)：[f(x) for x in arr]
+Value Interpreter::builtin_map(const std::vector<Value>& args) {
+    check_arity(*this, args, 2, 2, "map");
+    Items items(*this, args[0], "map");
+    ArrayCallback callback(*this, args[1], "map");
+    std::vector<Value> result(items.size());
+    callback.for_each(items.size(), [&](size_t i, auto call) {
+        std::vector<Value> call_args{items[i]};
+        result[i] = call(call_args);
+    });
+    return Value(std::move(result));
+}
+
+// filter(arr, f)：保留 f(x) 为真的元素
+Value Interpreter::builtin_filter(const std::vector<Value>& args) {
+    check_arity(*this, args, 2, 2, "filter");
+    Items items(*this, args[0], "filter");
+    ArrayCallback callback(*this, args[1], "filter");
+    std::vector<unsigned char> keep(items.size());
+    callback.for_each(items.size(), [&](size_t i, auto call) {
+        std::vector<Value> call_args{items[i]};
+        keep[i] = call(call_args).as_bool();
+    });
+    std::vector<Value> result;
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (keep[i]) result.push_back(items[i]);
+    }
+    return Value(std::move(result));
+}
+
+// reduce(arr, f[, init])：从左到右 acc = f(acc, x)；没有 init 时以第一个元素为初值
+Value Interpreter::builtin_reduce(const std::vector<Value>& args) {
+    check_arity(*this, args, 2, 3, "reduce");
+    Items items(*this, args[0], "reduce");
+    ArrayCallback callback(*this, args[1], "reduce");
+    bool has_init = args.size() == 3;
+    size_t n = items.size();
+    if (n == 0) {
+        if (has_init) return args[2];
+        throw builtin_error(*this, "reduce() of empty array with no initial value");
+    }
+
+    auto fold = [&](Value acc, size_t begin, size_t end, auto call) {
+        for (size_t i = begin; i < end; ++i) {
+            std::vector<Value> call_args{acc, items[i]};
+            acc = call(call_args);
+        }
+        return acc;
+    };
+
+    if (!callback.split(n)) {
+        if (has_init) return fold(args[2], 0, n, [&](std::vector<Value>& a) { return callback.call(a); });
+        return fold(items[0], 1, n, [&](std::vector<Value>& a) { return callback.call(a); });
+    }
+
+    // 各块从块内第一个元素开始归约，块结果再按顺序合并
+    size_t chunks = (n + PARALLEL_GRAIN - 1) / PARALLEL_GRAIN;
+    std::vector<Value> partial(chunks);
+    ParallelRun(*this).chunks(n, [&](size_t chunk, size_t begin, size_t end) {
+        partial[chunk] = fold(items[begin], begin + 1, end,
+                              [&](std::vector<Value>& a) { return callback.call_isolated(a); });
+    });
+    Value acc = has_init ? args[2] : partial[0];
+    for (size_t c = has_init ? 0 : 1; c < chunks; ++c) {
+        std::vector<Value> call_args{acc, partial[c]};
+        acc = callback.call(call_args);
+    }
+    return acc;
+}
+
+// sum(arr)：按 + 累加所有元素，空数组为 0；大数组总是按固定大小的块求和，结果与线程数无关
+Value Interpreter::builtin_sum(const std::vector<Value>& args) {
+    check_arity(*this, args, 1, 1, "sum");
+    Items items(*this, args[0], "sum");
+    size_t n = items.size();
+    if (n == 0) return Value(0);
+
+    auto fold = [&](Interpreter& in, size_t begin, size_t end) {
+        Value acc = items[begin];
+        for (size_t i = begin + 1; i < end; ++i) {
+            acc = in.binary_op(BinaryOp::Add, acc, items[i]);
+        }
+        return acc;
+    };
+    if (n < PARALLEL_THRESHOLD) return fold(*this, 0, n);
+
+    size_t chunks = (n + PARALLEL_GRAIN - 1) / PARALLEL_GRAIN;
+    std::vector<Value> partial(chunks);
+    ParallelRun(*this).chunks(n, [&](size_t chunk, size_t begin, size_t end) {
+        partial[chunk] = fold(worker_interpreter(), begin, end);
+    });
+    Value acc = partial[0];
+    for (size_t c = 1; c < chunks; ++c) {
+        acc = binary_op(BinaryOp::Add, acc, partial[c]);
+    }
+    return acc;
+}
+
+// zip_with(a, b, f)：[f(a[i], b[i])]，长度取两者较短者
+Value Interpreter::builtin_zip_with(const std::vector<Value>& args) {
+    check_arity(*this, args, 3, 3, "zip_with");
+    Items left(*this, args[0], "zip_with");
+    Items right(*this, args[1], "zip_with");
+    ArrayCallback callback(*this, args[2], "zip_with");
+    size_t n = std::min(left.size(), right.size());
+    std::vector<Value> result(n);
+    callback.for_each(n, [&](size_t i, auto call) {
+        std::vector<Value> call_args{left[i], right[i]};
+        result[i] = call(call_args);
+    });
+    return Value(std::move(result));
+}
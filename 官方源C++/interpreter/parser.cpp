@@ -1,19 +1,27 @@
 #include "parser.hpp"
+#include "log.hpp"
 #include <memory>
 #include <iostream>
 #include <string>
 #include <stdexcept>
 
-// Set to true to enable debug output
-static const bool PARSER_DEBUG = true;
+// 本线程当前这次解析输出的诊断条数
+static thread_local size_t diagnostic_count = 0;
 
-// Debug output macro - no output if DEBUG is false
-#define DEBUG_OUT if (PARSER_DEBUG) std::cerr
+// 解析错误与警告都经由此输出，以便统计
+static std::ostream& diagnostic() {
+    ++diagnostic_count;
+    return std::cerr;
+}
+
+size_t Parser::diagnostics() {
+    return diagnostic_count;
+}
 
-std::unique_ptr<Expression> Parser::parse_expression(const std::vector<Token>& tokens, size_t& i) {
+NodePtr<Expression> Parser::parse_expression(const std::vector<Token>& tokens, size_t& i) {
     // Safety check
     if (i >= tokens.size() || tokens[i].type == TokenType::EndOfFile) {
-        std::cerr << "Error: Attempting to parse expression at end of input" << std::endl;
+        diagnostic() << "Error: Attempting to parse expression at end of input" << std::endl;
         return nullptr;
     }
 
@@ -28,61 +36,79 @@ std::unique_ptr<Expression> Parser::parse_expression(const std::vector<Token>& t
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::parse_comparison(const std::vector<Token>& tokens, size_t& i) {
+// 运算符记号到二元运算符编码的映射
+static BinaryOp binary_op_for(TokenType type) {
+    switch (type) {
+    case TokenType::Plus: return BinaryOp::Add;
+    case TokenType::Minus: return BinaryOp::Sub;
+    case TokenType::Star: return BinaryOp::Mul;
+    case TokenType::Slash: return BinaryOp::Div;
+    case TokenType::Percent: return BinaryOp::Mod;
+    case TokenType::Caret: return BinaryOp::Pow;
+    case TokenType::Equal: return BinaryOp::Eq;
+    case TokenType::NotEqual: return BinaryOp::Ne;
+    case TokenType::Less: return BinaryOp::Lt;
+    case TokenType::LessEqual: return BinaryOp::Le;
+    case TokenType::Greater: return BinaryOp::Gt;
+    default: return BinaryOp::Ge;
+    }
+}
+
+NodePtr<Expression> Parser::parse_comparison(const std::vector<Token>& tokens, size_t& i) {
     auto left = parse_addition(tokens, i);
     while (i < tokens.size() && (tokens[i].type == TokenType::Equal || tokens[i].type == TokenType::NotEqual ||
            tokens[i].type == TokenType::Less || tokens[i].type == TokenType::LessEqual ||
            tokens[i].type == TokenType::Greater || tokens[i].type == TokenType::GreaterEqual)) {
-        std::string op = tokens[i].text;
+        BinaryOp op = binary_op_for(tokens[i].type);
         ++i;
         auto right = parse_addition(tokens, i);
-        left = std::make_unique<BinaryExpr>(op, std::move(left), std::move(right));
+        left = make_node<BinaryExpr>(op, std::move(left), std::move(right));
     }
     return left;
 }
 
-std::unique_ptr<Expression> Parser::parse_addition(const std::vector<Token>& tokens, size_t& i) {
+NodePtr<Expression> Parser::parse_addition(const std::vector<Token>& tokens, size_t& i) {
     auto left = parse_term(tokens, i);
     while (i < tokens.size() && (tokens[i].type == TokenType::Plus || tokens[i].type == TokenType::Minus)) {
-        std::string op = tokens[i].text;
+        BinaryOp op = binary_op_for(tokens[i].type);
         ++i;
         auto right = parse_term(tokens, i);
-        left = std::make_unique<BinaryExpr>(op, std::move(left), std::move(right));
+        left = make_node<BinaryExpr>(op, std::move(left), std::move(right));
     }
     return left;
 }
 
-std::unique_ptr<Expression> Parser::parse_term(const std::vector<Token>& tokens, size_t& i) {
+NodePtr<Expression> Parser::parse_term(const std::vector<Token>& tokens, size_t& i) {
     auto left = parse_power(tokens, i);
     while (i < tokens.size() && (tokens[i].type == TokenType::Star || tokens[i].type == TokenType::Slash || 
            tokens[i].type == TokenType::Percent)) {
-        std::string op = tokens[i].text;
+        BinaryOp op = binary_op_for(tokens[i].type);
         ++i;
         auto right = parse_power(tokens, i);
-        left = std::make_unique<BinaryExpr>(op, std::move(left), std::move(right));
+        left = make_node<BinaryExpr>(op, std::move(left), std::move(right));
     }
     return left;
 }
 
-std::unique_ptr<Expression> Parser::parse_power(const std::vector<Token>& tokens, size_t& i) {
+NodePtr<Expression> Parser::parse_power(const std::vector<Token>& tokens, size_t& i) {
     auto left = parse_unary(tokens, i);
     while (i < tokens.size() && tokens[i].type == TokenType::Caret) {
-        std::string op = tokens[i].text;
+        BinaryOp op = binary_op_for(tokens[i].type);
         ++i;
         auto right = parse_unary(tokens, i);
-        left = std::make_unique<BinaryExpr>(op, std::move(left), std::move(right));
+        left = make_node<BinaryExpr>(op, std::move(left), std::move(right));
     }
     return left;
 }
 
-std::unique_ptr<Expression> Parser::parse_unary(const std::vector<Token>& tokens, size_t& i) {
+NodePtr<Expression> Parser::parse_unary(const std::vector<Token>& tokens, size_t& i) {
     if (i >= tokens.size()) return nullptr;
     
     // Handle prefix unary operators
     if (tokens[i].type == TokenType::Minus) {
         ++i;
         auto operand = parse_unary(tokens, i);
-        return std::make_unique<UnaryExpr>("-", std::move(operand));
+        return make_node<UnaryExpr>(UnaryOp::Negate, std::move(operand));
     }
     
     // Parse primary expression first
@@ -91,34 +117,46 @@ std::unique_ptr<Expression> Parser::parse_unary(const std::vector<Token>& tokens
     // Handle postfix unary operators (like factorial)
     while (i < tokens.size() && tokens[i].type == TokenType::Bang) {
         ++i;  // consume '!'
-        expr = std::make_unique<UnaryExpr>("!", std::move(expr));
+        expr = make_node<UnaryExpr>(UnaryOp::Factorial, std::move(expr));
     }
     
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::parse_primary(const std::vector<Token>& tokens, size_t& i) {
+// 数字字面量：带小数点为浮点数，否则为 int，超出 int 范围时使用 BigInt
+static Value number_literal(const std::string& text) {
+    if (text.find('.') != std::string::npos) {
+        return Value(std::stod(text));
+    }
+    try {
+        return Value(static_cast<int64_t>(std::stoll(text)));
+    } catch (const std::out_of_range&) {
+        return Value(::BigInt(text));
+    }
+}
+
+NodePtr<Expression> Parser::parse_primary(const std::vector<Token>& tokens, size_t& i) {
     if (i >= tokens.size()) return nullptr;
     
-    DEBUG_OUT << "Debug - parse_primary: token[" << i << "] = '" << tokens[i].text 
-              << "' (type=" << static_cast<int>(tokens[i].type) << ")" << std::endl;
+    LAMINA_LOG(Debug, Parser, "parse_primary: token[" << i << "] = '" << tokens[i].text 
+              << "' (type=" << static_cast<int>(tokens[i].type) << ")");
       if (tokens[i].type == TokenType::Number) {
-        return std::make_unique<LiteralExpr>(tokens[i++].text);
+        return make_node<LiteralExpr>(number_literal(tokens[i++].text));
     } else if (tokens[i].type == TokenType::String) {
-        return std::make_unique<LiteralExpr>(tokens[i++].text);
+        return make_node<LiteralExpr>(Value(tokens[i++].text));
     } else if (tokens[i].type == TokenType::True) {
         ++i;
-        return std::make_unique<LiteralExpr>("true");
+        return make_node<LiteralExpr>(Value(true));
     } else if (tokens[i].type == TokenType::False) {
         ++i;
-        return std::make_unique<LiteralExpr>("false");
+        return make_node<LiteralExpr>(Value(false));
     } else if (tokens[i].type == TokenType::Null) {
         ++i;
-        return std::make_unique<LiteralExpr>("null");
+        return make_node<LiteralExpr>(Value(nullptr));
     } else if (tokens[i].type == TokenType::LBracket) {
         // Parse array literal [expr1, expr2, ...]
         ++i; // Skip '['
-        std::vector<std::unique_ptr<Expression>> elements;
+        std::vector<NodePtr<Expression>> elements;
         
         while (i < tokens.size() && tokens[i].type != TokenType::RBracket) {
             auto elem = parse_expression(tokens, i);
@@ -127,44 +165,44 @@ std::unique_ptr<Expression> Parser::parse_primary(const std::vector<Token>& toke
             if (tokens[i].type == TokenType::Comma) {
                 ++i; // Skip ','
             } else if (tokens[i].type != TokenType::RBracket) {
-                std::cerr << "Error: Expected ',' or ']' in array literal" << std::endl;
+                diagnostic() << "Error: Expected ',' or ']' in array literal" << std::endl;
                 return nullptr;
             }
         }
         
         if (i >= tokens.size() || tokens[i].type != TokenType::RBracket) {
-            std::cerr << "Error: Unterminated array literal, expected ']'" << std::endl;
+            diagnostic() << "Error: Unterminated array literal, expected ']'" << std::endl;
             return nullptr;
         }
         
         ++i; // Skip ']'
-        return std::make_unique<ArrayExpr>(std::move(elements));
+        return make_node<ArrayExpr>(std::move(elements));
     } else if (tokens[i].type == TokenType::Identifier) {
         std::string name = tokens[i].text;
-        std::cerr << "DEBUG: Found identifier '" << name << "' at token " << i << std::endl;
+        LAMINA_LOG(Trace, Parser, "Found identifier '" << name << "' at token " << i);
         ++i;
 
         // Check for dot notation (namespace.function)
         if (i < tokens.size() && tokens[i].type == TokenType::Dot) {
-            std::cerr << "DEBUG: Found dot at token " << i << std::endl;
+            LAMINA_LOG(Trace, Parser, "Found dot at token " << i);
             ++i; // Skip '.'
             if (i < tokens.size() && tokens[i].type == TokenType::Identifier) {
-                std::cerr << "DEBUG: Found second identifier '" << tokens[i].text << "' at token " << i << std::endl;
+                LAMINA_LOG(Trace, Parser, "Found second identifier '" << tokens[i].text << "' at token " << i);
                 name += "." + tokens[i].text;  // 保持点格式
                 ++i;
-                std::cerr << "DEBUG: Converted to namespace syntax: '" << name << "'" << std::endl;
+                LAMINA_LOG(Trace, Parser, "Converted to namespace syntax: '" << name << "'");
             } else {
-                std::cerr << "Error: Expected identifier after '.'" << std::endl;
+                diagnostic() << "Error: Expected identifier after '.'" << std::endl;
                 return nullptr;
             }
         } else {
-            std::cerr << "DEBUG: No dot found, next token type is " << (i < tokens.size() ? static_cast<int>(tokens[i].type) : -1) << std::endl;
+            LAMINA_LOG(Trace, Parser, "No dot found, next token type is " << (i < tokens.size() ? static_cast<int>(tokens[i].type) : -1));
         }
 
         // Function call
         if (i < tokens.size() && tokens[i].type == TokenType::LParen) {
             ++i; // Skip '('
-            std::vector<std::unique_ptr<Expression>> args;
+            std::vector<NodePtr<Expression>> args;
 
             while (i < tokens.size() && tokens[i].type != TokenType::RParen) {
                 auto arg = parse_expression(tokens, i);
@@ -173,28 +211,28 @@ std::unique_ptr<Expression> Parser::parse_primary(const std::vector<Token>& toke
                 if (tokens[i].type == TokenType::Comma) {
                     ++i; // Skip ','
                 } else if (tokens[i].type != TokenType::RParen) {
-                    std::cerr << "Error: Expected ',' or ')' in function call" << std::endl;
+                    diagnostic() << "Error: Expected ',' or ')' in function call" << std::endl;
                     return nullptr;
                 }
             }
 
             if (i >= tokens.size() || tokens[i].type != TokenType::RParen) {
-                std::cerr << "Error: Unterminated function call, expected ')'" << std::endl;
+                diagnostic() << "Error: Unterminated function call, expected ')'" << std::endl;
                 return nullptr;
             }
 
             ++i; // Skip ')'
-            return std::make_unique<CallExpr>(name, std::move(args));
+            return make_node<CallExpr>(name, std::move(args));
         }
         // 否则作为普通变量处理
-        return std::make_unique<VarExpr>(name);
+        return make_node<VarExpr>(name);
     }
     else if (tokens[i].type == TokenType::LParen) {
         ++i; // Skip '('
         auto expr = parse_expression(tokens, i);
         
         if (i >= tokens.size() || tokens[i].type != TokenType::RParen) {
-            std::cerr << "Error: Unterminated parenthesized expression, expected ')'" << std::endl;
+            diagnostic() << "Error: Unterminated parenthesized expression, expected ')'" << std::endl;
             return nullptr;
         }
         
@@ -202,39 +240,39 @@ std::unique_ptr<Expression> Parser::parse_primary(const std::vector<Token>& toke
         return expr;
     }
     
-    std::cerr << "Error: Unexpected token in expression: " << tokens[i].text << std::endl;
+    diagnostic() << "Error: Unexpected token in expression: " << tokens[i].text << std::endl;
     return nullptr;
 }
 
 // Helper function: print token context for error reporting
 static void print_context(const std::vector<Token>& tokens, size_t pos, int context_size = 5) {
-    std::cerr << "Context: ";
+    diagnostic() << "Context: ";
     size_t context_start = pos > static_cast<size_t>(context_size) ? pos - static_cast<size_t>(context_size) : 0;
     size_t context_end = std::min(pos + static_cast<size_t>(context_size), tokens.size() - 1);
     
     for (size_t j = context_start; j <= context_end; j++) {
         if (j == pos) {
-            std::cerr << "[" << tokens[j].text << "] "; // Highlight current token
+            diagnostic() << "[" << tokens[j].text << "] "; // Highlight current token
         } else {
-            std::cerr << tokens[j].text << " ";
+            diagnostic() << tokens[j].text << " ";
         }
     }
-    std::cerr << std::endl;
+    diagnostic() << std::endl;
     
     // Print line and column position indicators
-    std::cerr << "Position: ";
+    diagnostic() << "Position: ";
     for (size_t j = context_start; j <= context_end; j++) {
         if (j == pos) {
-            std::cerr << "line" << tokens[j].line << "col" << tokens[j].column << " ";
+            diagnostic() << "line" << tokens[j].line << "col" << tokens[j].column << " ";
         } else {
-            std::cerr << std::string(tokens[j].text.length() + 1, ' ');
+            diagnostic() << std::string(tokens[j].text.length() + 1, ' ');
         }
     }
-    std::cerr << std::endl;
+    diagnostic() << std::endl;
 }
 
-std::unique_ptr<BlockStmt> Parser::parse_block(const std::vector<Token>& tokens, size_t& i, bool is_global) {
-    auto block = std::make_unique<BlockStmt>();
+NodePtr<BlockStmt> Parser::parse_block(const std::vector<Token>& tokens, size_t& i, bool is_global) {
+    auto block = make_node<BlockStmt>();
     
     // Record current block start position for debugging
     int start_line = (i < tokens.size()) ? tokens[i].line : -1;
@@ -244,12 +282,11 @@ std::unique_ptr<BlockStmt> Parser::parse_block(const std::vector<Token>& tokens,
     static thread_local int current_block_depth = 0;
     current_block_depth++;
     
-    DEBUG_OUT << "Debug - Block parsing started: " 
+    LAMINA_LOG(Debug, Parser, "Block parsing started: " 
               << (is_global ? "global" : "local") 
               << ", depth=" << current_block_depth 
               << ", position=" << start_line << ":" << start_col 
-              << ", current token=" << (i < tokens.size() ? "'" + tokens[i].text + "'" : "EOF")
-              << std::endl;
+              << ", current token=" << (i < tokens.size() ? "'" + tokens[i].text + "'" : "EOF"));
     
     // Record start token position for error reporting
     size_t block_start_index = i;
@@ -258,10 +295,9 @@ std::unique_ptr<BlockStmt> Parser::parse_block(const std::vector<Token>& tokens,
         // Check if we reached end of block
         if (!is_global && tokens[i].type == TokenType::RBrace) {
             // Local block ended with } brace
-            DEBUG_OUT << "Debug - Block ended normally: depth=" << current_block_depth 
+            LAMINA_LOG(Debug, Parser, "Block ended normally: depth=" << current_block_depth 
                       << ", position=" << tokens[i].line << ":" << tokens[i].column 
-                      << ", statement_count=" << block->statements.size()
-                      << std::endl;
+                      << ", statement_count=" << block->statements.size());
             current_block_depth--;
             i++; // consume right brace
             return block;
@@ -271,33 +307,33 @@ std::unique_ptr<BlockStmt> Parser::parse_block(const std::vector<Token>& tokens,
         if (tokens[i].type == TokenType::EndOfFile) {
             if (!is_global) {
                 // Local block ended unexpectedly at EOF, provide detailed error info
-                std::cerr << "\033[31mError: Missing closing brace '}' - block started at line " << start_line 
-                          << " col " << start_col
-                          << ", not closed before end of file\033[0m" << std::endl;
+                diagnostic() << "\033[31mError: Missing closing brace '}' - block started at line " << start_line 
+                             << " col " << start_col
+                             << ", not closed before end of file\033[0m" << std::endl;
                 
                 // Output context around the block start to help locate the issue
-                std::cerr << "Block start context:" << std::endl;
+                diagnostic() << "Block start context:" << std::endl;
                 size_t context_start = block_start_index > 5 ? block_start_index - 5 : 0;
                 size_t context_end = std::min(block_start_index + 5, tokens.size() - 1);
                 for (size_t j = context_start; j <= context_end; j++) {
                     if (j == block_start_index) {
-                        std::cerr << "[" << tokens[j].text << "] ";
+                        diagnostic() << "[" << tokens[j].text << "] ";
                     } else {
-                        std::cerr << tokens[j].text << " ";
+                        diagnostic() << tokens[j].text << " ";
                     }
                 }
-                std::cerr << std::endl;
+                diagnostic() << std::endl;
                 
                 // Show block content summary
-                std::cerr << "Block contains " << block->statements.size() << " statements" << std::endl;
+                diagnostic() << "Block contains " << block->statements.size() << " statements" << std::endl;
                 
                 current_block_depth--;
                 // Throw exception instead of direct exit, let caller recover
                 throw std::runtime_error("Parse error: Unclosed block, missing closing brace");
             } else {
                 // Global block reached EOF, normal termination
-                DEBUG_OUT << "Debug - Global block ended at EOF: depth=" << current_block_depth 
-                          << ", statements=" << block->statements.size() << std::endl;
+                LAMINA_LOG(Debug, Parser, "Global block ended at EOF: depth=" << current_block_depth 
+                          << ", statements=" << block->statements.size());
                 current_block_depth--;
                 return block;
             }
@@ -309,11 +345,11 @@ std::unique_ptr<BlockStmt> Parser::parse_block(const std::vector<Token>& tokens,
             block->statements.push_back(std::move(stmt));
         } else if (i < tokens.size() && tokens[i].type != TokenType::EndOfFile) {
             // Only report error if not at end of file and parsing failed
-            std::cerr << "\033[31mError: Invalid or unexpected statement at token " << i 
-                      << " (line " << tokens[i].line 
-                      << " col " << tokens[i].column 
-                      << "): " 
-                      << tokens[i].text << "\033[0m" << std::endl;
+            diagnostic() << "\033[31mError: Invalid or unexpected statement at token " << i 
+                         << " (line " << tokens[i].line 
+                         << " col " << tokens[i].column 
+                         << "): " 
+                         << tokens[i].text << "\033[0m" << std::endl;
                       
             // Try to recover: skip current token and continue parsing
             i++;
@@ -321,7 +357,7 @@ std::unique_ptr<BlockStmt> Parser::parse_block(const std::vector<Token>& tokens,
         } else {
             // Reached end of file, should be global block at this point
             if (!is_global) {
-                std::cerr << "\033[31mError: Unexpected end of file, missing block closure, started at line " << start_line << "\033[0m" << std::endl;
+                diagnostic() << "\033[31mError: Unexpected end of file, missing block closure, started at line " << start_line << "\033[0m" << std::endl;
                 current_block_depth--;
                 throw std::runtime_error("Parse error: Unclosed block, missing closing brace");
             }
@@ -331,7 +367,7 @@ std::unique_ptr<BlockStmt> Parser::parse_block(const std::vector<Token>& tokens,
         // Check progress to avoid infinite loops
         if (i >= tokens.size()) {
             if (!is_global) {
-                std::cerr << "\033[31mError: Unexpected end of file, missing block closure, started at line " << start_line << "\033[0m" << std::endl;
+                diagnostic() << "\033[31mError: Unexpected end of file, missing block closure, started at line " << start_line << "\033[0m" << std::endl;
                 current_block_depth--;
                 throw std::runtime_error("Parse error: Unclosed block, missing closing brace");
             }
@@ -339,8 +375,8 @@ std::unique_ptr<BlockStmt> Parser::parse_block(const std::vector<Token>& tokens,
         }
     }
     
-    DEBUG_OUT << "Debug - Block parsing completed: depth=" << current_block_depth 
-              << ", statements=" << block->statements.size() << std::endl;
+    LAMINA_LOG(Debug, Parser, "Block parsing completed: depth=" << current_block_depth 
+              << ", statements=" << block->statements.size());
     
     // Ensure depth count is reduced before returning
     current_block_depth--;
@@ -348,26 +384,26 @@ std::unique_ptr<BlockStmt> Parser::parse_block(const std::vector<Token>& tokens,
 }
 
 // 2参数重载，兼容老代码
-std::unique_ptr<BlockStmt> Parser::parse_block(const std::vector<Token>& tokens, size_t& i) {
+NodePtr<BlockStmt> Parser::parse_block(const std::vector<Token>& tokens, size_t& i) {
     return parse_block(tokens, i, false);
 }
 
-std::unique_ptr<Statement> Parser::parse_while(const std::vector<Token>& tokens, size_t& i) {
+NodePtr<Statement> Parser::parse_while(const std::vector<Token>& tokens, size_t& i) {
     if (!(i < tokens.size() && tokens[i].type == TokenType::While)) {
         return nullptr;
     }
     
-    int while_line = tokens[i].line;
-    int while_col = tokens[i].column;
+    [[maybe_unused]] int while_line = tokens[i].line;
+    [[maybe_unused]] int while_col = tokens[i].column;
     size_t while_start_index = i; // Record while statement start position
     
-    DEBUG_OUT << "Debug - Starting while loop parsing, line " << while_line << " col " << while_col << std::endl;
+    LAMINA_LOG(Debug, Parser, "Starting while loop parsing, line " << while_line << " col " << while_col);
     
     ++i; // Skip 'while'
     
     // Check for opening parenthesis
     if (i >= tokens.size() || tokens[i].type != TokenType::LParen) {
-        std::cerr << "\033[31mError: Missing opening parenthesis '(' after while statement\033[0m" << std::endl;
+        diagnostic() << "\033[31mError: Missing opening parenthesis '(' after while statement\033[0m" << std::endl;
         print_context(tokens, i > 0 ? i - 1 : 0);
         
         // Try to recover: look for opening parenthesis or opening brace
@@ -386,18 +422,18 @@ std::unique_ptr<Statement> Parser::parse_while(const std::vector<Token>& tokens,
     
     // Parse condition
     if (i >= tokens.size()) {
-        std::cerr << "\033[31mError: while statement ended unexpectedly, missing condition expression\033[0m" << std::endl;
+        diagnostic() << "\033[31mError: while statement ended unexpectedly, missing condition expression\033[0m" << std::endl;
         print_context(tokens, while_start_index);
         return nullptr;
     }
     
     auto cond = parse_expression(tokens, i);
     if (!cond) {
-        std::cerr << "\033[31mError: while statement missing valid condition expression\033[0m" << std::endl;
+        diagnostic() << "\033[31mError: while statement missing valid condition expression\033[0m" << std::endl;
         print_context(tokens, i);
         
         // Try to recover: create a condition that's always true
-        cond = std::make_unique<LiteralExpr>("true");
+        cond = make_node<LiteralExpr>(Value(true));
         
         // Try to find right parenthesis
         while (i < tokens.size() && tokens[i].type != TokenType::RParen) {
@@ -411,7 +447,7 @@ std::unique_ptr<Statement> Parser::parse_while(const std::vector<Token>& tokens,
     
     // Check for closing parenthesis
     if (i >= tokens.size()) {
-        std::cerr << "\033[31mError: while statement condition ended unexpectedly, missing closing parenthesis\033[0m" << std::endl;
+        diagnostic() << "\033[31mError: while statement condition ended unexpectedly, missing closing parenthesis\033[0m" << std::endl;
         print_context(tokens, while_start_index);
         return nullptr;
     }
@@ -419,7 +455,7 @@ std::unique_ptr<Statement> Parser::parse_while(const std::vector<Token>& tokens,
     if (tokens[i].type == TokenType::RParen) {
         ++i; // Consume closing parenthesis
     } else {
-        std::cerr << "\033[31mError: while statement condition missing closing parenthesis ')', after line " << tokens[i-1].line << "\033[0m" << std::endl;
+        diagnostic() << "\033[31mError: while statement condition missing closing parenthesis ')', after line " << tokens[i-1].line << "\033[0m" << std::endl;
         print_context(tokens, i);
         
         // Try to recover: look for opening brace
@@ -434,7 +470,7 @@ std::unique_ptr<Statement> Parser::parse_while(const std::vector<Token>& tokens,
     
     // Check for opening brace
     if (i >= tokens.size()) {
-        std::cerr << "\033[31mError: while statement ended unexpectedly after closing parenthesis, missing loop body\033[0m" << std::endl;
+        diagnostic() << "\033[31mError: while statement ended unexpectedly after closing parenthesis, missing loop body\033[0m" << std::endl;
         print_context(tokens, while_start_index);
         return nullptr;
     }
@@ -442,25 +478,25 @@ std::unique_ptr<Statement> Parser::parse_while(const std::vector<Token>& tokens,
     if (tokens[i].type == TokenType::LBrace) {
         ++i; // Consume opening brace
     } else {
-        std::cerr << "\033[31mError: while statement missing opening brace '{'\033[0m" << std::endl;
+        diagnostic() << "\033[31mError: while statement missing opening brace '{'\033[0m" << std::endl;
         print_context(tokens, i);
         
         // Try to recover: create an empty block and return
-        auto emptyBody = std::make_unique<BlockStmt>();
-        return std::make_unique<WhileStmt>(std::move(cond), std::move(emptyBody));
+        auto emptyBody = make_node<BlockStmt>();
+        return make_node<WhileStmt>(std::move(cond), std::move(emptyBody));
     }
     
     // Parse loop body
-    DEBUG_OUT << "Debug - Parsing while loop body" << std::endl;
-    std::unique_ptr<BlockStmt> body;
+    LAMINA_LOG(Debug, Parser, "Parsing while loop body");
+    NodePtr<BlockStmt> body;
     
     try {
         body = parse_block(tokens, i, false);
-        DEBUG_OUT << "Debug - while loop body parsing completed, contains " << body->statements.size() << " statements" << std::endl;
+        LAMINA_LOG(Debug, Parser, "while loop body parsing completed, contains " << body->statements.size() << " statements");
     } catch (const std::exception& e) {
-        std::cerr << "Error: Error parsing while loop body: " << e.what() << std::endl;
+        diagnostic() << "Error: Error parsing while loop body: " << e.what() << std::endl;
         // Create empty block as recovery measure
-        body = std::make_unique<BlockStmt>();
+        body = make_node<BlockStmt>();
         
         // Try to locate next statement start
         while (i < tokens.size() && 
@@ -474,28 +510,81 @@ std::unique_ptr<Statement> Parser::parse_while(const std::vector<Token>& tokens,
         }
     }
     
-    DEBUG_OUT << "Debug - while loop parsing completed, defined at line " << while_line 
-              << ", ended at line " << (i < tokens.size() ? tokens[i-1].line : -1) << std::endl;
+    LAMINA_LOG(Debug, Parser, "while loop parsing completed, defined at line " << while_line 
+              << ", ended at line " << (i < tokens.size() ? tokens[i-1].line : -1));
     
-    return std::make_unique<WhileStmt>(std::move(cond), std::move(body));
+    return make_node<WhileStmt>(std::move(cond), std::move(body));
 }
 
-std::unique_ptr<Statement> Parser::parse_statement(const std::vector<Token>& tokens, size_t& i) {
-    std::cerr << "DEBUG: parse_statement starting at token " << i << std::endl;
+// for 循环：for i in a..b { ... } 或 for x in arr { ... }，循环头可以用括号括起
+NodePtr<Statement> Parser::parse_for(const std::vector<Token>& tokens, size_t& i) {
+    size_t for_start_index = i;
+    ++i; // Skip 'for'
+
+    bool parenthesized = i < tokens.size() && tokens[i].type == TokenType::LParen;
+    if (parenthesized) ++i;
+
+    if (i + 1 >= tokens.size() || tokens[i].type != TokenType::Identifier || tokens[i+1].type != TokenType::In) {
+        diagnostic() << "\033[31mError: for statement expects 'for <name> in <range or array>'\033[0m" << std::endl;
+        print_context(tokens, i < tokens.size() ? i : for_start_index);
+        return nullptr;
+    }
+    std::string name = tokens[i].text;
+    i += 2;
+
+    auto start = parse_expression(tokens, i);
+    if (!start) {
+        diagnostic() << "\033[31mError: for statement missing range or array expression\033[0m" << std::endl;
+        print_context(tokens, i < tokens.size() ? i : for_start_index);
+        return nullptr;
+    }
+    NodePtr<Expression> end;
+    if (i < tokens.size() && tokens[i].type == TokenType::DotDot) {
+        ++i;
+        end = parse_expression(tokens, i);
+        if (!end) {
+            diagnostic() << "\033[31mError: for statement missing range end after '..'\033[0m" << std::endl;
+            print_context(tokens, i < tokens.size() ? i : for_start_index);
+            return nullptr;
+        }
+    }
+
+    if (parenthesized) {
+        if (i >= tokens.size() || tokens[i].type != TokenType::RParen) {
+            diagnostic() << "\033[31mError: for statement missing closing parenthesis ')'\033[0m" << std::endl;
+            print_context(tokens, i < tokens.size() ? i : for_start_index);
+            return nullptr;
+        }
+        ++i;
+    }
+
+    if (i >= tokens.size() || tokens[i].type != TokenType::LBrace) {
+        diagnostic() << "\033[31mError: for statement missing opening brace '{'\033[0m" << std::endl;
+        print_context(tokens, i < tokens.size() ? i : for_start_index);
+        return nullptr;
+    }
+    ++i; // Consume opening brace
+
+    auto body = parse_block(tokens, i, false);
+    return make_node<ForStmt>(name, std::move(start), std::move(end), std::move(body));
+}
+
+NodePtr<Statement> Parser::parse_statement(const std::vector<Token>& tokens, size_t& i) {
+    LAMINA_LOG(Trace, Parser, "parse_statement starting at token " << i);
     // Handle include statements first - only support quoted strings
     if (tokens[i].type == TokenType::Include && i+1 < tokens.size()) {
         if (tokens[i+1].type != TokenType::String) {
-            std::cerr << "Error: Include statement requires a quoted string (e.g., include \"filename\";)" << std::endl;
+            diagnostic() << "Error: Include statement requires a quoted string (e.g., include \"filename\";)" << std::endl;
             return nullptr;
         }
         std::string mod = tokens[i+1].text;
         i += 2;
         if (i >= tokens.size() || tokens[i].type != TokenType::Semicolon) {
-            std::cerr << "Error: Missing semicolon ';' after include statement" << std::endl;
+            diagnostic() << "Error: Missing semicolon ';' after include statement" << std::endl;
             return nullptr;
         }
         ++i;
-        return std::make_unique<IncludeStmt>(mod);
+        return make_node<IncludeStmt>(mod);
     }
     
     // Handle function definitions next, before other statement types
@@ -503,8 +592,8 @@ std::unique_ptr<Statement> Parser::parse_statement(const std::vector<Token>& tok
         tokens[i+1].type == TokenType::Identifier && tokens[i+2].type == TokenType::LParen) {
         std::string name = tokens[i+1].text;
         int func_line = tokens[i].line;
-        int func_col = tokens[i].column;
-        DEBUG_OUT << "Debug - Starting function parsing: " << name << " at line " << func_line << " col " << func_col << std::endl;
+        [[maybe_unused]] int func_col = tokens[i].column;
+        LAMINA_LOG(Debug, Parser, "Starting function parsing: " << name << " at line " << func_line << " col " << func_col);
         
         size_t func_start_index = i; // Record function start position for error reporting
         i += 3; // Skip 'func name('
@@ -518,8 +607,8 @@ std::unique_ptr<Statement> Parser::parse_statement(const std::vector<Token>& tok
                 if (i < tokens.size() && tokens[i].type == TokenType::Comma) {
                     ++i;
                 } else if (i < tokens.size() && tokens[i].type != TokenType::RParen) {
-                    std::cerr << "\033[31mError: Function '" << name << "' parameter list missing comma, found: " 
-                              << tokens[i].text << " at line " << tokens[i].line << "\033[0m" << std::endl;
+                    diagnostic() << "\033[31mError: Function '" << name << "' parameter list missing comma, found: " 
+                                 << tokens[i].text << " at line " << tokens[i].line << "\033[0m" << std::endl;
                     // Try to recover: look for closing parenthesis or comma
                     while (i < tokens.size() && 
                           tokens[i].type != TokenType::RParen && 
@@ -531,8 +620,8 @@ std::unique_ptr<Statement> Parser::parse_statement(const std::vector<Token>& tok
                     }
                 }
             } else {
-                std::cerr << "\033[31mError: Function '" << name << "' parameter list has invalid token: " 
-                          << tokens[i].text << " at line " << tokens[i].line << "\033[0m" << std::endl;
+                diagnostic() << "\033[31mError: Function '" << name << "' parameter list has invalid token: " 
+                             << tokens[i].text << " at line " << tokens[i].line << "\033[0m" << std::endl;
                 
                 // Try to recover: look for next comma or closing parenthesis
                 while (i < tokens.size() && 
@@ -547,7 +636,7 @@ std::unique_ptr<Statement> Parser::parse_statement(const std::vector<Token>& tok
         }
         
         if (i >= tokens.size()) {
-            std::cerr << "\033[31mError: Function '" << name << "' ended unexpectedly while parsing parameters, started at line " << func_line << "\033[0m" << std::endl;
+            diagnostic() << "\033[31mError: Function '" << name << "' ended unexpectedly while parsing parameters, started at line " << func_line << "\033[0m" << std::endl;
             // Output context around function start
             print_context(tokens, func_start_index);
             return nullptr;
@@ -556,7 +645,7 @@ std::unique_ptr<Statement> Parser::parse_statement(const std::vector<Token>& tok
         if (tokens[i].type == TokenType::RParen) {
             ++i; // Consume closing parenthesis
         } else {
-            std::cerr << "\033[31mError: Function '" << name << "' parameter list missing closing parenthesis, after line " << tokens[i-1].line << " col " << tokens[i-1].column << "\033[0m" << std::endl;
+            diagnostic() << "\033[31mError: Function '" << name << "' parameter list missing closing parenthesis, after line " << tokens[i-1].line << " col " << tokens[i-1].column << "\033[0m" << std::endl;
             print_context(tokens, i);
             // Try to recover: look for opening brace
             while (i < tokens.size() && tokens[i].type != TokenType::LBrace) {
@@ -568,15 +657,15 @@ std::unique_ptr<Statement> Parser::parse_statement(const std::vector<Token>& tok
         }
         
         if (i >= tokens.size()) {
-            std::cerr << "\033[31mError: Function '" << name << "' ended unexpectedly after closing parenthesis\033[0m" << std::endl;
+            diagnostic() << "\033[31mError: Function '" << name << "' ended unexpectedly after closing parenthesis\033[0m" << std::endl;
             return nullptr;
         }
         
         if (tokens[i].type == TokenType::LBrace) {
             ++i; // Consume opening brace
-            DEBUG_OUT << "Debug - Starting function '" << name << "' body parsing, line " << tokens[i-1].line << " col " << tokens[i-1].column << std::endl;
+            LAMINA_LOG(Debug, Parser, "Starting function '" << name << "' body parsing, line " << tokens[i-1].line << " col " << tokens[i-1].column);
         } else {
-            std::cerr << "\033[31mError: Function '" << name << "' definition missing opening brace '{', after line " << tokens[i-1].line << "\033[0m" << std::endl;
+            diagnostic() << "\033[31mError: Function '" << name << "' definition missing opening brace '{', after line " << tokens[i-1].line << "\033[0m" << std::endl;
             print_context(tokens, i);
             return nullptr;
         }
@@ -585,13 +674,15 @@ std::unique_ptr<Statement> Parser::parse_statement(const std::vector<Token>& tok
         try {
             auto body = parse_block(tokens, i, false);
             
-            DEBUG_OUT << "Debug - Function '" << name << "' body parsing completed" << std::endl;
+            LAMINA_LOG(Debug, Parser, "Function '" << name << "' body parsing completed");
             
             // Note: parse_block now handles the closing brace, so no need to check again
-            return std::make_unique<FuncDefStmt>(name, params, std::move(body));
+            auto func = make_node<FuncDefStmt>(name, params, std::move(body));
+            func->line = func_line;
+            return func;
         }
         catch (const std::exception& e) {
-            std::cerr << "\033[31mError: Error parsing function '" << name << "' body: " << e.what() << "\033[0m" << std::endl;
+            diagnostic() << "\033[31mError: Error parsing function '" << name << "' body: " << e.what() << "\033[0m" << std::endl;
             // Try to recover: look for closing brace or function definition end marker
             while (i < tokens.size() && tokens[i].type != TokenType::RBrace) {
                 ++i;
@@ -608,117 +699,121 @@ std::unique_ptr<Statement> Parser::parse_statement(const std::vector<Token>& tok
         return parse_while(tokens, i);
     }
 
+    if (tokens[i].type == TokenType::For) {
+        return parse_for(tokens, i);
+    }
+
     if (tokens[i].type == TokenType::Define && i+2 < tokens.size() && 
         tokens[i+1].type == TokenType::Identifier) {
         std::string name = tokens[i+1].text;
         i += 2;
         auto expr = parse_expression(tokens, i);
         if (!expr) {
-            std::cerr << "Error: Missing expression in define statement for '" << name << "'" << std::endl;
+            diagnostic() << "Error: Missing expression in define statement for '" << name << "'" << std::endl;
             return nullptr;
         }
         if (i >= tokens.size() || tokens[i].type != TokenType::Semicolon) {
-            std::cerr << "Error: Missing semicolon ';' after define statement" << std::endl;
+            diagnostic() << "Error: Missing semicolon ';' after define statement" << std::endl;
             return nullptr;
         }
         ++i;
-        return std::make_unique<DefineStmt>(name, std::move(expr));
+        return make_node<DefineStmt>(name, std::move(expr));
     } else if (tokens[i].type == TokenType::Bigint && i+1 < tokens.size() && 
                tokens[i+1].type == TokenType::Identifier) {
         std::string name = tokens[i+1].text;
         i += 2;
-        std::unique_ptr<Expression> init_value = nullptr;
+        NodePtr<Expression> init_value = nullptr;
         if (i < tokens.size() && tokens[i].type == TokenType::Assign) {
             ++i;
             init_value = parse_expression(tokens, i);
             if (!init_value) {
-                std::cerr << "Error: Missing expression in bigint declaration for '" << name << "'" << std::endl;
+                diagnostic() << "Error: Missing expression in bigint declaration for '" << name << "'" << std::endl;
                 return nullptr;
             }
         }
         if (i >= tokens.size() || tokens[i].type != TokenType::Semicolon) {
-            std::cerr << "Error: Missing semicolon ';' after bigint declaration" << std::endl;
+            diagnostic() << "Error: Missing semicolon ';' after bigint declaration" << std::endl;
             return nullptr;
         }
         ++i;
-        return std::make_unique<BigIntDeclStmt>(name, std::move(init_value));
+        return make_node<BigIntDeclStmt>(name, std::move(init_value));
     } else if (tokens[i].type == TokenType::Var && tokens[i+1].type == TokenType::Identifier && tokens[i+2].type == TokenType::Assign) {
         std::string name = tokens[i+1].text;
-        DEBUG_OUT << "Debug - Parsing variable declaration: " << name << std::endl;
+        LAMINA_LOG(Debug, Parser, "Parsing variable declaration: " << name);
         i += 3;
-        DEBUG_OUT << "Debug - About to parse expression for variable " << name << std::endl;
+        LAMINA_LOG(Debug, Parser, "About to parse expression for variable " << name);
         auto expr = parse_expression(tokens, i);
-        DEBUG_OUT << "Debug - Expression parsing result: " << (expr ? "success" : "failed") << std::endl;
+        LAMINA_LOG(Debug, Parser, "Expression parsing result: " << (expr ? "success" : "failed"));
         if (!expr) {
-            std::cerr << "Error: Missing expression in variable declaration for '" << name << "'" << std::endl;
+            diagnostic() << "Error: Missing expression in variable declaration for '" << name << "'" << std::endl;
             return nullptr;
         }
         if (i >= tokens.size() || tokens[i].type != TokenType::Semicolon) {
-            std::cerr << "Error: Missing semicolon ';' after variable declaration" << std::endl;
+            diagnostic() << "Error: Missing semicolon ';' after variable declaration" << std::endl;
             return nullptr;
         }
         ++i;
-        return std::make_unique<VarDeclStmt>(name, std::move(expr));
+        return make_node<VarDeclStmt>(name, std::move(expr));
     } else if (tokens[i].type == TokenType::Identifier && tokens[i+1].type == TokenType::Assign) {
         std::string name = tokens[i].text;
         i += 2;
         auto expr = parse_expression(tokens, i);
         if (!expr) {
-            std::cerr << "Error: Missing expression in assignment to '" << name << "'" << std::endl;
+            diagnostic() << "Error: Missing expression in assignment to '" << name << "'" << std::endl;
             return nullptr;
         }
         if (i >= tokens.size() || tokens[i].type != TokenType::Semicolon) {
-            std::cerr << "Error: Missing semicolon ';' after assignment" << std::endl;
+            diagnostic() << "Error: Missing semicolon ';' after assignment" << std::endl;
             return nullptr;
         }
         ++i;
-        return std::make_unique<AssignStmt>(name, std::move(expr));
+        return make_node<AssignStmt>(name, std::move(expr));
 
     } else if (tokens[i].type == TokenType::Return) {
         ++i;
         auto expr = parse_expression(tokens, i);
         if (!expr) {
-            std::cerr << "Error: Missing expression in return statement" << std::endl;
+            diagnostic() << "Error: Missing expression in return statement" << std::endl;
             return nullptr;
         }
         if (i >= tokens.size() || tokens[i].type != TokenType::Semicolon) {
-            std::cerr << "Error: Missing semicolon ';' after return statement" << std::endl;
+            diagnostic() << "Error: Missing semicolon ';' after return statement" << std::endl;
             return nullptr;
         }
         ++i;
-        return std::make_unique<ReturnStmt>(std::move(expr));
+        return make_node<ReturnStmt>(std::move(expr));
     } else if (tokens[i].type == TokenType::Break) {
         ++i;
         if (i >= tokens.size() || tokens[i].type != TokenType::Semicolon) {
-            std::cerr << "Error: Missing semicolon ';' after break statement" << std::endl;
+            diagnostic() << "Error: Missing semicolon ';' after break statement" << std::endl;
             return nullptr;
         }
         ++i;
-        return std::make_unique<BreakStmt>();
+        return make_node<BreakStmt>();
     } else if (tokens[i].type == TokenType::Continue) {
         ++i;
         if (i >= tokens.size() || tokens[i].type != TokenType::Semicolon) {
-            std::cerr << "Error: Missing semicolon ';' after continue statement" << std::endl;
+            diagnostic() << "Error: Missing semicolon ';' after continue statement" << std::endl;
             return nullptr;
         }
         ++i;
-        return std::make_unique<ContinueStmt>();
+        return make_node<ContinueStmt>();
     } else if (tokens[i].type == TokenType::Semicolon) {
         ++i; // Empty statement
         return nullptr;
     } else if (tokens[i].type == TokenType::If && i+1 < tokens.size()) {
         // if statement
-        int if_line = tokens[i].line;
-        int if_col = tokens[i].column;
+        [[maybe_unused]] int if_line = tokens[i].line;
+        [[maybe_unused]] int if_col = tokens[i].column;
         size_t if_start_index = i; // Record if statement start position
         
-        DEBUG_OUT << "Debug - Starting if statement parsing, line " << if_line << " column " << if_col << std::endl;
+        LAMINA_LOG(Debug, Parser, "Starting if statement parsing, line " << if_line << " column " << if_col);
         
         ++i; // Skip 'if'
         
         // Check for left parenthesis
         if (i >= tokens.size() || tokens[i].type != TokenType::LParen) {
-            std::cerr << "Error: Missing left parenthesis '(' after if statement" << std::endl;
+            diagnostic() << "Error: Missing left parenthesis '(' after if statement" << std::endl;
             print_context(tokens, i > 0 ? i - 1 : 0);
             
             // Try to recover: look for left parenthesis or left brace
@@ -737,14 +832,14 @@ std::unique_ptr<Statement> Parser::parse_statement(const std::vector<Token>& tok
         
         // Parse condition
         if (i >= tokens.size()) {
-            std::cerr << "Error: if statement ended unexpectedly, missing condition expression" << std::endl;
+            diagnostic() << "Error: if statement ended unexpectedly, missing condition expression" << std::endl;
             print_context(tokens, if_start_index);
             return nullptr;
         }
         
         auto cond = parse_expression(tokens, i);
         if (!cond) {
-            std::cerr << "Error: if statement missing valid condition expression" << std::endl;
+            diagnostic() << "Error: if statement missing valid condition expression" << std::endl;
             print_context(tokens, i);
             
             // Try to recover: look for right parenthesis
@@ -759,7 +854,7 @@ std::unique_ptr<Statement> Parser::parse_statement(const std::vector<Token>& tok
         
         // Check right parenthesis
         if (i >= tokens.size()) {
-            std::cerr << "Error: if statement condition ended unexpectedly, missing right parenthesis" << std::endl;
+            diagnostic() << "Error: if statement condition ended unexpectedly, missing right parenthesis" << std::endl;
             print_context(tokens, if_start_index);
             return nullptr;
         }
@@ -767,7 +862,7 @@ std::unique_ptr<Statement> Parser::parse_statement(const std::vector<Token>& tok
         if (tokens[i].type == TokenType::RParen) {
             ++i; // Consume right parenthesis
         } else {
-            std::cerr << "Error: if statement condition missing right parenthesis ')', after line " << tokens[i-1].line << std::endl;
+            diagnostic() << "Error: if statement condition missing right parenthesis ')', after line " << tokens[i-1].line << std::endl;
             print_context(tokens, i);
             
             // Try to recover: look for left brace
@@ -782,7 +877,7 @@ std::unique_ptr<Statement> Parser::parse_statement(const std::vector<Token>& tok
         
         // Check left brace
         if (i >= tokens.size()) {
-            std::cerr << "Error: if statement ended unexpectedly after right parenthesis, missing body" << std::endl;
+            diagnostic() << "Error: if statement ended unexpectedly after right parenthesis, missing body" << std::endl;
             print_context(tokens, if_start_index);
             return nullptr;
         }
@@ -790,25 +885,25 @@ std::unique_ptr<Statement> Parser::parse_statement(const std::vector<Token>& tok
         if (tokens[i].type == TokenType::LBrace) {
             ++i; // Consume left brace
         } else {
-            std::cerr << "Error: if statement missing left brace '{'" << std::endl;
+            diagnostic() << "Error: if statement missing left brace '{'" << std::endl;
             print_context(tokens, i);
             
             // Try to recover: create an empty block and return
-            auto emptyThenBlock = std::make_unique<BlockStmt>();
-            return std::make_unique<IfStmt>(std::move(cond), std::move(emptyThenBlock), nullptr);
+            auto emptyThenBlock = make_node<BlockStmt>();
+            return make_node<IfStmt>(std::move(cond), std::move(emptyThenBlock), nullptr);
         }
         
         // Parse then block
-        DEBUG_OUT << "Debug - Parsing if then block" << std::endl;
-        std::unique_ptr<BlockStmt> thenBlock;
+        LAMINA_LOG(Debug, Parser, "Parsing if then block");
+        NodePtr<BlockStmt> thenBlock;
         
         try {
             thenBlock = parse_block(tokens, i, false);
-            DEBUG_OUT << "Debug - if then block parsing completed, contains " << thenBlock->statements.size() << " statements" << std::endl;
+            LAMINA_LOG(Debug, Parser, "if then block parsing completed, contains " << thenBlock->statements.size() << " statements");
         } catch (const std::exception& e) {
-            std::cerr << "Error: Error parsing if then block: " << e.what() << std::endl;
+            diagnostic() << "Error: Error parsing if then block: " << e.what() << std::endl;
             // Create empty block as recovery measure
-            thenBlock = std::make_unique<BlockStmt>();
+            thenBlock = make_node<BlockStmt>();
             
             // Try to locate else keyword or next statement
             while (i < tokens.size() && 
@@ -819,34 +914,34 @@ std::unique_ptr<Statement> Parser::parse_statement(const std::vector<Token>& tok
             }
             
             if (i >= tokens.size()) {
-                return std::make_unique<IfStmt>(std::move(cond), std::move(thenBlock), nullptr);
+                return make_node<IfStmt>(std::move(cond), std::move(thenBlock), nullptr);
             }
         }
         
         // Check for else block
-        std::unique_ptr<BlockStmt> elseBlock;
+        NodePtr<BlockStmt> elseBlock;
         if (i < tokens.size() && tokens[i].type == TokenType::Else) {
-            int else_line = tokens[i].line;
+            [[maybe_unused]] int else_line = tokens[i].line;
             ++i; // Consume else keyword
-            DEBUG_OUT << "Debug - Starting else block parsing, line " << else_line << std::endl;
+            LAMINA_LOG(Debug, Parser, "Starting else block parsing, line " << else_line);
             
             if (i >= tokens.size()) {
-                std::cerr << "Error: else keyword ended unexpectedly" << std::endl;
-                return std::make_unique<IfStmt>(std::move(cond), std::move(thenBlock), nullptr);
+                diagnostic() << "Error: else keyword ended unexpectedly" << std::endl;
+                return make_node<IfStmt>(std::move(cond), std::move(thenBlock), nullptr);
             }
             
             // Check if it's else if
             if (tokens[i].type == TokenType::If) {
-                DEBUG_OUT << "Debug - Detected else if, parsing recursively" << std::endl;
+                LAMINA_LOG(Debug, Parser, "Detected else if, parsing recursively");
                 // Recursively parse else if as a new if statement
                 auto nestedIf = parse_statement(tokens, i);
                 if (nestedIf) {
-                    elseBlock = std::make_unique<BlockStmt>();
+                    elseBlock = make_node<BlockStmt>();
                     elseBlock->statements.push_back(std::move(nestedIf));
-                    DEBUG_OUT << "Debug - else if parsing completed" << std::endl;
+                    LAMINA_LOG(Debug, Parser, "else if parsing completed");
                 } else {
-                    std::cerr << "Error: else if parsing failed" << std::endl;
-                    return std::make_unique<IfStmt>(std::move(cond), std::move(thenBlock), nullptr);
+                    diagnostic() << "Error: else if parsing failed" << std::endl;
+                    return make_node<IfStmt>(std::move(cond), std::move(thenBlock), nullptr);
                 }
             } else if (tokens[i].type == TokenType::LBrace) {
                 // Regular else block
@@ -855,92 +950,105 @@ std::unique_ptr<Statement> Parser::parse_statement(const std::vector<Token>& tok
                 // Parse else block
                 try {
                     elseBlock = parse_block(tokens, i, false);
-                    DEBUG_OUT << "Debug - else block parsing completed, contains " << elseBlock->statements.size() << " statements" << std::endl;
+                    LAMINA_LOG(Debug, Parser, "else block parsing completed, contains " << elseBlock->statements.size() << " statements");
                 } catch (const std::exception& e) {
-                    std::cerr << "Error: Error parsing else block: " << e.what() << std::endl;
+                    diagnostic() << "Error: Error parsing else block: " << e.what() << std::endl;
                     // Create empty block as recovery measure
-                    elseBlock = std::make_unique<BlockStmt>();
+                    elseBlock = make_node<BlockStmt>();
                 }
             } else {
-                std::cerr << "Error: else block missing left brace '{'" << std::endl;
+                diagnostic() << "Error: else block missing left brace '{'" << std::endl;
                 print_context(tokens, i);
                 
                 // Return if statement without else block
-                return std::make_unique<IfStmt>(std::move(cond), std::move(thenBlock), nullptr);
+                return make_node<IfStmt>(std::move(cond), std::move(thenBlock), nullptr);
             }
         }
         
-        DEBUG_OUT << "Debug - if statement parsing completed, defined at line " << if_line 
-                  << ", ended at line " << (i < tokens.size() ? tokens[i-1].line : -1) << std::endl;
+        LAMINA_LOG(Debug, Parser, "if statement parsing completed, defined at line " << if_line 
+                  << ", ended at line " << (i < tokens.size() ? tokens[i-1].line : -1));
                   
-        return std::make_unique<IfStmt>(std::move(cond), std::move(thenBlock), std::move(elseBlock));
+        return make_node<IfStmt>(std::move(cond), std::move(thenBlock), std::move(elseBlock));
     } else {
         // Expression statement (including function calls)
         if (i < tokens.size() && tokens[i].type != TokenType::EndOfFile) {
             auto expr = parse_expression(tokens, i);
             if (i >= tokens.size() || tokens[i].type != TokenType::Semicolon) {
-                std::cerr << "Error: Missing semicolon ';' after expression statement" << std::endl;
+                diagnostic() << "Error: Missing semicolon ';' after expression statement" << std::endl;
                 return nullptr;
             }
             ++i;
-            if (expr) return std::make_unique<ExprStmt>(std::move(expr));
+            if (expr) return make_node<ExprStmt>(std::move(expr));
         }
     }
     
     // Add more detailed debug output and error handling at the end
     if (i < tokens.size()) {
         // Encountered an unrecognized token, provide detailed context
-        std::cerr << "\033[1;31mError:\033[0m Unrecognized syntax element '" << tokens[i].text 
-                  << "' (type=" << static_cast<int>(tokens[i].type) 
-                  << ") at line " << tokens[i].line 
-                  << " column " << tokens[i].column << std::endl;
+        diagnostic() << "\033[1;31mError:\033[0m Unrecognized syntax element '" << tokens[i].text 
+                     << "' (type=" << static_cast<int>(tokens[i].type) 
+                     << ") at line " << tokens[i].line 
+                     << " column " << tokens[i].column << std::endl;
                   
         // Print context
-        std::cerr << "\033[1;33mContext:\033[0m ";
+        diagnostic() << "\033[1;33mContext:\033[0m ";
         size_t context_start = i > 5 ? i - 5 : 0;
         size_t context_end = std::min(i + 5, tokens.size() - 1);
         
         for (size_t j = context_start; j <= context_end; j++) {
             if (j == i) {
-                std::cerr << "\033[1;31m[" << tokens[j].text << "]\033[0m ";
+                diagnostic() << "\033[1;31m[" << tokens[j].text << "]\033[0m ";
             } else {
-                std::cerr << tokens[j].text << " ";
+                diagnostic() << tokens[j].text << " ";
             }
         }
-        std::cerr << std::endl;
+        diagnostic() << std::endl;
         
         // Try to provide possible error causes
         if (tokens[i].type == TokenType::RBrace) {
-            std::cerr << "Hint: Found extra closing brace '}', may be a block nesting issue" << std::endl;
+            diagnostic() << "Hint: Found extra closing brace '}', may be a block nesting issue" << std::endl;
         } else if (tokens[i].type == TokenType::RParen) {
-            std::cerr << "Hint: Found extra closing parenthesis ')', check expressions or conditional statements" << std::endl;
+            diagnostic() << "Hint: Found extra closing parenthesis ')', check expressions or conditional statements" << std::endl;
         } else if (tokens[i].type == TokenType::Else) {
-            std::cerr << "Hint: 'else' keyword missing complete if statement before it" << std::endl;
+            diagnostic() << "Hint: 'else' keyword missing complete if statement before it" << std::endl;
         }
     } else {
-        std::cerr << "\033[31mError: Parser ended unexpectedly at end of file\033[0m" << std::endl;
+        diagnostic() << "\033[31mError: Parser ended unexpectedly at end of file\033[0m" << std::endl;
     }
     
     // Return null pointer to indicate parsing failure
     return nullptr;
 }
 
-std::unique_ptr<ASTNode> Parser::parse(const std::vector<Token>& tokens) {
+NodePtr<ASTNode> Parser::parse(const std::vector<Token>& tokens) {
     size_t i = 0;
+    diagnostic_count = 0;
+    // 本次解析的节点都分配在 arena 中，由返回的根节点持有
+    auto arena = std::make_unique<AstArena>();
     try {
-        DEBUG_OUT << "Debug - Starting file parsing, total tokens: " << tokens.size() << std::endl;
-        auto result = parse_block(tokens, i, true); // Main block
+        LAMINA_LOG(Debug, Parser, "Starting file parsing, total tokens: " << tokens.size());
+        NodePtr<BlockStmt> block;
+        {
+            AstArena::Scope scope(arena.get());
+            block = parse_block(tokens, i, true); // Main block
+        }
+        if (!block) return nullptr;
+        // 根节点在普通堆上分配，才能在析构时连同分配区一起释放
+        auto result = make_node<BlockStmt>();
+        result->statements = std::move(block->statements);
+        block.reset();
+        result->arena = std::move(arena);
         
         // Verify that all tokens were consumed
         if (i < tokens.size() && tokens[i].type != TokenType::EndOfFile) {
-            std::cerr << "\033[33mWarning: Unprocessed tokens remain after parsing completion, starting from position " << i << "\033[0m" << std::endl;
-            std::cerr << "First unprocessed token: " << tokens[i].text 
-                      << " (line " << tokens[i].line << ")" << std::endl;
+            diagnostic() << "\033[33mWarning: Unprocessed tokens remain after parsing completion, starting from position " << i << "\033[0m" << std::endl;
+            diagnostic() << "First unprocessed token: " << tokens[i].text 
+                         << " (line " << tokens[i].line << ")" << std::endl;
         }
         
         return result;
     } catch (const std::exception& e) {
-        std::cerr << "\033[31mParse error: " << e.what() << "\033[0m" << std::endl;
+        diagnostic() << "\033[31mParse error: " << e.what() << "\033[0m" << std::endl;
         return nullptr;
     }
 }
@@ -0,0 +1,202 @@
+#include "resolver.hpp"
+#include "interpreter.hpp"
+#include <algorithm>
+
+void Resolver::resolve(Statement* stmt) {
+    resolve_stmt(stmt);
+}
+
+void Resolver::bind(VarRef& ref, const std::string& name) {
+    if (in_function) {
+        auto it = local_slots.find(name);
+        if (it != local_slots.end()) {
+            ref.scope = VarRef::Scope::Local;
+            ref.slot = it->second;
+            return;
+        }
+    }
+    ref.scope = VarRef::Scope::Global;
+    ref.slot = interp.intern_global(name);
+}
+
+void Resolver::collect_locals(const Statement* stmt, std::vector<std::string>& locals) {
+    if (!stmt) return;
+    auto add = [&locals](const std::string& name) {
+        if (std::find(locals.begin(), locals.end(), name) == locals.end()) {
+            locals.push_back(name);
+        }
+    };
+
+    switch (stmt->kind) {
+    case NodeKind::VarDecl:
+        add(static_cast<const VarDeclStmt*>(stmt)->name);
+        break;
+    case NodeKind::Assign:
+        add(static_cast<const AssignStmt*>(stmt)->name);
+        break;
+    case NodeKind::BigIntDecl:
+        add(static_cast<const BigIntDeclStmt*>(stmt)->name);
+        break;
+    case NodeKind::If: {
+        auto* ifs = static_cast<const IfStmt*>(stmt);
+        collect_locals(ifs->thenBlock.get(), locals);
+        collect_locals(ifs->elseBlock.get(), locals);
+        break;
+    }
+    case NodeKind::While:
+        collect_locals(static_cast<const WhileStmt*>(stmt)->body.get(), locals);
+        break;
+    case NodeKind::For: {
+        auto* fs = static_cast<const ForStmt*>(stmt);
+        add(fs->name);
+        collect_locals(fs->body.get(), locals);
+        break;
+    }
+    case NodeKind::Block:
+        for (const auto& s : static_cast<const BlockStmt*>(stmt)->statements) {
+            collect_locals(s.get(), locals);
+        }
+        break;
+    default:
+        // 嵌套的函数定义拥有自己的局部变量
+        break;
+    }
+}
+
+void Resolver::resolve_function(FuncDefStmt* func) {
+    if (func->resolved) return;
+
+    // 块不引入新作用域，函数体内任意位置的赋值都落在函数帧上
+    std::vector<std::string> locals;
+    for (const auto& param : func->params) {
+        if (std::find(locals.begin(), locals.end(), param) == locals.end()) {
+            locals.push_back(param);
+        }
+    }
+    collect_locals(func->body.get(), locals);
+
+    std::unordered_map<std::string, int> saved_slots = std::move(local_slots);
+    bool saved_in_function = in_function;
+
+    local_slots.clear();
+    for (size_t i = 0; i < locals.size(); ++i) {
+        local_slots[locals[i]] = static_cast<int>(i);
+    }
+    in_function = true;
+    func->locals = std::move(locals);
+    func->resolved = true;
+    resolve_block(func->body.get());
+
+    local_slots = std::move(saved_slots);
+    in_function = saved_in_function;
+}
+
+void Resolver::resolve_block(BlockStmt* block) {
+    if (!block) return;
+    for (auto& stmt : block->statements) {
+        resolve_stmt(stmt.get());
+    }
+}
+
+void Resolver::resolve_stmt(Statement* stmt) {
+    if (!stmt) return;
+
+    switch (stmt->kind) {
+    case NodeKind::VarDecl: {
+        auto* v = static_cast<VarDeclStmt*>(stmt);
+        resolve_expr(v->expr.get());
+        bind(v->ref, v->name);
+        break;
+    }
+    case NodeKind::Assign: {
+        auto* a = static_cast<AssignStmt*>(stmt);
+        resolve_expr(a->expr.get());
+        bind(a->ref, a->name);
+        break;
+    }
+    case NodeKind::BigIntDecl: {
+        auto* bi = static_cast<BigIntDeclStmt*>(stmt);
+        resolve_expr(bi->init_value.get());
+        bind(bi->ref, bi->name);
+        break;
+    }
+    case NodeKind::Define:
+        resolve_expr(static_cast<DefineStmt*>(stmt)->value.get());
+        break;
+    case NodeKind::If: {
+        auto* ifs = static_cast<IfStmt*>(stmt);
+        resolve_expr(ifs->condition.get());
+        resolve_block(ifs->thenBlock.get());
+        resolve_block(ifs->elseBlock.get());
+        break;
+    }
+    case NodeKind::While: {
+        auto* ws = static_cast<WhileStmt*>(stmt);
+        resolve_expr(ws->condition.get());
+        resolve_block(ws->body.get());
+        break;
+    }
+    case NodeKind::For: {
+        auto* fs = static_cast<ForStmt*>(stmt);
+        resolve_expr(fs->start.get());
+        resolve_expr(fs->end.get());
+        bind(fs->ref, fs->name);
+        resolve_block(fs->body.get());
+        break;
+    }
+    case NodeKind::Block:
+        resolve_block(static_cast<BlockStmt*>(stmt));
+        break;
+    case NodeKind::FuncDef:
+        resolve_function(static_cast<FuncDefStmt*>(stmt));
+        break;
+    case NodeKind::Return:
+        resolve_expr(static_cast<ReturnStmt*>(stmt)->expr.get());
+        break;
+    case NodeKind::ExprStmt:
+        resolve_expr(static_cast<ExprStmt*>(stmt)->expr.get());
+        break;
+    default:
+        break;
+    }
+}
+
+void Resolver::resolve_expr(Expression* expr) {
+    if (!expr) return;
+
+    switch (expr->kind) {
+    case NodeKind::Identifier: {
+        auto* id = static_cast<IdentifierExpr*>(expr);
+        bind(id->ref, id->name);
+        break;
+    }
+    case NodeKind::Var: {
+        auto* var = static_cast<VarExpr*>(expr);
+        bind(var->ref, var->name);
+        break;
+    }
+    case NodeKind::Binary: {
+        auto* bin = static_cast<BinaryExpr*>(expr);
+        resolve_expr(bin->left.get());
+        resolve_expr(bin->right.get());
+        break;
+    }
+    case NodeKind::Unary:
+        resolve_expr(static_cast<UnaryExpr*>(expr)->operand.get());
+        break;
+    case NodeKind::Call: {
+        auto* call = static_cast<CallExpr*>(expr);
+        bind(call->callee_ref, call->callee);
+        for (auto& arg : call->args) resolve_expr(arg.get());
+        break;
+    }
+    case NodeKind::NamespaceCall:
+        for (auto& arg : static_cast<NamespaceCallExpr*>(expr)->args) resolve_expr(arg.get());
+        break;
+    case NodeKind::Array:
+        for (auto& element : static_cast<ArrayExpr*>(expr)->elements) resolve_expr(element.get());
+        break;
+    default:
+        break;
+    }
+}
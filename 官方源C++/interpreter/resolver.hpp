@@ -0,0 +1,27 @@
+#pragma once
+#include "ast.hpp"
+#include <string>
+#include <unordered_map>
+
+class Interpreter;
+
+// 名称解析：在执行前把变量引用绑定到函数局部槽位或全局槽位
+// 函数内被赋值（var/赋值/bigint）的名称以及参数是局部变量，其余名称均为全局变量
+class Resolver {
+public:
+    explicit Resolver(Interpreter& interpreter) : interp(interpreter) {}
+    void resolve(Statement* stmt);
+
+private:
+    void resolve_function(FuncDefStmt* func);
+    void collect_locals(const Statement* stmt, std::vector<std::string>& locals);
+    void resolve_stmt(Statement* stmt);
+    void resolve_block(BlockStmt* block);
+    void resolve_expr(Expression* expr);
+    void bind(VarRef& ref, const std::string& name);
+
+    Interpreter& interp;
+    // 当前函数的局部变量槽位；解析顶层代码时为空
+    std::unordered_map<std::string, int> local_slots;
+    bool in_function = false;
+};
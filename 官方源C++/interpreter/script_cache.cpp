@@ -0,0 +1,732 @@
+#include "script_cache.hpp"
+#include "lexer.hpp"
+#include "log.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr char MAGIC[4] = {'L', 'M', 'C', '\0'};
+constexpr uint32_t ENDIAN_MARK = 0x01020304;
+constexpr uint8_t NULL_NODE = 0xFF;
+// 读写时允许的最大嵌套深度，超出时不写缓存（按正常解析执行），也防止损坏的缓存耗尽栈空间
+constexpr size_t MAX_DEPTH = 4096;
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t endian;
+    uint32_t string_count;
+    uint64_t source_hash;
+    uint64_t source_size;
+    uint64_t body_size;
+    uint64_t body_hash;  // 正文的哈希，用于发现损坏的缓存
+};
+
+// 字面量的值类型编码
+enum class LiteralTag : uint8_t { Null, Bool, Int, Float, String, BigInt };
+
+std::atomic<bool> cache_enabled{true};
+
+// 64 位 FNV-1a
+uint64_t fnv1a(const char* data, size_t size) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// 缓存无法生成或已损坏
+struct CacheError {};
+
+bool is_expression(uint8_t tag) {
+    return tag <= static_cast<uint8_t>(NodeKind::Array);
+}
+
+bool is_statement(uint8_t tag) {
+    return tag > static_cast<uint8_t>(NodeKind::Array) && tag <= static_cast<uint8_t>(NodeKind::BigIntDecl);
+}
+
+class Writer {
+public:
+    std::string finish(const BlockStmt& root, uint64_t source_hash, uint64_t source_size) {
+        node(&root);
+        std::string strings;
+        for (const std::string* s : table) {
+            u32(strings, static_cast<uint32_t>(s->size()));
+            strings += *s;
+        }
+        Header header;
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = ScriptCache::FORMAT_VERSION;
+        header.endian = ENDIAN_MARK;
+        header.string_count = static_cast<uint32_t>(table.size());
+        header.source_hash = source_hash;
+        header.source_size = source_size;
+        std::string out(sizeof(header), '\0');
+        out += strings;
+        out += body;
+        header.body_size = out.size() - sizeof(header);
+        header.body_hash = fnv1a(out.data() + sizeof(header), header.body_size);
+        std::memcpy(&out[0], &header, sizeof(header));
+        return out;
+    }
+
+private:
+    template <class T>
+    void put(std::string& out, T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+    void u32(std::string& out, uint32_t value) { put(out, value); }
+    void u8(uint8_t value) { put(body, value); }
+    void u32(uint32_t value) { put(body, value); }
+
+    void str(const std::string& s) {
+        auto it = index.find(s);
+        if (it == index.end()) {
+            it = index.emplace(s, static_cast<uint32_t>(table.size())).first;
+            table.push_back(&it->first);
+        }
+        u32(it->second);
+    }
+
+    template <class T>
+    void list(const std::vector<NodePtr<T>>& nodes) {
+        u32(static_cast<uint32_t>(nodes.size()));
+        for (const auto& n : nodes) node(n.get());
+    }
+
+    void literal(const Value& value) {
+        switch (value.type) {
+        case Value::Type::Null:
+            u8(static_cast<uint8_t>(LiteralTag::Null));
+            break;
+        case Value::Type::Bool:
+            u8(static_cast<uint8_t>(LiteralTag::Bool));
+            u8(value.get<bool>() ? 1 : 0);
+            break;
+        case Value::Type::Int:
+            u8(static_cast<uint8_t>(LiteralTag::Int));
+            put(body, value.get<int64_t>());
+            break;
+        case Value::Type::Float:
+            u8(static_cast<uint8_t>(LiteralTag::Float));
+            put(body, value.get<double>());
+            break;
+        case Value::Type::String:
+            u8(static_cast<uint8_t>(LiteralTag::String));
+            str(value.get<std::string>());
+            break;
+        case Value::Type::BigInt:
+            u8(static_cast<uint8_t>(LiteralTag::BigInt));
+            str(value.get<::BigInt>().to_string());
+            break;
+        default:
+            // 解析器不会生成其他类型的字面量
+            throw CacheError();
+        }
+    }
+
+    void node(const ASTNode* n) {
+        if (!n) {
+            u8(NULL_NODE);
+            return;
+        }
+        if (++depth > MAX_DEPTH) throw CacheError();
+        u8(static_cast<uint8_t>(n->kind));
+        if (is_expression(static_cast<uint8_t>(n->kind))) {
+            str(static_cast<const Expression*>(n)->source);
+        }
+        switch (n->kind) {
+        case NodeKind::Literal:
+            literal(static_cast<const LiteralExpr*>(n)->value);
+            break;
+        case NodeKind::Identifier:
+            str(static_cast<const IdentifierExpr*>(n)->name);
+            break;
+        case NodeKind::Var:
+            str(static_cast<const VarExpr*>(n)->name);
+            break;
+        case NodeKind::Binary: {
+            auto* bin = static_cast<const BinaryExpr*>(n);
+            u8(static_cast<uint8_t>(bin->op));
+            node(bin->left.get());
+            node(bin->right.get());
+            break;
+        }
+        case NodeKind::Unary: {
+            auto* unary = static_cast<const UnaryExpr*>(n);
+            u8(static_cast<uint8_t>(unary->op));
+            node(unary->operand.get());
+            break;
+        }
+        case NodeKind::Call: {
+            auto* call = static_cast<const CallExpr*>(n);
+            str(call->callee);
+            list(call->args);
+            break;
+        }
+        case NodeKind::NamespaceCall: {
+            auto* call = static_cast<const NamespaceCallExpr*>(n);
+            str(call->namespace_name);
+            str(call->function_name);
+            list(call->args);
+            break;
+        }
+        case NodeKind::Array:
+            list(static_cast<const ArrayExpr*>(n)->elements);
+            break;
+        case NodeKind::VarDecl: {
+            auto* decl = static_cast<const VarDeclStmt*>(n);
+            str(decl->name);
+            node(decl->expr.get());
+            break;
+        }
+        case NodeKind::Assign: {
+            auto* assign = static_cast<const AssignStmt*>(n);
+            str(assign->name);
+            node(assign->expr.get());
+            break;
+        }
+        case NodeKind::Block:
+            list(static_cast<const BlockStmt*>(n)->statements);
+            break;
+        case NodeKind::If: {
+            auto* ifs = static_cast<const IfStmt*>(n);
+            node(ifs->condition.get());
+            node(ifs->thenBlock.get());
+            node(ifs->elseBlock.get());
+            break;
+        }
+        case NodeKind::While: {
+            auto* ws = static_cast<const WhileStmt*>(n);
+            node(ws->condition.get());
+            node(ws->body.get());
+            break;
+        }
+        case NodeKind::For: {
+            auto* fs = static_cast<const ForStmt*>(n);
+            str(fs->name);
+            node(fs->start.get());
+            node(fs->end.get());
+            node(fs->body.get());
+            break;
+        }
+        case NodeKind::FuncDef: {
+            auto* func = static_cast<const FuncDefStmt*>(n);
+            str(func->name);
+            u32(static_cast<uint32_t>(func->params.size()));
+            for (const auto& param : func->params) str(param);
+            put(body, static_cast<int32_t>(func->line));
+            node(func->body.get());
+            break;
+        }
+        case NodeKind::Return:
+            node(static_cast<const ReturnStmt*>(n)->expr.get());
+            break;
+        case NodeKind::Include:
+            str(static_cast<const IncludeStmt*>(n)->module);
+            break;
+        case NodeKind::Use:
+            str(static_cast<const UseStmt*>(n)->module);
+            break;
+        case NodeKind::Break:
+        case NodeKind::Continue:
+            break;
+        case NodeKind::ExprStmt:
+            node(static_cast<const ExprStmt*>(n)->expr.get());
+            break;
+        case NodeKind::Define: {
+            auto* def = static_cast<const DefineStmt*>(n);
+            str(def->name);
+            node(def->value.get());
+            break;
+        }
+        case NodeKind::BigIntDecl: {
+            auto* decl = static_cast<const BigIntDeclStmt*>(n);
+            str(decl->name);
+            node(decl->init_value.get());
+            break;
+        }
+        }
+        --depth;
+    }
+
+    std::string body;
+    std::unordered_map<std::string, uint32_t> index;
+    std::vector<const std::string*> table;
+    size_t depth = 0;
+};
+
+// 从缓存正文重建节点；所有读取都检查边界，内容与格式不符时抛出 CacheError
+class Reader {
+public:
+    Reader(const unsigned char* begin, const unsigned char* end, uint32_t string_count) : p(begin), end(end) {
+        strings.reserve(string_count);
+        for (uint32_t i = 0; i < string_count; ++i) {
+            uint32_t len = get<uint32_t>();
+            if (static_cast<size_t>(this->end - p) < len) throw CacheError();
+            strings.emplace_back(reinterpret_cast<const char*>(p), len);
+            p += len;
+        }
+    }
+
+    NodePtr<BlockStmt> root() {
+        auto block = node<BlockStmt>(NodeKind::Block);
+        if (!block || p != end) throw CacheError();
+        return block;
+    }
+
+private:
+    template <class T>
+    T get() {
+        if (static_cast<size_t>(end - p) < sizeof(T)) throw CacheError();
+        T value;
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+        return value;
+    }
+
+    std::string str() {
+        uint32_t i = get<uint32_t>();
+        if (i >= strings.size()) throw CacheError();
+        return std::string(strings[i]);
+    }
+
+    // 读取一个节点并检查其类别：T 为 Expression/Statement 时接受该类的任意节点，否则只接受 kind
+    template <class T>
+    NodePtr<T> node(NodeKind kind) {
+        uint8_t tag = get<uint8_t>();
+        if (tag == NULL_NODE) return nullptr;
+        bool ok = std::is_same_v<T, Expression> ? is_expression(tag)
+                : std::is_same_v<T, Statement> ? is_statement(tag)
+                : tag == static_cast<uint8_t>(kind);
+        if (!ok) throw CacheError();
+        if (++depth > MAX_DEPTH) throw CacheError();
+        NodePtr<ASTNode> n = build(static_cast<NodeKind>(tag));
+        --depth;
+        return NodePtr<T>(static_cast<T*>(n.release()));
+    }
+
+    NodePtr<Expression> expr() { return node<Expression>(NodeKind::Literal); }
+    NodePtr<Statement> stmt() { return node<Statement>(NodeKind::Block); }
+    NodePtr<BlockStmt> block() { return node<BlockStmt>(NodeKind::Block); }
+
+    std::vector<NodePtr<Expression>> exprs() {
+        uint32_t count = get<uint32_t>();
+        std::vector<NodePtr<Expression>> result;
+        for (uint32_t i = 0; i < count; ++i) result.push_back(expr());
+        return result;
+    }
+
+    Value literal() {
+        switch (static_cast<LiteralTag>(get<uint8_t>())) {
+        case LiteralTag::Null: return Value(nullptr);
+        case LiteralTag::Bool: return Value(get<uint8_t>() != 0);
+        case LiteralTag::Int: return Value(get<int64_t>());
+        case LiteralTag::Float: return Value(get<double>());
+        case LiteralTag::String: return Value(str());
+        case LiteralTag::BigInt: return Value(::BigInt(str()));
+        default: throw CacheError();
+        }
+    }
+
+    template <class Op>
+    Op op(Op limit) {
+        uint8_t code = get<uint8_t>();
+        if (code > static_cast<uint8_t>(limit)) throw CacheError();
+        return static_cast<Op>(code);
+    }
+
+    NodePtr<ASTNode> build(NodeKind kind) {
+        std::string source;
+        if (is_expression(static_cast<uint8_t>(kind))) source = str();
+        NodePtr<ASTNode> result;
+        switch (kind) {
+        case NodeKind::Literal:
+            result = make_node<LiteralExpr>(literal());
+            break;
+        case NodeKind::Identifier:
+            result = make_node<IdentifierExpr>(str());
+            break;
+        case NodeKind::Var:
+            result = make_node<VarExpr>(str());
+            break;
+        case NodeKind::Binary: {
+            BinaryOp o = op(static_cast<BinaryOp>(static_cast<uint8_t>(BinaryOp::Count) - 1));
+            auto left = expr();
+            auto right = expr();
+            result = make_node<BinaryExpr>(o, std::move(left), std::move(right));
+            break;
+        }
+        case NodeKind::Unary: {
+            UnaryOp o = op(UnaryOp::Square);
+            result = make_node<UnaryExpr>(o, expr());
+            break;
+        }
+        case NodeKind::Call: {
+            std::string callee = str();
+            result = make_node<CallExpr>(callee, exprs());
+            break;
+        }
+        case NodeKind::NamespaceCall: {
+            std::string ns = str();
+            std::string fn = str();
+            result = make_node<NamespaceCallExpr>(ns, fn, exprs());
+            break;
+        }
+        case NodeKind::Array:
+            result = make_node<ArrayExpr>(exprs());
+            break;
+        case NodeKind::VarDecl: {
+            std::string name = str();
+            result = make_node<VarDeclStmt>(name, expr());
+            break;
+        }
+        case NodeKind::Assign: {
+            std::string name = str();
+            result = make_node<AssignStmt>(name, expr());
+            break;
+        }
+        case NodeKind::Block: {
+            auto b = make_node<BlockStmt>();
+            uint32_t count = get<uint32_t>();
+            for (uint32_t i = 0; i < count; ++i) b->statements.push_back(stmt());
+            result = std::move(b);
+            break;
+        }
+        case NodeKind::If: {
+            auto cond = expr();
+            auto then_block = block();
+            auto else_block = block();
+            result = make_node<IfStmt>(std::move(cond), std::move(then_block), std::move(else_block));
+            break;
+        }
+        case NodeKind::While: {
+            auto cond = expr();
+            result = make_node<WhileStmt>(std::move(cond), block());
+            break;
+        }
+        case NodeKind::For: {
+            std::string name = str();
+            auto start = expr();
+            auto end_expr = expr();
+            result = make_node<ForStmt>(name, std::move(start), std::move(end_expr), block());
+            break;
+        }
+        case NodeKind::FuncDef: {
+            std::string name = str();
+            uint32_t count = get<uint32_t>();
+            std::vector<std::string> params;
+            for (uint32_t i = 0; i < count; ++i) params.push_back(str());
+            int line = get<int32_t>();
+            auto func = make_node<FuncDefStmt>(name, params, block());
+            func->line = line;
+            result = std::move(func);
+            break;
+        }
+        case NodeKind::Return:
+            result = make_node<ReturnStmt>(expr());
+            break;
+        case NodeKind::Include:
+            result = make_node<IncludeStmt>(str());
+            break;
+        case NodeKind::Use:
+            result = make_node<UseStmt>(str());
+            break;
+        case NodeKind::Break:
+            result = make_node<BreakStmt>();
+            break;
+        case NodeKind::Continue:
+            result = make_node<ContinueStmt>();
+            break;
+        case NodeKind::ExprStmt:
+            result = make_node<ExprStmt>(expr());
+            break;
+        case NodeKind::Define: {
+            std::string name = str();
+            result = make_node<DefineStmt>(name, expr());
+            break;
+        }
+        case NodeKind::BigIntDecl: {
+            std::string name = str();
+            result = make_node<BigIntDeclStmt>(name, expr());
+            break;
+        }
+        }
+        if (is_expression(static_cast<uint8_t>(kind))) {
+            static_cast<Expression*>(result.get())->source = std::move(source);
+        }
+        return result;
+    }
+
+    const unsigned char* p;
+    const unsigned char* end;
+    std::vector<std::string_view> strings;
+    size_t depth = 0;
+};
+
+// 只读映射整个文件；文件不存在或为空时 data() 为空
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return;
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) return;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) return;
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!view) return;
+        bytes = static_cast<const unsigned char*>(view);
+        length = static_cast<size_t>(file_size.QuadPart);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* view = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view != MAP_FAILED) {
+                bytes = static_cast<const unsigned char*>(view);
+                length = static_cast<size_t>(st.st_size);
+            }
+        }
+        ::close(fd);
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (bytes) UnmapViewOfFile(bytes);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+        if (bytes) ::munmap(const_cast<unsigned char*>(bytes), length);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+    const unsigned char* bytes = nullptr;
+    size_t length = 0;
+};
+
+// 先写入临时文件再改名，其他进程不会读到写了一半的缓存
+bool write_file(const std::string& path, const std::string& data) {
+#ifdef _WIN32
+    std::string temp = path + ".tmp" + std::to_string(_getpid());
+#else
+    std::string temp = path + ".tmp" + std::to_string(::getpid());
+#endif
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!out) {
+            out.close();
+            std::remove(temp.c_str());
+            return false;
+        }
+    }
+#ifdef _WIN32
+    // Windows 上 rename 不覆盖已有文件
+    std::remove(path.c_str());
+#endif
+    if (std::rename(temp.c_str(), path.c_str()) != 0) {
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// 用户缓存目录：Windows 为 %LOCALAPPDATA%\lamina，其他系统为 $XDG_CACHE_HOME/lamina 或 ~/.cache/lamina
+std::string user_cache_dir() {
+#ifdef _WIN32
+    const char* base = std::getenv("LOCALAPPDATA");
+    if (!base || !*base) return std::string();
+    return std::string(base) + "\\lamina";
+#else
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    if (xdg && *xdg) return std::string(xdg) + "/lamina";
+    const char* home = std::getenv("HOME");
+    if (!home || !*home) return std::string();
+    return std::string(home) + "/.cache/lamina";
+#endif
+}
+
+// 逐级创建目录，已存在的部分跳过
+bool make_directories(const std::string& dir) {
+    for (size_t pos = dir.find_first_of("/\\", 1);; pos = dir.find_first_of("/\\", pos + 1)) {
+        std::string prefix = dir.substr(0, pos);
+#ifdef _WIN32
+        _mkdir(prefix.c_str());
+#else
+        ::mkdir(prefix.c_str(), 0755);
+#endif
+        if (pos == std::string::npos) break;
+    }
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(dir.c_str());
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    struct stat st;
+    return ::stat(dir.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+std::string absolute_path(const std::string& path) {
+#ifdef _WIN32
+    char full[MAX_PATH];
+    if (_fullpath(full, path.c_str(), MAX_PATH)) return full;
+#else
+    if (char* real = ::realpath(path.c_str(), nullptr)) {
+        std::string result(real);
+        std::free(real);
+        return result;
+    }
+#endif
+    return path;
+}
+
+// 读取并校验 cache 处的缓存，不存在或已失效时返回空指针
+NodePtr<ASTNode> read_cache(const std::string& cache, const std::string& path, uint64_t source_hash, uint64_t source_size) {
+    MappedFile file(cache);
+    if (!file.data()) return nullptr;
+    if (auto ast = ScriptCache::deserialize(file.data(), file.size(), source_hash, source_size)) {
+        LAMINA_LOG(Debug, Module, "Loaded syntax tree from cache " << cache);
+        return ast;
+    }
+    LAMINA_LOG(Debug, Module, "Cache " << cache << " is stale or invalid, parsing " << path);
+    return nullptr;
+}
+
+} // namespace
+
+void ScriptCache::set_enabled(bool enabled) {
+    cache_enabled.store(enabled);
+}
+
+std::string ScriptCache::cache_path(const std::string& path) {
+    if (path.size() >= 3 && path.compare(path.size() - 3, 3, ".lm") == 0) {
+        return path + "c";
+    }
+    return path + ".lmc";
+}
+
+std::string ScriptCache::user_cache_path(const std::string& path) {
+    std::string dir = user_cache_dir();
+    if (dir.empty()) return std::string();
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.lmc", static_cast<unsigned long long>(hash(absolute_path(path))));
+#ifdef _WIN32
+    return dir + "\\" + name;
+#else
+    return dir + "/" + name;
+#endif
+}
+
+uint64_t ScriptCache::hash(const std::string& source) {
+    return fnv1a(source.data(), source.size());
+}
+
+std::string ScriptCache::serialize(const BlockStmt& root, uint64_t source_hash, uint64_t source_size) {
+    try {
+        return Writer().finish(root, source_hash, source_size);
+    } catch (const CacheError&) {
+        return std::string();
+    }
+}
+
+NodePtr<ASTNode> ScriptCache::deserialize(const unsigned char* data, size_t size, uint64_t source_hash, uint64_t source_size) {
+    Header header;
+    if (size < sizeof(header)) return nullptr;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != FORMAT_VERSION ||
+        header.endian != ENDIAN_MARK || header.source_hash != source_hash || header.source_size != source_size ||
+        header.body_size != size - sizeof(header) ||
+        header.body_hash != fnv1a(reinterpret_cast<const char*>(data) + sizeof(header), header.body_size)) {
+        return nullptr;
+    }
+
+    // 与 Parser::parse 相同：节点放在分配区中，由堆上的根节点持有
+    auto arena = std::make_unique<AstArena>();
+    try {
+        NodePtr<BlockStmt> block;
+        {
+            AstArena::Scope scope(arena.get());
+            Reader reader(data + sizeof(header), data + size, header.string_count);
+            block = reader.root();
+        }
+        auto result = make_node<BlockStmt>();
+        result->statements = std::move(block->statements);
+        block.reset();
+        result->arena = std::move(arena);
+        return result;
+    } catch (const CacheError&) {
+        return nullptr;
+    }
+}
+
+NodePtr<ASTNode> ScriptCache::load(const std::string& path, const std::string& source) {
+    bool enabled = cache_enabled.load();
+    uint64_t source_hash = 0;
+    std::string cache;
+    std::string user_cache;
+    if (enabled) {
+        source_hash = hash(source);
+        cache = cache_path(path);
+        if (auto ast = read_cache(cache, path, source_hash, source.size())) return ast;
+        user_cache = user_cache_path(path);
+        if (!user_cache.empty()) {
+            if (auto ast = read_cache(user_cache, path, source_hash, source.size())) return ast;
+        }
+    }
+
+    auto tokens = Lexer::tokenize(source);
+    bool clean = Lexer::diagnostics() == 0;
+    auto ast = Parser::parse(tokens);
+    clean = clean && Parser::diagnostics() == 0;
+    if (!enabled || !ast || !clean) return ast;
+
+    auto* root = dynamic_cast<BlockStmt*>(ast.get());
+    std::string data = root ? serialize(*root, source_hash, source.size()) : std::string();
+    if (data.empty()) {
+        LAMINA_LOG(Debug, Module, "Syntax tree of " << path << " was not cached");
+    } else if (write_file(cache, data)) {
+        LAMINA_LOG(Debug, Module, "Wrote syntax tree cache " << cache);
+    } else if (!user_cache.empty() && make_directories(user_cache_dir()) && write_file(user_cache, data)) {
+        // 脚本所在目录不可写（只读或共享的目录）时写入用户缓存目录
+        LAMINA_LOG(Debug, Module, "Wrote syntax tree cache " << user_cache);
+    } else {
+        LAMINA_LOG(Debug, Module, "Syntax tree of " << path << " was not cached");
+    }
+    return ast;
+}
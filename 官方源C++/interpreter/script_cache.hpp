@@ -0,0 +1,42 @@
+#pragma once
+#include "ast.hpp"
+#include "parser.hpp"
+#include <cstdint>
+#include <string>
+
+// 脚本语法树缓存（.lmc）：脚本第一次加载时把解析结果写入同目录下的 <脚本名>.lmc，
+// 之后源码内容未变（按源码哈希判断）就映射缓存文件直接重建语法树，跳过词法与语法分析。
+// 脚本所在目录不可写时改用用户缓存目录（见 user_cache_path）。
+// 缓存只保存解析器的原始输出，优化与名称解析仍在执行时进行；解析有错误或警告的脚本不写缓存。
+//
+// 文件格式（本机字节序）：
+//   头部    magic "LMC\0"、格式版本、字节序标记、字符串个数、源码哈希、源码长度、正文长度与正文哈希
+//   字符串表 每项为 u32 长度 + 内容，节点中的名称与字符串按下标引用
+//   节点    从根块开始前序排列，每个节点以 NodeKind 开头（空节点为 0xFF），其后是该类节点的字段
+// 节点结构或编码改变时必须增加 FORMAT_VERSION，旧缓存会被视为失效并重新生成。
+class LAMINA_API ScriptCache {
+public:
+    static constexpr uint32_t FORMAT_VERSION = 1;
+
+    // 返回 path 处源码 source 的语法树：缓存有效时从缓存读取，否则解析并尝试写入缓存。
+    // 解析失败时返回空指针（解析器已输出错误信息）
+    static NodePtr<ASTNode> load(const std::string& path, const std::string& source);
+
+    // 关闭后 load 只解析、不读写缓存文件
+    static void set_enabled(bool enabled);
+
+    // path 对应的缓存文件：x.lm 对应 x.lmc，其他文件名追加 .lmc
+    static std::string cache_path(const std::string& path);
+
+    // 脚本旁无法写入缓存时使用的位置：用户缓存目录（Windows 为 %LOCALAPPDATA%\lamina，其他系统为
+    // $XDG_CACHE_HOME/lamina 或 ~/.cache/lamina）下以脚本绝对路径哈希命名的 .lmc 文件；无法确定目录时返回空串
+    static std::string user_cache_path(const std::string& path);
+
+    // 源码哈希（64 位 FNV-1a，正文哈希使用同一算法）
+    static uint64_t hash(const std::string& source);
+
+    // 序列化与反序列化。含有无法保存的节点（如嵌套过深）时 serialize 返回空串；
+    // 头部与 source_hash/source_size 不符或内容损坏时 deserialize 返回空指针
+    static std::string serialize(const BlockStmt& root, uint64_t source_hash, uint64_t source_size);
+    static NodePtr<ASTNode> deserialize(const unsigned char* data, size_t size, uint64_t source_hash, uint64_t source_size);
+};
@@ -0,0 +1,122 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+namespace {
+thread_local size_t task_depth = 0;
+}
+
+bool ThreadPool::in_task() {
+    return task_depth > 0;
+}
+
+ThreadPool& ThreadPool::shared() {
+    // 有意不析构：工作线程分离运行，进程退出时不需要等待它们
+    static ThreadPool* pool = [] {
+        unsigned hardware = std::thread::hardware_concurrency();
+        return new ThreadPool(hardware > 1 ? hardware - 1 : 0);
+    }();
+    return *pool;
+}
+
+ThreadPool::ThreadPool(size_t workers) {
+    for (size_t i = 0; i < workers; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 0; i < workers; ++i) {
+        threads.emplace_back(&ThreadPool::worker_loop, this, i);
+        threads.back().detach();
+    }
+}
+
+bool ThreadPool::take_task(size_t home, Task& task) {
+    if (queues.empty()) return false;
+    {
+        Queue& own = *queues[home % queues.size()];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.back();
+            own.tasks.pop_back();
+            pending.fetch_sub(1);
+            return true;
+        }
+    }
+    for (size_t k = 1; k < queues.size(); ++k) {
+        Queue& victim = *queues[(home + k) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            pending.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::run_task(const Task& task) {
+    Job& job = *task.job;
+    if (!job.failed.load()) {
+        ++task_depth;
+        try {
+            (*job.body)(task.begin, task.end);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            if (!job.error) job.error = std::current_exception();
+            job.failed.store(true);
+        }
+        --task_depth;
+    }
+    // 持锁递减：等待方只能在本线程释放锁之后看到计数归零并销毁 job
+    std::lock_guard<std::mutex> lock(job.mutex);
+    if (job.remaining.fetch_sub(1) == 1) {
+        job.done.notify_all();
+    }
+}
+
+void ThreadPool::worker_loop(size_t index) {
+    while (true) {
+        Task task;
+        if (take_task(index, task)) {
+            run_task(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        wake.wait(lock, [this] { return pending.load() > 0; });
+    }
+}
+
+void ThreadPool::parallel_for(size_t n, size_t grain, const std::function<void(size_t, size_t)>& body) {
+    if (n == 0) return;
+    if (grain == 0) grain = 1;
+    size_t chunks = (n + grain - 1) / grain;
+    if (queues.empty() || chunks == 1) {
+        body(0, n);
+        return;
+    }
+
+    Job job;
+    job.body = &body;
+    job.remaining.store(chunks);
+    // 块按轮转方式放入各队列，空闲线程再互相窃取以平衡负载
+    for (size_t c = 0; c < chunks; ++c) {
+        Queue& queue = *queues[c % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(Task{&job, c * grain, std::min(n, (c + 1) * grain)});
+        pending.fetch_add(1);
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+    }
+    wake.notify_all();
+
+    // 调用线程帮忙执行，直到没有可取的任务，再等待其他线程完成剩余的块
+    Task task;
+    while (job.remaining.load() > 0 && take_task(0, task)) {
+        run_task(task);
+    }
+    {
+        std::unique_lock<std::mutex> lock(job.mutex);
+        job.done.wait(lock, [&job] { return job.remaining.load() == 0; });
+    }
+    if (job.error) std::rethrow_exception(job.error);
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 工作窃取线程池：每个工作线程有自己的任务队列，从队尾取任务；自己的队列为空时从其他队列的队首窃取。
+// 并行内置函数（map/filter/reduce/sum/zip_with）通过 parallel_for 把数组切块分发到各线程。
+class ThreadPool {
+public:
+    // 进程内共享的线程池，工作线程数为硬件线程数减一（调用线程同样参与执行）
+    static ThreadPool& shared();
+
+    explicit ThreadPool(size_t workers);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // 可同时执行任务的线程数（含调用线程）
+    size_t concurrency() const { return queues.size() + 1; }
+
+    // 把 [0, n) 按 grain 切块，对每块调用 body(begin, end)；所有块完成后返回。
+    // 调用线程在等待期间也执行任务；任一块抛出异常时其余未开始的块被跳过，异常在此处重新抛出
+    void parallel_for(size_t n, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+    // 当前线程是否正在执行线程池任务（包括调用线程在 parallel_for 中代为执行的块）
+    static bool in_task();
+
+private:
+    struct Job {
+        const std::function<void(size_t, size_t)>* body;
+        std::atomic<size_t> remaining{0};
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+
+    struct Task {
+        Job* job;
+        size_t begin;
+        size_t end;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void worker_loop(size_t index);
+    // 先从 home 号队列的队尾取，再依次从其他队列的队首窃取
+    bool take_task(size_t home, Task& task);
+    void run_task(const Task& task);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<size_t> pending{0};
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+};
@@ -0,0 +1,292 @@
+#include "vm.hpp"
+#include <exception>
+#include <iostream>
+
+Completion VM::execute(const NodePtr<Statement>& stmt) {
+    if (!stmt) return Completion();
+    auto& chunk = statement_chunks[stmt.get()];
+    if (!chunk) {
+        chunk = BytecodeCompiler::compile_statement(stmt);
+    }
+    return run(*chunk);
+}
+
+const Chunk& VM::function_chunk(FuncDefStmt* func) {
+    auto& chunk = function_chunks[func];
+    if (!chunk) {
+        chunk = BytecodeCompiler::compile_function(func);
+    }
+    return *chunk;
+}
+
+Completion VM::run_function(FuncDefStmt* func) {
+    return run(function_chunk(func));
+}
+
+size_t VM::frame_cost(const Chunk& chunk, const FuncDefStmt* func) const {
+    // 帧本身、寄存器、局部变量槽以及解释器一侧的作用域与调用栈记录
+    return sizeof(Frame) + chunk.num_registers * sizeof(Value) +
+           func->locals.size() * (sizeof(Value) + 1) + sizeof(LocalFrame) + sizeof(CallRecord);
+}
+
+size_t VM::min_frame_bytes() {
+    return sizeof(Frame) + sizeof(LocalFrame) + sizeof(CallRecord);
+}
+
+void VM::check_stack_budget(size_t bytes) const {
+    if (bytes > interp.get_call_stack_budget()) {
+        RuntimeError error("Call stack memory budget exceeded (" +
+                           std::to_string(interp.get_call_stack_budget() >> 20) + " MB)");
+        error.stack_trace = interp.get_stack_trace();
+        throw error;
+    }
+}
+
+void VM::push_function(RunState& state, FuncDefStmt* func, const std::vector<Value>& args, int return_reg) {
+    const Chunk& chunk = function_chunk(func);
+    size_t cost = frame_cost(chunk, func);
+    check_stack_budget(stack_bytes + cost);
+    interp.enter_function(func, func->name, args);
+    stack_bytes += cost;
+    state.frames.push_back(Frame{&chunk, 0, state.stack.size(), state.regions.size(), 0, func, cost});
+    state.frames.back().return_reg = return_reg;
+    state.stack.resize(state.stack.size() + chunk.num_registers);
+}
+
+void VM::replace_function(RunState& state, FuncDefStmt* func, const std::vector<Value>& args) {
+    Frame& frame = state.frames.back();
+    const Chunk& chunk = function_chunk(func);
+    size_t cost = frame_cost(chunk, func);
+    check_stack_budget(stack_bytes - frame.cost + cost);
+    interp.tail_call_function(func, func->name, args);
+    stack_bytes = stack_bytes - frame.cost + cost;
+    frame.chunk = &chunk;
+    frame.func = func;
+    frame.cost = cost;
+    // 尾调用只出现在区域之外，本帧没有未退出的区域
+    state.stack.resize(frame.base);
+    state.stack.resize(frame.base + chunk.num_registers);
+}
+
+void VM::pop_function(RunState& state) {
+    const Frame& frame = state.frames.back();
+    interp.leave_function();
+    stack_bytes -= frame.cost;
+    state.stack.resize(frame.base);
+    state.regions.resize(frame.region_base);
+    state.frames.pop_back();
+}
+
+Completion VM::run(const Chunk& entry) {
+    struct DepthGuard {
+        int& depth;
+        explicit DepthGuard(int& d) : depth(d) { ++depth; }
+        ~DepthGuard() { --depth; }
+    } guard(native_depth);
+    if (native_depth > MAX_NATIVE_DEPTH) {
+        RuntimeError error("Maximum recursion depth exceeded (" + std::to_string(MAX_NATIVE_DEPTH) + ")");
+        error.stack_trace = interp.get_stack_trace();
+        throw error;
+    }
+
+    RunState state;
+    state.frames.push_back(Frame{&entry, 0, 0, 0, 0, nullptr, 0});
+    state.stack.resize(entry.num_registers);
+    size_t pc = 0;
+
+    for (;;) {
+        try {
+            // 每次切换调用帧后重新载入当前帧的字节码与寄存器窗口
+            for (;;) {
+                const Chunk& chunk = *state.frames.back().chunk;
+                const Instruction* code = chunk.code.data();
+                Value* regs = state.stack.data() + state.frames.back().base;
+                Completion completion;
+                bool finished = false;
+                bool entered = false;
+
+                while (!finished) {
+                    const Instruction& ins = code[pc++];
+                    switch (ins.op) {
+                    case OpCode::LoadConst:
+                        regs[ins.a] = chunk.constants[ins.b];
+                        break;
+                    case OpCode::LoadVar:
+                        regs[ins.a] = interp.read_variable(chunk.refs[ins.b], chunk.names[ins.b]);
+                        break;
+                    case OpCode::StoreVar:
+                        interp.write_variable(chunk.refs[ins.b], chunk.names[ins.b], regs[ins.a]);
+                        break;
+                    case OpCode::Binary:
+                        regs[ins.a] = interp.binary_op(static_cast<BinaryOp>(ins.aux), regs[ins.b], regs[ins.c]);
+                        break;
+                    case OpCode::Unary:
+                        regs[ins.a] = interp.unary_op(static_cast<UnaryOp>(ins.aux), regs[ins.b]);
+                        break;
+                    case OpCode::MakeArray: {
+                        std::vector<Value> elements(regs + ins.b, regs + ins.b + ins.c);
+                        regs[ins.a] = Value(std::move(elements));
+                        break;
+                    }
+                    case OpCode::Call:
+                    case OpCode::TailCall: {
+                        std::vector<Value> args(regs + ins.c, regs + ins.c + ins.aux);
+                        const CallSiteCache& target = interp.resolve_call(chunk.calls[ins.b], chunk.call_caches[ins.b]);
+                        if (!target.func) {
+                            regs[ins.a] = interp.call_target(target, args);
+                            break;
+                        }
+                        // 入口帧的函数由 call_user_function 进入和退出，尾调用仍压入新帧，返回后执行随后的 Return
+                        if (ins.op == OpCode::TailCall && state.frames.back().func) {
+                            replace_function(state, target.func, args);
+                            pc = 0;
+                            entered = true;
+                            finished = true;
+                            break;
+                        }
+                        state.frames.back().pc = pc;
+                        push_function(state, target.func, args, ins.a);
+                        pc = 0;
+                        entered = true;
+                        finished = true;
+                        break;
+                    }
+                    case OpCode::Jump:
+                        pc = ins.a;
+                        break;
+                    case OpCode::JumpIfFalse:
+                        if (!regs[ins.a].as_bool()) pc = ins.b;
+                        break;
+                    case OpCode::LoopTick:
+                        interp.tick();
+                        break;
+                    case OpCode::ForPrep:
+                        if (ins.aux) {
+                            if (!regs[ins.a].is_int() || !regs[ins.b].is_int()) {
+                                RuntimeError error("For range bounds must be integers");
+                                error.stack_trace = interp.get_stack_trace();
+                                throw error;
+                            }
+                        } else {
+                            if (!regs[ins.a].is_array() && !regs[ins.a].is_matrix()) {
+                                RuntimeError error("For loop can only iterate over a range or an array");
+                                error.stack_trace = interp.get_stack_trace();
+                                throw error;
+                            }
+                            regs[ins.b] = Value(0);
+                        }
+                        break;
+                    case OpCode::ForNext: {
+                        Value& iter = regs[ins.a];
+                        if (iter.is_int()) {
+                            // 区间：循环变量以整数保存在寄存器中，原地递增
+                            int64_t next = iter.get<int64_t>();
+                            if (next >= regs[ins.b].get<int64_t>()) {
+                                pc = ins.c;
+                                break;
+                            }
+                            regs[ins.aux] = Value(next);
+                            iter = Value(next + 1);
+                        } else {
+                            // 数组：寄存器与变量共享同一份数组，不复制元素
+                            size_t index = static_cast<size_t>(regs[ins.b].get<int64_t>());
+                            if (iter.is_array()) {
+                                const auto& elements = iter.get<std::vector<Value>>();
+                                if (index >= elements.size()) {
+                                    pc = ins.c;
+                                    break;
+                                }
+                                regs[ins.aux] = elements[index];
+                            } else {
+                                const auto& rows = iter.get<std::vector<std::vector<Value>>>();
+                                if (index >= rows.size()) {
+                                    pc = ins.c;
+                                    break;
+                                }
+                                regs[ins.aux] = Value(rows[index]);
+                            }
+                            regs[ins.b] = Value(static_cast<int64_t>(index + 1));
+                        }
+                        break;
+                    }
+                    case OpCode::EnterRegion:
+                        state.regions.push_back(Region{static_cast<RegionKind>(ins.aux), static_cast<size_t>(ins.a)});
+                        break;
+                    case OpCode::LeaveRegion:
+                        state.regions.pop_back();
+                        break;
+                    case OpCode::Return:
+                        completion = Completion{Completion::Kind::Return, regs[ins.a]};
+                        finished = true;
+                        break;
+                    case OpCode::ReturnNull:
+                        finished = true;
+                        break;
+                    case OpCode::Complete:
+                        completion = Completion{static_cast<Completion::Kind>(ins.aux), Value()};
+                        finished = true;
+                        break;
+                    case OpCode::ExecStmt:
+                        completion = interp.execute(*chunk.fallbacks[ins.b]);
+                        finished = completion.kind != Completion::Kind::Normal;
+                        break;
+                    }
+                }
+
+                // 压入了新帧：从新帧开头继续
+                if (entered) continue;
+
+                Frame& frame = state.frames.back();
+                if (!frame.func) return completion;
+                if (completion.kind == Completion::Kind::Break || completion.kind == Completion::Kind::Continue) {
+                    RuntimeError error(std::string(completion.kind == Completion::Kind::Break ? "Break" : "Continue")
+                                       + " statement used outside loop");
+                    error.stack_trace = interp.get_stack_trace();
+                    // 函数体内的区域不处理这个错误
+                    state.regions.resize(frame.region_base);
+                    throw error;
+                }
+                int return_reg = frame.return_reg;
+                pop_function(state);
+                pc = state.frames.back().pc;
+                state.stack[state.frames.back().base + return_reg] = std::move(completion.value);
+            }
+        } catch (...) {
+            pc = handle_exception(state, std::current_exception());
+        }
+    }
+}
+
+size_t VM::handle_exception(RunState& state, std::exception_ptr error) {
+    for (;;) {
+        const Frame& frame = state.frames.back();
+        while (state.regions.size() > frame.region_base) {
+            Region region = state.regions.back();
+            state.regions.pop_back();
+            try {
+                std::rethrow_exception(error);
+            } catch (const ExecutionAborted&) {
+                // 预算耗尽或中断不被任何区域处理
+            } catch (const std::exception& e) {
+                if (region.kind == RegionKind::ExprStmt) {
+                    std::cerr << "ERROR: Exception in expression statement: " << e.what() << std::endl;
+                    return region.handler;
+                }
+                std::string prefix = region.kind == RegionKind::LoopCondition
+                    ? "Loop condition error: " : "Loop body execution error: ";
+                RuntimeError wrapped(prefix + e.what());
+                wrapped.stack_trace = interp.get_stack_trace();
+                error = std::make_exception_ptr(wrapped);
+            } catch (...) {
+                if (region.kind == RegionKind::ExprStmt) {
+                    std::cerr << "ERROR: Unknown exception in expression statement" << std::endl;
+                    return region.handler;
+                }
+            }
+        }
+        if (!frame.func) std::rethrow_exception(error);
+        // 与 call_user_function 相同：先按函数补全错误信息，再退出函数
+        error = interp.function_error(error, frame.func->name);
+        pop_function(state);
+    }
+}
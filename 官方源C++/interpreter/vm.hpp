@@ -0,0 +1,67 @@
+#pragma once
+#include "bytecode.hpp"
+#include "interpreter.hpp"
+#include <exception>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// 字节码寄存器虚拟机
+// 与树遍历解释器共享变量作用域、调用栈以及运算语义，只替换语句与表达式的执行方式
+class VM {
+public:
+    explicit VM(Interpreter& interpreter) : interp(interpreter) {}
+
+    // 执行一条顶层语句（首次执行时编译并缓存）
+    Completion execute(const NodePtr<Statement>& stmt);
+    // 执行用户函数体，参数已由调用方绑定到当前作用域
+    Completion run_function(FuncDefStmt* func);
+    // 一个函数帧至少占用的字节数（无寄存器、无局部变量）
+    static size_t min_frame_bytes();
+
+private:
+    struct Region {
+        RegionKind kind;
+        size_t handler;
+    };
+
+    // 调用帧：字节码内的用户函数调用不递归调用 run，而是在帧栈上压入新帧
+    struct Frame {
+        const Chunk* chunk;
+        size_t pc;           // 调用其他函数时保存的返回位置
+        size_t base;         // 本帧寄存器在寄存器栈中的起始位置
+        size_t region_base;  // 本帧区域在区域栈中的起始位置
+        int return_reg;      // 返回值写入调用方的寄存器
+        FuncDefStmt* func;   // 入口帧为 nullptr
+        size_t cost;         // 计入调用帧内存上限的字节数
+    };
+
+    struct RunState {
+        std::vector<Value> stack;
+        std::vector<Frame> frames;
+        std::vector<Region> regions;
+    };
+
+    Completion run(const Chunk& chunk);
+    const Chunk& function_chunk(FuncDefStmt* func);
+    // 进入用户函数并压入新帧；超过调用帧内存上限时在调用方抛出错误
+    void push_function(RunState& state, FuncDefStmt* func, const std::vector<Value>& args, int return_reg);
+    // 尾调用：用 func 替换当前帧的函数与寄存器，帧数与递归深度不变
+    void replace_function(RunState& state, FuncDefStmt* func, const std::vector<Value>& args);
+    void pop_function(RunState& state);
+    size_t frame_cost(const Chunk& chunk, const FuncDefStmt* func) const;
+    void check_stack_budget(size_t bytes) const;
+    // 按区域由内向外处理异常，本帧无法处理时退出函数帧交给调用方；
+    // 返回当前帧恢复执行的位置，入口帧也无法处理时重新抛出
+    size_t handle_exception(RunState& state, std::exception_ptr error);
+
+    Interpreter& interp;
+    // 以 AST 节点为键缓存编译结果，AST 由调用方保持存活
+    std::unordered_map<const Statement*, std::unique_ptr<Chunk>> statement_chunks;
+    std::unordered_map<const FuncDefStmt*, std::unique_ptr<Chunk>> function_chunks;
+    // 所有帧栈上函数帧占用的字节数
+    size_t stack_bytes = 0;
+    // run 的本地栈嵌套层数：回退到树遍历执行的语句中的调用仍会嵌套 run
+    int native_depth = 0;
+    static constexpr int MAX_NATIVE_DEPTH = 10000;
+};